@@ -0,0 +1,322 @@
+#include "Benchmark.hpp"
+
+#include "Config.hpp"
+#include "Scenes.hpp"
+#include "RaytracerBVH.hpp"
+#include "VulkanWrapper/RadixSort.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <format>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+namespace Benchmark {
+	static auto percentile(std::vector<f64> values, f64 p) -> f64 { // nearest rank
+		if (values.empty())
+			return 0.0;
+		std::sort(values.begin(), values.end());
+		auto rank = static_cast<size_t>(p * static_cast<f64>(values.size() - 1) + 0.5);
+		return values[std::min(rank, values.size() - 1)];
+	}
+	static auto joinHistogram(const CPU::BVHAnalysis& bvh, const std::string& separator) -> std::string { // leaf sizes 1..16+
+		std::string joined;
+		for (u32 bin = 0; bin < CPU::LEAF_SIZE_HISTOGRAM_BINS; bin++)
+			joined += (bin > 0 ? separator : "") + std::to_string(bvh.leafSizeHistogram[bin]);
+		return joined;
+	}
+
+	auto run() -> std::vector<Result> {
+		std::vector<Result> results;
+		std::string deviceName;
+		const auto& settings = Config::get();
+		for (const auto& sceneName : settings.benchmarkScenes) {
+			auto sceneFunction = findScene(sceneName);
+			for (const auto& resolution : settings.benchmarkResolutions) {
+				// one renderer per scene and resolution. extent bits, rays per pixel and depth only change ubo values
+				RaytracerBVHRenderer::Raytracer raytracer{ resolution[0], resolution[1], sceneFunction };
+				deviceName = raytracer.getDeviceName();
+				for (const auto extentBits : settings.benchmarkMortonExtentBits) {
+					raytracer.setMortonExtentBits(extentBits); // the bvh is rebuilt every frame, so warmup picks it up
+					for (const auto raysPerPixel : settings.benchmarkRaysPerPixel) {
+						for (const auto depth : settings.benchmarkMaxRaytraceDepths) {
+							Result result{};
+							result.configuration = { sceneName, resolution[0], resolution[1], raysPerPixel, depth, extentBits };
+							raytracer.getScene().setRaysPerPixel(raysPerPixel);
+							raytracer.getScene().setMaxRaytraceDepth(depth);
+
+							for (u32 i = 0; i < settings.benchmarkWarmupFrames; i++)
+								raytracer.renderFrame();
+
+							std::vector<f64> frameMs, bvhBuildMs, raytraceMs;
+							RaytracerBVHRenderer::TraversalStatistics traversal{};
+							result.fromGPUTimestamps = true;
+							for (u32 i = 0; i < settings.benchmarkMeasuredFrames; i++) {
+								auto timings = raytracer.renderFrame();
+								frameMs.push_back(timings.frameMs);
+								bvhBuildMs.push_back(timings.bvhBuildMs);
+								raytraceMs.push_back(timings.raytraceMs);
+								result.fromGPUTimestamps = result.fromGPUTimestamps && timings.fromGPUTimestamps;
+								traversal.rays += timings.traversal.rays;
+								traversal.aabbTests += timings.traversal.aabbTests;
+								traversal.triangleTests += timings.traversal.triangleTests;
+								traversal.sphereTests += timings.traversal.sphereTests;
+							}
+							result.bvh = raytracer.analyseBVH();
+							result.traversalMeasured = settings.traversalStats && traversal.rays > 0;
+							if (result.traversalMeasured) {
+								result.aabbTestsPerRay = traversal.aabbTestsPerRay();
+								result.primitiveTestsPerRay = static_cast<f64>(traversal.triangleTests + traversal.sphereTests) / traversal.rays;
+							}
+							result.measuredFrames = settings.benchmarkMeasuredFrames;
+							result.medianFrameMs = percentile(frameMs, 0.5);
+							result.p95FrameMs = percentile(frameMs, 0.95);
+							result.medianBVHBuildMs = percentile(bvhBuildMs, 0.5);
+							result.medianRaytraceMs = percentile(raytraceMs, 0.5);
+							auto primaryRays = static_cast<f64>(resolution[0]) * resolution[1] * raysPerPixel;
+							result.megaRaysPerSecond = result.medianRaytraceMs > 0.0
+								? primaryRays / (result.medianRaytraceMs * 1000.0)
+								: 0.0;
+
+							std::cout << std::format(
+								"{} {}x{} rpp {} depth {} extent bits {}: frame median {:.3f}ms p95 {:.3f}ms, bvh {:.3f}ms, trace {:.3f}ms, {:.2f} Mrays/s, sah {:.2f} overlap {:.3f} depth {}{}\n",
+								sceneName, resolution[0], resolution[1], raysPerPixel, depth, extentBits,
+								result.medianFrameMs, result.p95FrameMs, result.medianBVHBuildMs, result.medianRaytraceMs, result.megaRaysPerSecond,
+								result.bvh.sahCost, result.bvh.siblingOverlap, result.bvh.maxDepth,
+								result.traversalMeasured
+									? std::format(", {:.2f} aabb / {:.2f} primitive tests per ray", result.aabbTestsPerRay, result.primitiveTestsPerRay)
+									: ""
+							);
+							results.push_back(result);
+						}
+					}
+				}
+			}
+		}
+		writeJSON(settings.benchmarkJsonPath, deviceName, results);
+		writeCSV(settings.benchmarkCsvPath, deviceName, results);
+		return results;
+	}
+
+	auto runRadixSort() -> std::vector<SortResult> {
+		using MortonPrimitive = SceneTypes::GPU::MortonPrimitive;
+		const auto& settings = Config::get();
+		const u32 repetitions = std::max(settings.radixSortBenchmarkRepetitions, 1u);
+		std::vector<SortResult> results;
+		Device device{};
+		std::mt19937 gen{ settings.seed };
+
+		// RadixSortSimple's bindings: the raytracing ubo for the key count, then both key buffers
+		auto legacySetLayout = DescriptorSetLayout::Builder(device)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1)
+			.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1)
+			.build();
+		VkDescriptorSetLayout legacySetLayoutHandle = legacySetLayout->getDescriptorSetLayout();
+		VkPipelineLayoutCreateInfo legacyLayoutInfo{};
+		legacyLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		legacyLayoutInfo.setLayoutCount = 1;
+		legacyLayoutInfo.pSetLayouts = &legacySetLayoutHandle;
+		VkPipelineLayout legacyPipelineLayout;
+		if (vkCreatePipelineLayout(device.device(), &legacyLayoutInfo, nullptr, &legacyPipelineLayout) != VK_SUCCESS)
+			throw std::runtime_error("failed to create compute pipeline layout!");
+		ComputePipelineConfigInfo legacyPipelineConfig{};
+		ComputePipeline::defaultPipelineConfigInfo(legacyPipelineConfig);
+		legacyPipelineConfig.pipelineLayout = legacyPipelineLayout;
+		auto legacyPipeline = std::make_unique<ComputePipeline>(device, "shaders/compiled/RadixSortSimple.comp.spv", legacyPipelineConfig);
+
+		for (const auto keyCount : settings.radixSortBenchmarkKeyCounts) {
+			if (keyCount == 0)
+				continue;
+			SortResult result{};
+			result.keyCount = keyCount;
+			result.legacyMeasured = keyCount <= settings.radixSortBenchmarkLegacyMaxKeys;
+
+			std::vector<MortonPrimitive> keys(keyCount);
+			for (u32 i = 0; i < keyCount; i++)
+				keys[i] = { static_cast<u32>(gen()) & 0x3FFFFFFF, i, 0, 0 }; // 30 bit codes, like GenerateMortonCodesOfPrimitives
+			const VkDeviceSize keyBytes = sizeof(MortonPrimitive) * keyCount;
+
+			Buffer source{ device, sizeof(MortonPrimitive), keyCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+			source.map();
+			source.writeToBuffer(keys.data());
+			const VkBufferUsageFlags keyUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			Buffer keys1{ device, sizeof(MortonPrimitive), keyCount, keyUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+			Buffer keys2{ device, sizeof(MortonPrimitive), keyCount, keyUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+			Buffer readback{ device, sizeof(MortonPrimitive), keyCount, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+
+			RaytracerBVHRenderer::RaytracingUniformBufferObject uboData{};
+			uboData.numTriangles = keyCount;
+			Buffer ubo{ device, sizeof(uboData), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+			ubo.map();
+			ubo.writeToBuffer(&uboData);
+
+			auto legacyPool = DescriptorPool::Builder(device)
+				.setMaxSets(1)
+				.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
+				.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2)
+				.build();
+			VkDescriptorSet legacySet;
+			auto uboInfo = ubo.descriptorInfo();
+			auto keys1Info = keys1.descriptorInfo();
+			auto keys2Info = keys2.descriptorInfo();
+			DescriptorWriter(*legacySetLayout, *legacyPool)
+				.writeBuffer(0, &uboInfo)
+				.writeBuffer(1, &keys1Info)
+				.writeBuffer(2, &keys2Info)
+				.build(legacySet);
+
+			RadixSort radixSort{ device, keys1, keys2, keyCount };
+			GPUProfiler profiler{ device, { "RadixSortSimple", "RadixSort" }, 1, repetitions };
+
+			// each run restores the unsorted keys first, outside the timed pass
+			auto timeRuns = [&](u32 pass, auto&& recordSort) -> std::vector<f64> {
+				std::vector<f64> wallMs;
+				for (u32 i = 0; i < repetitions; i++) {
+					VkCommandBuffer commandBuffer = device.beginSingleTimeCommands(device.getComputeCommandPool());
+					profiler.beginFrame(commandBuffer);
+					VkBufferCopy copyRegion{ 0, 0, keyBytes };
+					vkCmdCopyBuffer(commandBuffer, source.getBuffer(), keys1.getBuffer(), 1, &copyRegion);
+					VkMemoryBarrier copyToSort{};
+					copyToSort.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+					copyToSort.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+					copyToSort.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+					vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &copyToSort, 0, nullptr, 0, nullptr);
+					profiler.beginPass(commandBuffer, pass);
+					recordSort(commandBuffer);
+					profiler.endPass(commandBuffer, pass);
+					const auto start = std::chrono::high_resolution_clock::now();
+					device.endSingleTimeCommands(device.computeQueue(), device.getComputeCommandPool(), commandBuffer); // waits
+					wallMs.push_back(std::chrono::duration<f64, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+					profiler.endFrame();
+					profiler.collect();
+				}
+				return wallMs;
+			};
+			auto summarize = [&](u32 pass, const std::vector<f64>& wallMs, f64& minMs, f64& averageMs) {
+				if (profiler.isSupported()) {
+					const auto statistics = profiler.getStatistics(pass);
+					minMs = statistics.minMs;
+					averageMs = statistics.avgMs;
+					return;
+				}
+				minMs = *std::min_element(wallMs.begin(), wallMs.end());
+				averageMs = 0.0;
+				for (const auto ms : wallMs)
+					averageMs += ms / static_cast<f64>(wallMs.size());
+			};
+
+			if (result.legacyMeasured) {
+				const auto wallMs = timeRuns(0, [&](VkCommandBuffer commandBuffer) {
+					legacyPipeline->bind(commandBuffer);
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, legacyPipelineLayout, 0, 1, &legacySet, 0, nullptr);
+					vkCmdDispatch(commandBuffer, 1, 1, 1);
+				});
+				summarize(0, wallMs, result.legacyMinMs, result.legacyAverageMs);
+			}
+			const auto wallMs = timeRuns(1, [&](VkCommandBuffer commandBuffer) {
+				radixSort.record(commandBuffer, keyCount, 30);
+			});
+			summarize(1, wallMs, result.deviceMinMs, result.deviceAverageMs);
+			result.fromGPUTimestamps = profiler.isSupported();
+
+			device.copyBuffer(device.computeQueue(), device.getComputeCommandPool(), keys1.getBuffer(), readback.getBuffer(), keyBytes);
+			readback.map();
+			const auto* sorted = static_cast<const MortonPrimitive*>(readback.getMappedMemory());
+			std::vector<bool> seen(keyCount, false);
+			result.sorted = true;
+			for (u32 i = 0; i < keyCount && result.sorted; i++) {
+				const bool inOrder = i == 0 || sorted[i - 1].code <= sorted[i].code;
+				const bool valid = sorted[i].primitiveIndex < keyCount && !seen[sorted[i].primitiveIndex]
+					&& keys[sorted[i].primitiveIndex].code == sorted[i].code;
+				if (valid)
+					seen[sorted[i].primitiveIndex] = true;
+				result.sorted = inOrder && valid;
+			}
+			readback.unmap();
+
+			std::cout << std::format(
+				"{} keys: RadixSortSimple {}, RadixSort min {:.3f}ms avg {:.3f}ms{}\n",
+				keyCount,
+				result.legacyMeasured ? std::format("min {:.3f}ms avg {:.3f}ms", result.legacyMinMs, result.legacyAverageMs) : std::string("skipped"),
+				result.deviceMinMs, result.deviceAverageMs,
+				result.sorted ? "" : " (OUTPUT NOT SORTED)"
+			);
+			results.push_back(result);
+		}
+
+		legacyPipeline = nullptr;
+		vkDestroyPipelineLayout(device.device(), legacyPipelineLayout, nullptr);
+		writeRadixSortCSV(settings.radixSortBenchmarkCsvPath, device.properties.deviceName, results);
+		return results;
+	}
+
+	auto writeJSON(const std::string& path, const std::string& deviceName, const std::vector<Result>& results) -> void {
+		std::ofstream out(path, std::ios::trunc);
+		if (!out.is_open())
+			throw std::runtime_error("failed to open " + path + " for writing!");
+		out << "{\n\t\"device\": \"" << deviceName << "\",\n\t\"results\": [\n";
+		for (size_t i = 0; i < results.size(); i++) {
+			const auto& r = results[i];
+			out << std::format(
+				"\t\t{{ \"scene\": \"{}\", \"width\": {}, \"height\": {}, \"raysPerPixel\": {}, \"maxRaytraceDepth\": {}, "
+				"\"mortonExtentBits\": {}, \"measuredFrames\": {}, \"medianFrameMs\": {:.4f}, \"p95FrameMs\": {:.4f}, \"medianBVHBuildMs\": {:.4f}, "
+				"\"medianRaytraceMs\": {:.4f}, \"megaRaysPerSecond\": {:.4f}, \"gpuTimestamps\": {}, \"sahCost\": {:.4f}, "
+				"\"siblingOverlap\": {:.4f}, \"maxDepth\": {}, \"averageLeafDepth\": {:.4f}, \"leafSizeHistogram\": [{}], \"duplicateMortonCodes\": {}, "
+				"\"aabbTestsPerRay\": {}, \"primitiveTestsPerRay\": {} }}{}\n",
+				r.configuration.sceneName, r.configuration.width, r.configuration.height,
+				r.configuration.raysPerPixel, r.configuration.maxRaytraceDepth, r.configuration.mortonExtentBits,
+				r.measuredFrames, r.medianFrameMs, r.p95FrameMs, r.medianBVHBuildMs,
+				r.medianRaytraceMs, r.megaRaysPerSecond, r.fromGPUTimestamps, r.bvh.sahCost,
+				r.bvh.siblingOverlap, r.bvh.maxDepth, r.bvh.averageLeafDepth, joinHistogram(r.bvh, ", "),
+				r.bvh.mortonCodesAnalysed ? std::to_string(r.bvh.duplicateMortonCodes) : "null",
+				r.traversalMeasured ? std::format("{:.4f}", r.aabbTestsPerRay) : "null",
+				r.traversalMeasured ? std::format("{:.4f}", r.primitiveTestsPerRay) : "null",
+				i + 1 < results.size() ? "," : ""
+			);
+		}
+		out << "\t]\n}\n";
+	}
+
+	auto writeCSV(const std::string& path, const std::string& deviceName, const std::vector<Result>& results) -> void {
+		std::ofstream out(path, std::ios::trunc);
+		if (!out.is_open())
+			throw std::runtime_error("failed to open " + path + " for writing!");
+		out << "device,scene,width,height,raysPerPixel,maxRaytraceDepth,mortonExtentBits,measuredFrames,"
+			"medianFrameMs,p95FrameMs,medianBVHBuildMs,medianRaytraceMs,megaRaysPerSecond,gpuTimestamps,"
+			"sahCost,siblingOverlap,maxDepth,averageLeafDepth,leafSizeHistogram,duplicateMortonCodes,aabbTestsPerRay,primitiveTestsPerRay\n";
+		for (const auto& r : results) {
+			out << std::format(
+				"\"{}\",{},{},{},{},{},{},{},{:.4f},{:.4f},{:.4f},{:.4f},{:.4f},{},{:.4f},{:.4f},{},{:.4f},{},{},{},{}\n",
+				deviceName, r.configuration.sceneName, r.configuration.width, r.configuration.height,
+				r.configuration.raysPerPixel, r.configuration.maxRaytraceDepth, r.configuration.mortonExtentBits, r.measuredFrames,
+				r.medianFrameMs, r.p95FrameMs, r.medianBVHBuildMs, r.medianRaytraceMs, r.megaRaysPerSecond,
+				r.fromGPUTimestamps, r.bvh.sahCost,
+				r.bvh.siblingOverlap, r.bvh.maxDepth, r.bvh.averageLeafDepth, joinHistogram(r.bvh, " "),
+				r.bvh.mortonCodesAnalysed ? std::to_string(r.bvh.duplicateMortonCodes) : "",
+				r.traversalMeasured ? std::format("{:.4f}", r.aabbTestsPerRay) : "",
+				r.traversalMeasured ? std::format("{:.4f}", r.primitiveTestsPerRay) : ""
+			);
+		}
+	}
+
+	auto writeRadixSortCSV(const std::string& path, const std::string& deviceName, const std::vector<SortResult>& results) -> void {
+		std::ofstream out(path, std::ios::trunc);
+		if (!out.is_open())
+			throw std::runtime_error("failed to open " + path + " for writing!");
+		out << "device,keyCount,legacyMinMs,legacyAverageMs,radixSortMinMs,radixSortAverageMs,speedup,sorted,gpuTimestamps\n";
+		for (const auto& r : results) {
+			out << std::format(
+				"\"{}\",{},{},{},{:.4f},{:.4f},{},{},{}\n",
+				deviceName, r.keyCount,
+				r.legacyMeasured ? std::format("{:.4f}", r.legacyMinMs) : "",
+				r.legacyMeasured ? std::format("{:.4f}", r.legacyAverageMs) : "",
+				r.deviceMinMs, r.deviceAverageMs,
+				r.legacyMeasured && r.deviceMinMs > 0.0 ? std::format("{:.2f}", r.legacyMinMs / r.deviceMinMs) : "",
+				r.sorted, r.fromGPUTimestamps
+			);
+		}
+	}
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "utils/PrimitiveTypes.hpp"
+#include "CPU/BVHAnalysis.hpp"
+
+#include <string>
+#include <vector>
+
+namespace Benchmark {
+	struct Configuration {
+		std::string sceneName;
+		u32 width;
+		u32 height;
+		u32 raysPerPixel;
+		u32 maxRaytraceDepth;
+		u32 mortonExtentBits;
+	};
+
+	struct Result {
+		Configuration configuration;
+		u32 measuredFrames;
+		f64 medianFrameMs;
+		f64 p95FrameMs;
+		f64 medianBVHBuildMs;
+		f64 medianRaytraceMs;
+		f64 megaRaysPerSecond; // primary rays only (width * height * raysPerPixel) over the median raytrace time
+		bool fromGPUTimestamps;
+		CPU::BVHAnalysis bvh; // of the bvh built for the last measured frame
+		bool traversalMeasured; // traversalStats was on, so the per ray counts below are filled
+		f64 aabbTestsPerRay; // over every measured frame, bounces included
+		f64 primitiveTestsPerRay;
+	};
+
+	// runs every combination of the benchmark* settings (scene x resolution x morton extent bits x raysPerPixel x depth) headless,
+	// then writes the results to benchmarkJsonPath and benchmarkCsvPath
+	auto run() -> std::vector<Result>;
+
+	struct SortResult {
+		u32 keyCount;
+		bool legacyMeasured; // false past radixSortBenchmarkLegacyMaxKeys
+		f64 legacyMinMs; // RadixSortSimple
+		f64 legacyAverageMs;
+		f64 deviceMinMs; // RadixSort
+		f64 deviceAverageMs;
+		bool sorted; // RadixSort's output checked on the cpu: codes in order and every key present once
+		bool fromGPUTimestamps;
+	};
+
+	// sorts radixSortBenchmarkKeyCounts random morton keys with both gpu sorts on a headless device,
+	// then writes the results to radixSortBenchmarkCsvPath
+	auto runRadixSort() -> std::vector<SortResult>;
+
+	auto writeJSON(const std::string& path, const std::string& deviceName, const std::vector<Result>& results) -> void;
+	auto writeCSV(const std::string& path, const std::string& deviceName, const std::vector<Result>& results) -> void;
+	auto writeRadixSortCSV(const std::string& path, const std::string& deviceName, const std::vector<SortResult>& results) -> void;
+};
@@ -0,0 +1,67 @@
+#include "BVHAnalysis.hpp"
+#include "LBVH.hpp"
+
+#include <algorithm>
+
+namespace CPU {
+	namespace {
+		auto volume(const SceneTypes::GPU::AABB& box) -> f64 {
+			return static_cast<f64>(box.maxX - box.minX) * (box.maxY - box.minY) * (box.maxZ - box.minZ);
+		}
+		auto overlapVolume(const SceneTypes::GPU::AABB& a, const SceneTypes::GPU::AABB& b) -> f64 {
+			const f64 x = std::min(a.maxX, b.maxX) - std::max(a.minX, b.minX);
+			const f64 y = std::min(a.maxY, b.maxY) - std::max(a.minY, b.minY);
+			const f64 z = std::min(a.maxZ, b.maxZ) - std::max(a.minZ, b.minZ);
+			if (x <= 0.0 || y <= 0.0 || z <= 0.0)
+				return 0.0;
+			return x * y * z;
+		}
+	}
+
+	auto analyseBVH(const std::vector<SceneTypes::GPU::BVHNode>& nodes) -> BVHAnalysis {
+		BVHAnalysis analysis{};
+		if (nodes.empty())
+			return analysis;
+		analysis.sahCost = sahCost(nodes);
+
+		f64 overlap = 0.0;
+		u64 leafDepthSum = 0;
+		struct Visit {
+			u32 node;
+			u32 depth;
+		};
+		std::vector<Visit> stack{ { 0, 0 } };
+		while (!stack.empty()) {
+			const Visit visit = stack.back();
+			stack.pop_back();
+			const auto& node = nodes[visit.node];
+			if (node.left == INVALID_NODE_INDEX) {
+				const u32 primitives = (node.primitiveType & LEAF_RANGE_BIT) != 0 ? node.primitiveType & ~LEAF_RANGE_BIT : 1;
+				analysis.leaves++;
+				analysis.leafSizeHistogram[std::clamp(primitives, 1u, LEAF_SIZE_HISTOGRAM_BINS) - 1]++;
+				analysis.maxDepth = std::max(analysis.maxDepth, visit.depth);
+				leafDepthSum += visit.depth;
+				continue;
+			}
+			analysis.internalNodes++;
+			overlap += overlapVolume(nodes[node.left].aabb, nodes[node.right].aabb);
+			stack.push_back({ node.left, visit.depth + 1 });
+			stack.push_back({ node.right, visit.depth + 1 });
+		}
+		const f64 rootVolume = volume(nodes[0].aabb);
+		analysis.siblingOverlap = rootVolume > 0.0 ? overlap / rootVolume : 0.0;
+		analysis.averageLeafDepth = static_cast<f64>(leafDepthSum) / analysis.leaves;
+		return analysis;
+	}
+
+	auto countDuplicateMortonCodes(const std::vector<SceneTypes::GPU::MortonPrimitive>& sortedPrimitives) -> u32 {
+		u32 duplicates = 0;
+		for (size_t i = 1; i < sortedPrimitives.size(); i++) {
+			const auto& previous = sortedPrimitives[i - 1];
+			const auto& current = sortedPrimitives[i];
+			if (current.code == previous.code && current.codeHigh == previous.codeHigh)
+				duplicates++;
+		}
+		return duplicates;
+	}
+};
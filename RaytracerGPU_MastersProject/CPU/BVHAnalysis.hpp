@@ -0,0 +1,33 @@
+#pragma once
+
+#include "../utils/PrimitiveTypes.hpp"
+#include "../VulkanWrapper/SceneTypes.hpp"
+
+#include <array>
+#include <vector>
+
+/*
+Quality numbers for a tree in the LBVH node layout (root at 0, leaves have no children), whichever builder made it,
+to compare build strategies per scene. Walked from the root, so subtrees LeafCollapse left unreachable don't count.
+*/
+namespace CPU {
+	constexpr const u32 LEAF_SIZE_HISTOGRAM_BINS = 16; // maxLeafPrimitives' limit
+
+	struct BVHAnalysis {
+		f64 sahCost; // CPU::sahCost
+		// summed volume each internal node's two child boxes share, over the root's volume. rays in that space
+		// have to visit both children
+		f64 siblingOverlap;
+		u32 internalNodes;
+		u32 leaves;
+		u32 maxDepth; // edges from the root to the deepest leaf
+		f64 averageLeafDepth;
+		std::array<u32, LEAF_SIZE_HISTOGRAM_BINS> leafSizeHistogram; // leaves of i + 1 primitives
+		bool mortonCodesAnalysed; // only the morton builders (LBVH, PLOC) have codes
+		u32 duplicateMortonCodes; // sorted primitives with the same key as the one before, LBVH splits these arbitrarily
+	};
+
+	auto analyseBVH(const std::vector<SceneTypes::GPU::BVHNode>& nodes) -> BVHAnalysis;
+	// sortedPrimitives as RadixSort leaves them
+	auto countDuplicateMortonCodes(const std::vector<SceneTypes::GPU::MortonPrimitive>& sortedPrimitives) -> u32;
+};
@@ -0,0 +1,369 @@
+#include "BinnedSAH.hpp"
+#include "LBVH.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <emmintrin.h>
+
+namespace CPU {
+	namespace {
+		constexpr const u32 PARALLEL_BIN_MIN_PRIMITIVES = 1 << 14; // ranges at least this large are binned on every worker
+		constexpr const u32 BIN_CHUNK_PRIMITIVES = 1 << 12; // primitives per parallel binning task
+		constexpr const u32 SUBTREE_TASKS_PER_WORKER = 4; // spare subtrees so stealing can even out uneven ones
+		constexpr const u32 SUBTREE_MIN_PRIMITIVES = 64; // smaller subtrees aren't worth a task of their own
+
+		struct Bounds { // xyz lanes, w is along for the ride
+			__m128 min = _mm_set1_ps(FLT_MAX);
+			__m128 max = _mm_set1_ps(-FLT_MAX);
+
+			auto grow(__m128 pointMin, __m128 pointMax) -> void {
+				this->min = _mm_min_ps(this->min, pointMin);
+				this->max = _mm_max_ps(this->max, pointMax);
+			}
+			auto grow(const Bounds& other) -> void { this->grow(other.min, other.max); }
+			auto area() const -> f32 { // half the surface area, only ever compared
+				alignas(16) f32 e[4];
+				_mm_store_ps(e, _mm_sub_ps(this->max, this->min));
+				if (e[0] < 0.0f)
+					return 0.0f; // empty
+				return e[0] * e[1] + e[1] * e[2] + e[2] * e[0];
+			}
+			auto toAABB() const -> SceneTypes::GPU::AABB {
+				alignas(16) f32 lo[4];
+				alignas(16) f32 hi[4];
+				_mm_store_ps(lo, this->min);
+				_mm_store_ps(hi, this->max);
+				return { lo[0], hi[0], lo[1], hi[1], lo[2], hi[2] };
+			}
+		};
+
+		struct alignas(16) Reference {
+			__m128 min; // padded primitive box
+			__m128 max;
+			u32 primitive; // triangles first, then spheres
+
+			auto centroid() const -> __m128 { return _mm_mul_ps(_mm_add_ps(this->min, this->max), _mm_set1_ps(0.5f)); }
+		};
+
+		struct Bin {
+			Bounds bounds;
+			Bounds centroids;
+			u32 count = 0;
+		};
+		using Bins = std::array<std::array<Bin, SAH_BINS>, 3>;
+
+		struct Range {
+			u32 begin = 0; // [begin, end) of the reference array
+			u32 end = 0;
+			u32 internalBase = 0; // first of the range's internal nodes, its root when it has more than one primitive
+			Bounds bounds{};
+			Bounds centroids{};
+
+			auto count() const -> u32 { return this->end - this->begin; }
+		};
+
+		struct BinMapping { // centroid -> bin, per axis
+			__m128 origin;
+			__m128 scale;
+		};
+
+		auto binMapping(const Bounds& centroids) -> BinMapping {
+			alignas(16) f32 extent[4];
+			_mm_store_ps(extent, _mm_sub_ps(centroids.max, centroids.min));
+			alignas(16) f32 scale[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (u32 axis = 0; axis < 3; axis++) // slightly under SAH_BINS, so the max centroid lands in the last bin
+				scale[axis] = extent[axis] > 0.0f ? static_cast<f32>(SAH_BINS) * (1.0f - 1e-6f) / extent[axis] : 0.0f;
+			return { centroids.min, _mm_load_ps(scale) };
+		}
+
+		// the same arithmetic for binning and partitioning, so every reference goes the way its bin did
+		auto binIndices(const BinMapping& mapping, __m128 centroid, i32 (&bins)[4]) -> void {
+			const __m128i index = _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(centroid, mapping.origin), mapping.scale));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(bins), index);
+			for (u32 axis = 0; axis < 3; axis++)
+				bins[axis] = std::clamp(bins[axis], 0, static_cast<i32>(SAH_BINS) - 1);
+		}
+
+		auto accumulate(const Reference* references, u32 begin, u32 end, const BinMapping& mapping, Bins& bins) -> void {
+			for (u32 i = begin; i < end; i++) {
+				const Reference& reference = references[i];
+				const __m128 centroid = reference.centroid();
+				i32 index[4];
+				binIndices(mapping, centroid, index);
+				for (u32 axis = 0; axis < 3; axis++) {
+					Bin& bin = bins[axis][index[axis]];
+					bin.bounds.grow(reference.min, reference.max);
+					bin.centroids.grow(centroid, centroid);
+					bin.count++;
+				}
+			}
+		}
+
+		struct Split {
+			u32 axis;
+			u32 bin; // bins below go left
+			Bounds leftBounds, leftCentroids;
+			Bounds rightBounds, rightCentroids;
+		};
+
+		// lowest sah cost plane between bins over every axis with any centroid extent. false if there is none,
+		// when every centroid coincides
+		auto findSplit(const Bins& bins, const BinMapping& mapping, Split& split) -> bool {
+			alignas(16) f32 scale[4];
+			_mm_store_ps(scale, mapping.scale);
+			f32 bestCost = FLT_MAX;
+			bool found = false;
+			for (u32 axis = 0; axis < 3; axis++) {
+				if (scale[axis] == 0.0f)
+					continue;
+				std::array<f32, SAH_BINS> rightCost{}; // area * count of everything from bin b on
+				std::array<u32, SAH_BINS> rightCount{};
+				Bounds right;
+				for (u32 b = SAH_BINS - 1; b > 0; b--) {
+					right.grow(bins[axis][b].bounds);
+					rightCount[b] = bins[axis][b].count + (b + 1 < SAH_BINS ? rightCount[b + 1] : 0);
+					rightCost[b] = right.area() * static_cast<f32>(rightCount[b]);
+				}
+				Bounds left;
+				u32 leftCount = 0;
+				for (u32 b = 1; b < SAH_BINS; b++) {
+					left.grow(bins[axis][b - 1].bounds);
+					leftCount += bins[axis][b - 1].count;
+					if (leftCount == 0 || rightCount[b] == 0)
+						continue;
+					const f32 cost = left.area() * static_cast<f32>(leftCount) + rightCost[b];
+					if (cost < bestCost) {
+						bestCost = cost;
+						split.axis = axis;
+						split.bin = b;
+						found = true;
+					}
+				}
+			}
+			if (!found)
+				return false;
+			split.leftBounds = split.leftCentroids = split.rightBounds = split.rightCentroids = Bounds{};
+			for (u32 b = 0; b < SAH_BINS; b++) {
+				const Bin& bin = bins[split.axis][b];
+				if (b < split.bin) {
+					split.leftBounds.grow(bin.bounds);
+					split.leftCentroids.grow(bin.centroids);
+				}
+				else {
+					split.rightBounds.grow(bin.bounds);
+					split.rightCentroids.grow(bin.centroids);
+				}
+			}
+			return true;
+		}
+
+		class Builder {
+			std::vector<Reference> references;
+			std::vector<SceneTypes::GPU::BVHNode>& nodes;
+			const u32 numTriangles;
+			const u32 leafOffset;
+
+			auto nodeOf(const Range& range) const -> u32 {
+				return range.count() == 1 ? this->leafOffset + range.begin : range.internalBase;
+			}
+			auto writeLeaf(const Range& range) -> void {
+				const Reference& reference = this->references[range.begin];
+				const bool triangle = reference.primitive < this->numTriangles;
+				this->nodes[this->leafOffset + range.begin] = {
+					range.bounds.toAABB(),
+					INVALID_NODE_INDEX,
+					INVALID_NODE_INDEX,
+					triangle ? reference.primitive : reference.primitive - this->numTriangles,
+					triangle ? TRIANGLE_PRIMITIVE : SPHERE_PRIMITIVE
+				};
+			}
+
+			// splits range in two, writing its internal node. children's ranges go to left and right
+			auto splitRange(const Range& range, const Bins& bins, const BinMapping& mapping, Range& left, Range& right) -> void {
+				Split split;
+				u32 middle;
+				if (findSplit(bins, mapping, split)) {
+					auto* first = this->references.data() + range.begin;
+					auto* last = this->references.data() + range.end;
+					middle = static_cast<u32>(std::partition(first, last, [&](const Reference& reference) {
+						i32 index[4];
+						binIndices(mapping, reference.centroid(), index);
+						return static_cast<u32>(index[split.axis]) < split.bin;
+					}) - this->references.data());
+					left.bounds = split.leftBounds;
+					left.centroids = split.leftCentroids;
+					right.bounds = split.rightBounds;
+					right.centroids = split.rightCentroids;
+				}
+				else { // every centroid in one spot, any halving is as good as another
+					middle = range.begin + range.count() / 2;
+					left.bounds = left.centroids = right.bounds = right.centroids = Bounds{};
+					for (u32 i = range.begin; i < range.end; i++) {
+						const Reference& reference = this->references[i];
+						Bounds& bounds = i < middle ? left.bounds : right.bounds;
+						Bounds& centroids = i < middle ? left.centroids : right.centroids;
+						bounds.grow(reference.min, reference.max);
+						centroids.grow(reference.centroid(), reference.centroid());
+					}
+				}
+				left.begin = range.begin;
+				left.end = middle;
+				left.internalBase = range.internalBase + 1;
+				right.begin = middle;
+				right.end = range.end;
+				right.internalBase = range.internalBase + left.count(); // after the left subtree's count - 1 internal nodes
+
+				this->nodes[range.internalBase] = {
+					range.bounds.toAABB(),
+					this->nodeOf(left),
+					this->nodeOf(right),
+					INVALID_NODE_INDEX,
+					0
+				};
+			}
+		public:
+			Builder(std::vector<Reference>&& references, std::vector<SceneTypes::GPU::BVHNode>& nodes, u32 numTriangles) :
+				references{ std::move(references) },
+				nodes{ nodes },
+				numTriangles{ numTriangles },
+				leafOffset{ static_cast<u32>(this->references.size()) - 1 }
+			{}
+
+			// one step of the top levels, binning across every worker
+			auto splitParallel(const Range& range, Util::WorkStealingScheduler& scheduler, Range& left, Range& right) -> void {
+				const BinMapping mapping = binMapping(range.centroids);
+				const u32 chunks = (range.count() + BIN_CHUNK_PRIMITIVES - 1) / BIN_CHUNK_PRIMITIVES;
+				std::vector<Bins> chunkBins(chunks);
+				scheduler.parallelFor(chunks, [&](u32 chunk, u32) {
+					const u32 begin = range.begin + chunk * BIN_CHUNK_PRIMITIVES;
+					accumulate(this->references.data(), begin, std::min(begin + BIN_CHUNK_PRIMITIVES, range.end), mapping, chunkBins[chunk]);
+				});
+				Bins bins{};
+				for (const auto& chunk : chunkBins) {
+					for (u32 axis = 0; axis < 3; axis++) {
+						for (u32 b = 0; b < SAH_BINS; b++) {
+							bins[axis][b].bounds.grow(chunk[axis][b].bounds);
+							bins[axis][b].centroids.grow(chunk[axis][b].centroids);
+							bins[axis][b].count += chunk[axis][b].count;
+						}
+					}
+				}
+				this->splitRange(range, bins, mapping, left, right);
+			}
+
+			auto splitSerial(const Range& range, Range& left, Range& right) -> void {
+				const BinMapping mapping = binMapping(range.centroids);
+				Bins bins{};
+				accumulate(this->references.data(), range.begin, range.end, mapping, bins);
+				this->splitRange(range, bins, mapping, left, right);
+			}
+
+			// the whole subtree on the calling thread. an explicit stack, lopsided splits can go very deep
+			auto buildSubtree(const Range& root) -> void {
+				std::vector<Range> stack{ root };
+				while (!stack.empty()) {
+					const Range range = stack.back();
+					stack.pop_back();
+					if (range.count() == 1) {
+						this->writeLeaf(range);
+						continue;
+					}
+					Range left, right;
+					this->splitSerial(range, left, right);
+					stack.push_back(right);
+					stack.push_back(left);
+				}
+			}
+		};
+
+		auto addReference(Reference& reference, Range& root, u32 primitive, const SceneTypes::GPU::AABB& box) -> void {
+			reference.min = _mm_setr_ps(box.minX, box.minY, box.minZ, 0.0f);
+			reference.max = _mm_setr_ps(box.maxX, box.maxY, box.maxZ, 0.0f);
+			reference.primitive = primitive;
+			root.bounds.grow(reference.min, reference.max);
+			root.centroids.grow(reference.centroid(), reference.centroid());
+		}
+
+		// references and root filled in, builds into nodes (already sized 2n - 1)
+		auto build(
+			std::vector<Reference>&& references,
+			const Range& root,
+			u32 numTriangles,
+			std::vector<SceneTypes::GPU::BVHNode>& nodes,
+			Util::WorkStealingScheduler& scheduler
+		) -> void {
+			const u32 primitiveCount = root.count();
+			Builder builder(std::move(references), nodes, numTriangles);
+
+			// split the top of the tree until there are enough independent subtrees to keep every worker busy
+			const u32 subtreeMaxPrimitives = std::max(primitiveCount / (scheduler.getThreadCount() * SUBTREE_TASKS_PER_WORKER), SUBTREE_MIN_PRIMITIVES);
+			std::vector<Range> pending{ root };
+			std::vector<Range> subtrees;
+			while (!pending.empty()) {
+				const Range range = pending.back();
+				pending.pop_back();
+				if (range.count() <= subtreeMaxPrimitives) {
+					subtrees.push_back(range);
+					continue;
+				}
+				Range left, right;
+				if (range.count() >= PARALLEL_BIN_MIN_PRIMITIVES)
+					builder.splitParallel(range, scheduler, left, right);
+				else
+					builder.splitSerial(range, left, right);
+				pending.push_back(left);
+				pending.push_back(right);
+			}
+			std::sort(subtrees.begin(), subtrees.end(), [](const Range& a, const Range& b) { return a.count() > b.count(); }); // big ones first
+			scheduler.parallelFor(static_cast<u32>(subtrees.size()), [&](u32 task, u32) {
+				builder.buildSubtree(subtrees[task]);
+			});
+		}
+	}
+
+	auto buildBinnedSAH(
+		const std::vector<SceneTypes::GPU::Triangle>& triangles,
+		const std::vector<SceneTypes::GPU::Sphere>& spheres,
+		Util::WorkStealingScheduler& scheduler
+	) -> std::vector<SceneTypes::GPU::BVHNode> {
+		const u32 numTriangles = static_cast<u32>(triangles.size());
+		const u32 primitiveCount = numTriangles + static_cast<u32>(spheres.size());
+		std::vector<SceneTypes::GPU::BVHNode> nodes;
+		if (primitiveCount == 0)
+			return nodes;
+		nodes.resize(2 * static_cast<size_t>(primitiveCount) - 1);
+
+		std::vector<Reference> references(primitiveCount);
+		Range root{ 0, primitiveCount, 0 };
+		for (u32 i = 0; i < primitiveCount; i++) {
+			auto box = i < numTriangles ? getTriangleAABB(triangles[i]) : getSphereAABB(spheres[i - numTriangles]);
+			padAABB(box); // same leaf boxes as ConstructHLBVH
+			addReference(references[i], root, i, box);
+		}
+		build(std::move(references), root, numTriangles, nodes, scheduler);
+		return nodes;
+	}
+
+	auto buildBinnedSAH(
+		const std::vector<SceneTypes::GPU::AABB>& boxes,
+		u32 leafPrimitiveType,
+		Util::WorkStealingScheduler& scheduler
+	) -> std::vector<SceneTypes::GPU::BVHNode> {
+		const u32 primitiveCount = static_cast<u32>(boxes.size());
+		std::vector<SceneTypes::GPU::BVHNode> nodes;
+		if (primitiveCount == 0)
+			return nodes;
+		nodes.resize(2 * static_cast<size_t>(primitiveCount) - 1);
+
+		std::vector<Reference> references(primitiveCount);
+		Range root{ 0, primitiveCount, 0 };
+		for (u32 i = 0; i < primitiveCount; i++) {
+			addReference(references[i], root, i, boxes[i]);
+		}
+		build(std::move(references), root, 0, nodes, scheduler); // no triangles, so leaf indices are the box indices
+		for (u32 i = primitiveCount - 1; i < nodes.size(); i++)
+			nodes[i].primitiveType = leafPrimitiveType;
+		return nodes;
+	}
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../utils/PrimitiveTypes.hpp"
+#include "../utils/WorkStealingScheduler.hpp"
+#include "../VulkanWrapper/SceneTypes.hpp"
+
+#include <vector>
+
+/*
+Top down binned SAH builder (Wald 2007) for static scenes that can spend a little load time on a better tree than
+the LBVH. Produces buildLBVH's node layout (internal nodes at [0, n - 2], root at 0, leaves at [n - 1, 2n - 2],
+one primitive each), so the result uploads straight into HLBVHNodesBuffer.
+Nodes come out of one preallocated array: a range of k primitives owns k - 1 internal nodes right after its root
+and the k leaves at its primitive positions, so every subtree writes its own slice of the array and no node is
+allocated on its own. Ranges too large to be one task are binned in parallel chunks, then the remaining subtrees
+are built as independent Util::WorkStealingScheduler tasks.
+*/
+namespace CPU {
+	constexpr const u32 SAH_BINS = 32; // per axis
+
+	// expects world space primitives
+	auto buildBinnedSAH(
+		const std::vector<SceneTypes::GPU::Triangle>& triangles,
+		const std::vector<SceneTypes::GPU::Sphere>& spheres,
+		Util::WorkStealingScheduler& scheduler
+	) -> std::vector<SceneTypes::GPU::BVHNode>;
+
+	// the same build over prebuilt boxes (used as given, not padded). leaf i's primitiveIndex is its box's index and
+	// every leaf gets leafPrimitiveType, e.g. the TwoLevelBVH's instances
+	auto buildBinnedSAH(
+		const std::vector<SceneTypes::GPU::AABB>& boxes,
+		u32 leafPrimitiveType,
+		Util::WorkStealingScheduler& scheduler
+	) -> std::vector<SceneTypes::GPU::BVHNode>;
+};
@@ -0,0 +1,304 @@
+#include "LBVH.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace CPU {
+	namespace {
+		constexpr const f32 DELTA = 0.001f;
+		constexpr const f32 PADDING = DELTA / 2;
+
+		constexpr const u32 MORTON_BITS = 10;
+		constexpr const u32 MORTON_SCALE = 1 << MORTON_BITS;
+		constexpr const u32 WIDE_MORTON_BITS = 21;
+		constexpr const u32 WIDE_MORTON_SCALE = 1 << WIDE_MORTON_BITS;
+		constexpr const f32 EXTENT_LOG_RANGE = 16.0f;
+
+		struct ConstructionInfo { // HLBVHAABBConstructionInfo
+			u32 parent;
+			i32 visitationCount;
+		};
+
+		auto seperateBitsBy3(u32 val) -> u32 {
+			if (val >= MORTON_SCALE)
+				val = MORTON_SCALE - 1;
+			val = (val | (val << 16)) & 50331903;
+			val = (val | (val << 8)) & 50393103;
+			val = (val | (val << 4)) & 51130563;
+			val = (val | (val << 2)) & 153391689;
+			return val;
+		}
+
+		auto mortonCode3D(const glm::uvec3& quantizedCoord) -> u32 {
+			return (
+				seperateBitsBy3(quantizedCoord.z) << 2 |
+				seperateBitsBy3(quantizedCoord.y) << 1 |
+				seperateBitsBy3(quantizedCoord.x)
+			);
+		}
+
+		// seperates the 21 LSBs so bit k lands on bit 3k
+		auto seperateBitsBy3Wide(u32 val) -> u64 {
+			u64 x = std::min(val, WIDE_MORTON_SCALE - 1);
+			x = (x | (x << 32)) & 0x1F00000000FFFFull;
+			x = (x | (x << 16)) & 0x1F0000FF0000FFull;
+			x = (x | (x << 8)) & 0x100F00F00F00F00Full;
+			x = (x | (x << 4)) & 0x10C30C30C30C30C3ull;
+			x = (x | (x << 2)) & 0x1249249249249249ull;
+			return x;
+		}
+
+		auto mortonCode3DWide(const glm::uvec3& quantizedCoord) -> u64 {
+			return (
+				seperateBitsBy3Wide(quantizedCoord.z) << 2 |
+				seperateBitsBy3Wide(quantizedCoord.y) << 1 |
+				seperateBitsBy3Wide(quantizedCoord.x)
+			);
+		}
+
+		// GenerateMortonCodesOfPrimitives' quantizeExtent. log scale size bucket, larger primitives get larger buckets
+		auto quantizeExtent(f32 diagonal, f32 sceneDiagonal, u32 bits) -> u32 {
+			const f32 relative = std::clamp(diagonal / sceneDiagonal, std::exp2(-EXTENT_LOG_RANGE), 1.0f);
+			const f32 t = (std::log2(relative) + EXTENT_LOG_RANGE) / EXTENT_LOG_RANGE;
+			return std::min(static_cast<u32>(t * static_cast<f32>(1u << bits)), (1u << bits) - 1);
+		}
+
+		auto fullCode(const SceneTypes::GPU::MortonPrimitive& mp) -> u64 {
+			return (static_cast<u64>(mp.codeHigh) << 32) | mp.code;
+		}
+
+		auto getTriangleCenter(const SceneTypes::GPU::Triangle& t) -> glm::vec3 {
+			return (t.v0 + t.v1 + t.v2) / 3.0f;
+		}
+
+		// same as the shader's countLeadingZeroesFromDifference. duplicate codes fall back to the sorted index
+		auto commonPrefix(const std::vector<SceneTypes::GPU::MortonPrimitive>& sorted, i32 i, i32 j) -> i32 {
+			if (j < 0 || j > static_cast<i32>(sorted.size()) - 1)
+				return -1;
+			const u64 codeI = fullCode(sorted[i]);
+			const u64 codeJ = fullCode(sorted[j]);
+			if (codeI == codeJ)
+				return 64 + std::countl_zero(static_cast<u32>(i) ^ static_cast<u32>(j));
+			return std::countl_zero(codeI ^ codeJ);
+		}
+
+		auto determineRange(const std::vector<SceneTypes::GPU::MortonPrimitive>& sorted, i32 id, i32& lower, i32& upper) -> void {
+			const i32 deltaL = commonPrefix(sorted, id, id - 1);
+			const i32 deltaR = commonPrefix(sorted, id, id + 1);
+			const i32 dir = (deltaR >= deltaL) ? 1 : -1;
+
+			const i32 deltaMin = std::min(deltaL, deltaR);
+			i32 lMax = 2;
+			while (commonPrefix(sorted, id, id + lMax * dir) > deltaMin)
+				lMax <<= 1;
+
+			i32 l = 0;
+			for (i32 t = lMax >> 1; t > 0; t >>= 1) {
+				if (commonPrefix(sorted, id, id + (l + t) * dir) > deltaMin)
+					l += t;
+			}
+			const i32 endId = id + l * dir;
+
+			lower = std::min(id, endId);
+			upper = std::max(id, endId);
+		}
+
+		auto findSplit(const std::vector<SceneTypes::GPU::MortonPrimitive>& sorted, i32 first, i32 last) -> i32 {
+			const i32 prefix = commonPrefix(sorted, first, last);
+
+			i32 split = first;
+			i32 stride = last - first;
+			do {
+				stride = (stride + 1) >> 1;
+				const i32 newSplit = split + stride;
+				if (newSplit < last && commonPrefix(sorted, first, newSplit) > prefix)
+					split = newSplit;
+			} while (stride > 1);
+			return split;
+		}
+	}
+
+	auto transformToWorldSpace(
+		const std::vector<SceneTypes::GPU::Model>& models,
+		std::vector<SceneTypes::GPU::Triangle>& triangles,
+		std::vector<SceneTypes::GPU::Sphere>& spheres
+	) -> void {
+		for (auto& t : triangles) {
+			const auto& m = models[t.modelIndex].modelMatrix;
+			t.v0 = glm::vec3(m * glm::vec4(t.v0, 1.0f));
+			t.v1 = glm::vec3(m * glm::vec4(t.v1, 1.0f));
+			t.v2 = glm::vec3(m * glm::vec4(t.v2, 1.0f));
+		}
+		for (auto& s : spheres)
+			s.center = glm::vec3(models[s.modelIndex].modelMatrix * glm::vec4(s.center, 1.0f));
+	}
+
+	auto getTriangleAABB(const SceneTypes::GPU::Triangle& t) -> SceneTypes::GPU::AABB {
+		return {
+			std::min(t.v0.x, std::min(t.v1.x, t.v2.x)), std::max(t.v0.x, std::max(t.v1.x, t.v2.x)),
+			std::min(t.v0.y, std::min(t.v1.y, t.v2.y)), std::max(t.v0.y, std::max(t.v1.y, t.v2.y)),
+			std::min(t.v0.z, std::min(t.v1.z, t.v2.z)), std::max(t.v0.z, std::max(t.v1.z, t.v2.z))
+		};
+	}
+	auto getSphereAABB(const SceneTypes::GPU::Sphere& s) -> SceneTypes::GPU::AABB {
+		const glm::vec3 l = s.center - s.radius;
+		const glm::vec3 r = s.center + s.radius;
+		return {
+			std::min(l.x, r.x), std::max(l.x, r.x),
+			std::min(l.y, r.y), std::max(l.y, r.y),
+			std::min(l.z, r.z), std::max(l.z, r.z)
+		};
+	}
+	auto combineAABB(const SceneTypes::GPU::AABB& a, const SceneTypes::GPU::AABB& b) -> SceneTypes::GPU::AABB {
+		return {
+			std::min(a.minX, b.minX), std::max(a.maxX, b.maxX),
+			std::min(a.minY, b.minY), std::max(a.maxY, b.maxY),
+			std::min(a.minZ, b.minZ), std::max(a.maxZ, b.maxZ)
+		};
+	}
+	auto padAABB(SceneTypes::GPU::AABB& box) -> void {
+		if (box.maxX - box.minX < DELTA) {
+			box.minX -= PADDING;
+			box.maxX += PADDING;
+		}
+		if (box.maxY - box.minY < DELTA) {
+			box.minY -= PADDING;
+			box.maxY += PADDING;
+		}
+		if (box.maxZ - box.minZ < DELTA) {
+			box.minZ -= PADDING;
+			box.maxZ += PADDING;
+		}
+	}
+
+	auto buildLBVH(
+		const std::vector<SceneTypes::GPU::Triangle>& triangles,
+		const std::vector<SceneTypes::GPU::Sphere>& spheres,
+		u32 mortonCodeBits,
+		u32 mortonExtentBits
+	) -> LBVH {
+		LBVH bvh{};
+		const u32 numTriangles = static_cast<u32>(triangles.size());
+		const u32 primitiveCount = numTriangles + static_cast<u32>(spheres.size());
+		if (primitiveCount == 0)
+			return bvh;
+		auto center = [&](u32 i) -> glm::vec3 {
+			return i < numTriangles ? getTriangleCenter(triangles[i]) : spheres[i - numTriangles].center;
+		};
+
+		// GetEnclosingAABB
+		SceneTypes::GPU::AABB enclosing{ 1000000000.0f, -1000000000.0f, 1000000000.0f, -1000000000.0f, 1000000000.0f, -1000000000.0f };
+		for (u32 i = 0; i < primitiveCount; i++) {
+			const auto c = center(i);
+			enclosing = combineAABB(enclosing, { c.x, c.x, c.y, c.y, c.z, c.z });
+		}
+		padAABB(enclosing);
+		bvh.enclosingMin = glm::vec3(enclosing.minX, enclosing.minY, enclosing.minZ);
+		bvh.enclosingMax = glm::vec3(enclosing.maxX, enclosing.maxY, enclosing.maxZ);
+
+		// GenerateMortonCodesOfPrimitives
+		const glm::vec3 span = bvh.enclosingMax - bvh.enclosingMin;
+		bvh.mortonPrimitives.resize(primitiveCount);
+		for (u32 i = 0; i < primitiveCount; i++) {
+			auto& mp = bvh.mortonPrimitives[i];
+			mp.primitiveIndex = i < numTriangles ? i : i - numTriangles;
+			mp.primitiveType = i < numTriangles ? TRIANGLE_PRIMITIVE : SPHERE_PRIMITIVE;
+			const glm::vec3 offset = glm::clamp((center(i) - bvh.enclosingMin) / span, 0.0f, 1.0f);
+			if (mortonCodeBits == 63) {
+				const u64 code = mortonCode3DWide(glm::uvec3(offset * static_cast<f32>(WIDE_MORTON_SCALE)));
+				mp.code = static_cast<u32>(code);
+				mp.codeHigh = static_cast<u32>(code >> 32);
+			}
+			else {
+				mp.code = mortonCode3D(glm::uvec3(offset * static_cast<f32>(MORTON_SCALE)));
+				mp.codeHigh = 0;
+			}
+			if (mortonExtentBits != 0) {
+				const auto box = i < numTriangles ? getTriangleAABB(triangles[i]) : getSphereAABB(spheres[i - numTriangles]);
+				const f32 diagonal = glm::length(glm::vec3(box.maxX - box.minX, box.maxY - box.minY, box.maxZ - box.minZ));
+				const u64 extent = quantizeExtent(diagonal, glm::length(span), mortonExtentBits);
+				if (mortonCodeBits == 63) { // drop the lowest morton bits to make room at the top
+					const u64 code = (fullCode(mp) >> (mortonExtentBits - 1)) | (extent << (64 - mortonExtentBits));
+					mp.code = static_cast<u32>(code);
+					mp.codeHigh = static_cast<u32>(code >> 32);
+				}
+				else
+					mp.codeHigh = static_cast<u32>(extent);
+			}
+		}
+
+		// RadixSort. lsd radix sort is stable, so equal codes keep primitive order
+		std::stable_sort(
+			bvh.mortonPrimitives.begin(), bvh.mortonPrimitives.end(),
+			[](const auto& a, const auto& b) { return fullCode(a) < fullCode(b); }
+		);
+
+		// ConstructHLBVH
+		const u32 leafOffset = primitiveCount - 1;
+		bvh.nodes.resize(2 * static_cast<size_t>(primitiveCount) - 1);
+		std::vector<ConstructionInfo> constructionInfo(bvh.nodes.size(), ConstructionInfo{ 0, 0 });
+		for (u32 i = 0; i < primitiveCount; i++) {
+			const auto& mp = bvh.mortonPrimitives[i];
+			auto box = mp.primitiveType == TRIANGLE_PRIMITIVE
+				? getTriangleAABB(triangles[mp.primitiveIndex])
+				: getSphereAABB(spheres[mp.primitiveIndex]);
+			padAABB(box);
+			bvh.nodes[leafOffset + i] = { box, INVALID_NODE_INDEX, INVALID_NODE_INDEX, mp.primitiveIndex, mp.primitiveType };
+		}
+		for (u32 i = 0; i + 1 < primitiveCount; i++) {
+			i32 first, last;
+			determineRange(bvh.mortonPrimitives, static_cast<i32>(i), first, last);
+			const i32 split = findSplit(bvh.mortonPrimitives, first, last);
+
+			const u32 leftChild = split == first ? leafOffset + split : split;
+			const u32 rightChild = split + 1 == last ? leafOffset + split + 1 : split + 1;
+			bvh.nodes[i] = { SceneTypes::GPU::AABB{ 0, 0, 0, 0, 0, 0 }, leftChild, rightChild, INVALID_NODE_INDEX, 0 };
+			constructionInfo[leftChild].parent = i;
+			constructionInfo[rightChild].parent = i;
+		}
+
+		// ConstructAABBsOfInternalNodes. same climb as the shader, just one leaf at a time
+		for (u32 i = 0; primitiveCount > 1 && i < primitiveCount; i++) { // a single leaf is already the root
+			u32 nodeId = constructionInfo[leafOffset + i].parent;
+			while (constructionInfo[nodeId].visitationCount++ >= 1) {
+				auto& node = bvh.nodes[nodeId];
+				node.aabb = combineAABB(bvh.nodes[node.left].aabb, bvh.nodes[node.right].aabb);
+				if (nodeId == 0)
+					break;
+				nodeId = constructionInfo[nodeId].parent;
+			}
+		}
+		return bvh;
+	}
+
+	auto surfaceArea(const SceneTypes::GPU::AABB& box) -> f64 {
+		const f64 x = box.maxX - box.minX;
+		const f64 y = box.maxY - box.minY;
+		const f64 z = box.maxZ - box.minZ;
+		return 2.0 * (x * y + y * z + z * x);
+	}
+
+	auto sahCost(const std::vector<SceneTypes::GPU::BVHNode>& nodes) -> f64 {
+		if (nodes.empty())
+			return 0.0;
+		const f64 rootArea = surfaceArea(nodes[0].aabb);
+		if (rootArea <= 0.0)
+			return 0.0;
+		f64 cost = 0.0;
+		std::vector<u32> stack{ 0 }; // walked from the root, collapsed leaves leave their old subtrees unreachable
+		while (!stack.empty()) {
+			const auto& node = nodes[stack.back()];
+			stack.pop_back();
+			if (node.left == INVALID_NODE_INDEX) {
+				const u32 primitives = (node.primitiveType & LEAF_RANGE_BIT) != 0 ? node.primitiveType & ~LEAF_RANGE_BIT : 1;
+				cost += surfaceArea(node.aabb) * SAH_INTERSECTION_COST * primitives;
+				continue;
+			}
+			cost += surfaceArea(node.aabb) * SAH_TRAVERSAL_COST;
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+		return cost / rootArea;
+	}
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS					// functions expect radians, not degrees
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE			// Depth buffer values will range from 0 to 1, not -1 to 1
+#include <glm/glm.hpp>
+
+#include "../utils/PrimitiveTypes.hpp"
+#include "../VulkanWrapper/SceneTypes.hpp"
+
+#include <vector>
+
+/*
+CPU version of the S1 compute passes (ModelSpaceToWorldSpace -> GetEnclosingAABB -> GenerateMortonCodes
+-> RadixSort -> ConstructHLBVH -> ConstructAABBsOfInternalNodes), producing the same node layout:
+internal nodes at [0, n - 2], root at 0, leaves at [n - 1, 2n - 2] in sorted morton order.
+*/
+namespace CPU {
+	constexpr const u32 INVALID_NODE_INDEX = 0; // INVALID_HLBVHNODE_INDEX
+	constexpr const u32 SPHERE_PRIMITIVE = 0;
+	constexpr const u32 TRIANGLE_PRIMITIVE = 1;
+	constexpr const u32 LEAF_RANGE_BIT = 0x80000000; // LEAF_RANGE_BIT, primitiveType of LeafCollapse leaves over that many primitives
+	// sah cost weights relative to one primitive test. the usual 1.2 : 1 from the bvh quality literature
+	constexpr const f64 SAH_TRAVERSAL_COST = 1.2;
+	constexpr const f64 SAH_INTERSECTION_COST = 1.0;
+
+	struct LBVH {
+		glm::vec3 enclosingMin; // padded bounds of the primitive centers, used to quantize morton codes
+		glm::vec3 enclosingMax;
+		std::vector<SceneTypes::GPU::MortonPrimitive> mortonPrimitives; // sorted by (codeHigh, code)
+		std::vector<SceneTypes::GPU::BVHNode> nodes;
+	};
+
+	// ModelSpaceToWorldSpace.comp. applies each primitive's model matrix in place
+	auto transformToWorldSpace(
+		const std::vector<SceneTypes::GPU::Model>& models,
+		std::vector<SceneTypes::GPU::Triangle>& triangles,
+		std::vector<SceneTypes::GPU::Sphere>& spheres
+	) -> void;
+
+	// expects world space primitives. mortonCodeBits is 30 or 63 (Config::mortonCodeBitsFor),
+	// mortonExtentBits 0-8 (Settings::mortonExtentBits)
+	auto buildLBVH(
+		const std::vector<SceneTypes::GPU::Triangle>& triangles,
+		const std::vector<SceneTypes::GPU::Sphere>& spheres,
+		u32 mortonCodeBits,
+		u32 mortonExtentBits
+	) -> LBVH;
+
+	// surface area heuristic cost of a tree in the LBVH node layout (root at 0, leaves have no children),
+	// expected cost of a random ray through the root's box. lower is better, comparable between trees of the same scene.
+	// LEAF_RANGE_BIT leaves count each of their primitives
+	auto sahCost(const std::vector<SceneTypes::GPU::BVHNode>& nodes) -> f64;
+	auto surfaceArea(const SceneTypes::GPU::AABB& box) -> f64;
+
+	auto getTriangleAABB(const SceneTypes::GPU::Triangle& triangle) -> SceneTypes::GPU::AABB;
+	auto getSphereAABB(const SceneTypes::GPU::Sphere& sphere) -> SceneTypes::GPU::AABB;
+	auto combineAABB(const SceneTypes::GPU::AABB& a, const SceneTypes::GPU::AABB& b) -> SceneTypes::GPU::AABB;
+	auto padAABB(SceneTypes::GPU::AABB& box) -> void;
+};
@@ -0,0 +1,165 @@
+#include "Presplit.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace CPU {
+	namespace {
+		constexpr const u32 SCALE_SEARCH_ITERATIONS = 48;
+
+		struct Corners {
+			glm::vec3 v0;
+			glm::vec3 v1;
+			glm::vec3 v2;
+		};
+
+		auto toWorld(const glm::mat4& modelToWorld, const glm::vec3& v) -> glm::vec3 {
+			return glm::vec3(modelToWorld * glm::vec4(v, 1.0f));
+		}
+
+		auto splitCount(const std::vector<f64>& priorities, f64 scale) -> u64 {
+			u64 total = 0;
+			for (const auto priority : priorities)
+				total += static_cast<u64>(scale * priority);
+			return total;
+		}
+
+		auto hasArea(const Corners& c) -> bool {
+			return glm::cross(c.v1 - c.v0, c.v2 - c.v0) != glm::vec3(0.0f);
+		}
+
+		// Karras & Aila's, the cube root so the largest triangles don't take the whole budget. degenerate triangles are
+		// lines that never hit, so cutting them buys nothing
+		auto excessPriority(const Corners& world) -> f64 {
+			if (!hasArea(world))
+				return 0.0;
+			return std::cbrt(presplitExcessArea(world.v0, world.v1, world.v2));
+		}
+
+		// cuts the triangle with the plane through the middle of its world box's longest axis, as early split clipping
+		// would its box: the lone vertex's side is a triangle, the other side a quad of two. the cut points are taken at
+		// the same edge fraction in model space, which the affine model matrix maps onto the world cut, and every piece
+		// keeps the winding so its normal matches the original. extraPieces beyond the cut go to the pieces by priority
+		auto clipSplit(const Corners& model, const Corners& world, u32 extraPieces, std::vector<SceneTypes::CPU::Triangle>& out) -> void {
+			const glm::vec3 lo = glm::min(glm::min(world.v0, world.v1), world.v2);
+			const glm::vec3 hi = glm::max(glm::max(world.v0, world.v1), world.v2);
+			const glm::vec3 extent = hi - lo;
+			const u32 axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+			const f32 plane = 0.5f * (lo[axis] + hi[axis]);
+			const bool below[3] = { world.v0[axis] < plane, world.v1[axis] < plane, world.v2[axis] < plane };
+			if (extraPieces < 2 || !hasArea(world) || (below[0] == below[1] && below[1] == below[2])) {
+				out.push_back({ model.v0, model.v1, model.v2 });
+				return;
+			}
+			// rotate so v0 is the vertex alone on its side
+			Corners m = model;
+			Corners w = world;
+			if (below[1] != below[0] && below[1] != below[2]) {
+				m = { model.v1, model.v2, model.v0 };
+				w = { world.v1, world.v2, world.v0 };
+			}
+			else if (below[2] != below[0] && below[2] != below[1]) {
+				m = { model.v2, model.v0, model.v1 };
+				w = { world.v2, world.v0, world.v1 };
+			}
+			const f32 t1 = (plane - w.v0[axis]) / (w.v1[axis] - w.v0[axis]);
+			const f32 t2 = (plane - w.v0[axis]) / (w.v2[axis] - w.v0[axis]);
+			const Corners modelCut = { m.v0 + t1 * (m.v1 - m.v0), m.v0 + t2 * (m.v2 - m.v0), {} };
+			const Corners worldCut = { w.v0 + t1 * (w.v1 - w.v0), w.v0 + t2 * (w.v2 - w.v0), {} };
+
+			const std::array<Corners, 3> modelPieces = { {
+				{ m.v0, modelCut.v0, modelCut.v1 },
+				{ modelCut.v0, m.v1, m.v2 },
+				{ modelCut.v0, m.v2, modelCut.v1 }
+			} };
+			const std::array<Corners, 3> worldPieces = { {
+				{ w.v0, worldCut.v0, worldCut.v1 },
+				{ worldCut.v0, w.v1, w.v2 },
+				{ worldCut.v0, w.v2, worldCut.v1 }
+			} };
+			std::array<f64, 3> priorities{};
+			f64 prioritySum = 0.0;
+			for (u32 i = 0; i < 3; i++) {
+				priorities[i] = excessPriority(worldPieces[i]);
+				prioritySum += priorities[i];
+			}
+			const u32 remaining = extraPieces - 2;
+			std::array<u32, 3> pieceExtra{};
+			u32 handedOut = 0;
+			for (u32 i = 0; i < 3; i++) {
+				pieceExtra[i] = prioritySum > 0.0 ? static_cast<u32>(remaining * (priorities[i] / prioritySum)) : 0;
+				handedOut += pieceExtra[i];
+			}
+			const u32 top = static_cast<u32>(std::max_element(priorities.begin(), priorities.end()) - priorities.begin());
+			pieceExtra[top] += remaining - handedOut;
+			for (u32 i = 0; i < 3; i++) {
+				if (hasArea(worldPieces[i])) // a vertex on the plane leaves one piece empty
+					clipSplit(modelPieces[i], worldPieces[i], pieceExtra[i], out);
+			}
+		}
+	}
+
+	auto presplitExcessArea(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) -> f64 {
+		const glm::vec3 extent = glm::max(glm::max(v0, v1), v2) - glm::min(glm::min(v0, v1), v2);
+		const f64 boxArea = 2.0 * (static_cast<f64>(extent.x) * extent.y + static_cast<f64>(extent.y) * extent.z + static_cast<f64>(extent.z) * extent.x);
+		const glm::vec3 doubleAreaNormal = glm::cross(v1 - v0, v2 - v0); // |n| is twice the triangle's area
+		// split forever and the pieces' boxes flatten onto the triangle, each axis seeing its projected area from both sides
+		const f64 idealArea = static_cast<f64>(std::abs(doubleAreaNormal.x)) + std::abs(doubleAreaNormal.y) + std::abs(doubleAreaNormal.z);
+		return std::max(boxArea - idealArea, 0.0);
+	}
+
+	auto presplitTriangles(const std::vector<PresplitObject>& objects, u32 budgetPercent) -> std::vector<std::vector<SceneTypes::CPU::Triangle>> {
+		std::vector<Corners> world;
+		for (const auto& object : objects) {
+			if (object.triangles == nullptr)
+				continue;
+			for (const auto& triangle : *object.triangles) {
+				world.push_back({
+					toWorld(object.modelToWorld, triangle.v0),
+					toWorld(object.modelToWorld, triangle.v1),
+					toWorld(object.modelToWorld, triangle.v2)
+				});
+			}
+		}
+
+		// Karras & Aila's extra weight for triangles crossing high level morton planes is left out, the tree isn't known yet
+		std::vector<f64> priorities(world.size());
+		f64 maxPriority = 0.0;
+		for (size_t i = 0; i < world.size(); i++) {
+			priorities[i] = excessPriority(world[i]);
+			maxPriority = std::max(maxPriority, priorities[i]);
+		}
+
+		// the largest scale whose floored cut counts fit the budget, each cut adding up to two pieces
+		const u64 budget = static_cast<u64>(world.size()) * budgetPercent / 100 / 2;
+		f64 scale = 0.0;
+		if (budget > 0 && maxPriority > 0.0) {
+			f64 lo = 0.0;
+			f64 hi = static_cast<f64>(budget) / maxPriority; // the top triangle alone would spend the budget
+			while (splitCount(priorities, hi) <= budget)
+				hi *= 2.0;
+			for (u32 iteration = 0; iteration < SCALE_SEARCH_ITERATIONS; iteration++) {
+				const f64 mid = 0.5 * (lo + hi);
+				if (splitCount(priorities, mid) <= budget)
+					lo = mid;
+				else
+					hi = mid;
+			}
+			scale = lo;
+		}
+
+		std::vector<std::vector<SceneTypes::CPU::Triangle>> split(objects.size());
+		size_t worldIndex = 0;
+		for (size_t o = 0; o < objects.size(); o++) {
+			if (objects[o].triangles == nullptr)
+				continue;
+			for (const auto& triangle : *objects[o].triangles) {
+				const u32 extraPieces = 2 * static_cast<u32>(scale * priorities[worldIndex]);
+				clipSplit({ triangle.v0, triangle.v1, triangle.v2 }, world[worldIndex], extraPieces, split[o]);
+				worldIndex++;
+			}
+		}
+		return split;
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "../utils/PrimitiveTypes.hpp"
+#include "../VulkanWrapper/SceneTypes.hpp"
+
+#include <vector>
+
+/*
+Triangle pre-splitting before any bvh build, in the spirit of early split clipping (Ernst & Greiner) with the budgeted
+priorities of Karras & Aila. Triangles whose world space box has much more surface area than the triangle could ever
+need (slivers, and large ones like the quad.obj walls) are cut at the middle of their box's longest axis, recursively,
+into smaller coplanar triangles over the same surface, so the leaves over them get tight boxes. The geometry is split
+rather than references to it, which keeps every builder, LeafCollapse and RefitBVH working on plain triangles. Only
+the hit barycentrics change, and nothing shades by them.
+*/
+namespace CPU {
+	struct PresplitObject { // one GameObject's triangles
+		const std::vector<SceneTypes::CPU::Triangle>* triangles; // model space, nullptr for spheres
+		glm::mat4 modelToWorld; // priorities and cut planes are chosen in world space, the pieces stay in model space
+	};
+
+	// adds budgetPercent of the total triangle count as extra pieces, shared out by priority. returns every object's
+	// triangles after splitting, in the order given (empty for spheres)
+	auto presplitTriangles(const std::vector<PresplitObject>& objects, u32 budgetPercent) -> std::vector<std::vector<SceneTypes::CPU::Triangle>>;
+	// surface area of the triangle's world box beyond what infinitely fine splitting would leave, 2 * area * |n|_1
+	auto presplitExcessArea(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) -> f64;
+}
@@ -0,0 +1,360 @@
+#include "ReferenceRaytracer.hpp"
+#include "BinnedSAH.hpp"
+
+#include "../Config.hpp"
+#include "../Scenes.hpp"
+#include "../utils/ImageIO.hpp"
+#include "../VulkanWrapper/Device.hpp"
+#include "../VulkanWrapper/RaytraceScene.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <random>
+
+namespace CPU {
+	namespace { // random.glsl
+		constexpr const f32 pi = 3.1415926535897932385f;
+
+		auto stepRNG(u32 rngState) -> u32 {
+			return rngState * 747796405u + 1u;
+		}
+		auto stepAndOutputRNGFloat(u32& rngState) -> f32 {
+			rngState = stepRNG(rngState);
+			u32 word = ((rngState >> ((rngState >> 28) + 4)) ^ rngState) * 277803737u;
+			word = (word >> 22) ^ word;
+			return static_cast<f32>(word) / 4294967295.0f;
+		}
+		auto pcgHash(u32 v) -> u32 {
+			const u32 state = v * 747796405u + 2891336453u;
+			const u32 word = ((state >> ((state >> 28) + 4)) ^ state) * 277803737u;
+			return (word >> 22) ^ word;
+		}
+		auto deterministicSeed(u32 x, u32 y, u32 imageWidth, u32 sampleIndex, u32 frameIndex, u32 userSeed) -> u32 {
+			u32 seed = pcgHash(userSeed);
+			seed = pcgHash(seed ^ frameIndex);
+			seed = pcgHash(seed ^ sampleIndex);
+			return pcgHash(seed ^ (y * imageWidth + x));
+		}
+		auto random(u32& rngState) -> f32 {
+			return stepAndOutputRNGFloat(rngState);
+		}
+		auto random(u32& rngState, f32 min, f32 max) -> f32 {
+			return min + (max - min) * random(rngState);
+		}
+		auto randomInUnitSphere(u32& rngState) -> glm::vec3 {
+			const f32 rho = random(rngState); // sequenced explicitly, glsl evaluates these in order too
+			const f32 theta = random(rngState, 0, 2 * pi);
+			const f32 phi = random(rngState, 0, pi);
+			return glm::vec3(rho * std::sin(phi) * std::cos(theta), rho * std::sin(phi) * std::sin(theta), rho * std::cos(phi));
+		}
+		auto randomUnitVector(u32& rngState) -> glm::vec3 {
+			return glm::normalize(randomInUnitSphere(rngState));
+		}
+
+		// shader constants
+		constexpr const f32 FOCAL_DISTANCE = 10.0f;
+		const glm::vec3 BACKGROUND_COLOR = glm::vec3(0);
+		constexpr const u32 MAX_STACK_DEPTH = 128;
+		constexpr const u32 LIGHT_MATERIAL = static_cast<u32>(SceneTypes::MaterialType::LIGHT);
+		constexpr const u32 DIFFUSE_MATERIAL = static_cast<u32>(SceneTypes::MaterialType::DIFFUSE);
+
+		auto AABBhitCheck(const glm::vec3& origin, const glm::vec3& direction, const SceneTypes::GPU::AABB& box) -> bool {
+			const glm::vec3 tMin = (glm::vec3(box.minX, box.minY, box.minZ) - origin) / direction;
+			const glm::vec3 tMax = (glm::vec3(box.maxX, box.maxY, box.maxZ) - origin) / direction;
+			const glm::vec3 t1 = glm::min(tMin, tMax);
+			const glm::vec3 t2 = glm::max(tMin, tMax);
+			const f32 tNear = std::max(std::max(t1.x, t1.y), t1.z);
+			const f32 tFar = std::min(std::min(t2.x, t2.y), t2.z);
+			return tNear < tFar;
+		}
+	}
+
+	struct ReferenceRaytracer::FrameConstants {
+		glm::vec3 camPos;
+		glm::vec3 pixel00Location;
+		glm::vec3 pixelDeltaU;
+		glm::vec3 pixelDeltaV;
+		u32 maxRaytraceDepth;
+		u32 raysPerPixel;
+		ReferenceSeed seed;
+	};
+
+	ReferenceRaytracer::ReferenceRaytracer(
+		const std::vector<SceneTypes::GPU::Model>& models,
+		const std::vector<SceneTypes::GPU::Triangle>& triangles,
+		const std::vector<SceneTypes::GPU::Sphere>& spheres,
+		const std::vector<SceneTypes::GPU::Material>& materials,
+		u32 threadCount
+	) :
+		triangles{ triangles },
+		spheres{ spheres },
+		materials{ materials },
+		scheduler{ threadCount }
+	{
+		transformToWorldSpace(models, this->triangles, this->spheres);
+		this->bvh = buildLBVH(
+			this->triangles, this->spheres,
+			Config::mortonCodeBitsFor(static_cast<u32>(this->triangles.size() + this->spheres.size())),
+			Config::get().mortonExtentBits
+		);
+	}
+
+	auto ReferenceRaytracer::renderFrame(
+		const ReferenceCamera& camera, u32 width, u32 height, u32 raysPerPixel, u32 maxRaytraceDepth, const ReferenceSeed& seed
+	) -> f64 {
+		const auto start = std::chrono::high_resolution_clock::now();
+		this->width = width;
+		this->height = height;
+		this->image.assign(static_cast<size_t>(width) * height, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)); // S1's vkCmdClearColorImage
+
+		// camera basis, same as the globals at the top of raytraceBVH.comp
+		const f32 aspectRatio = static_cast<f32>(width) / static_cast<f32>(height);
+		const f32 h = std::tan(glm::radians(camera.verticalFOV) / 2);
+		const f32 viewportHeight = 2.0f * h * FOCAL_DISTANCE;
+		const f32 viewportWidth = viewportHeight * aspectRatio;
+		const glm::vec3 camW = glm::normalize(camera.position - camera.lookAt);
+		const glm::vec3 camU = glm::normalize(glm::cross(camera.upDir, camW));
+		const glm::vec3 camV = glm::cross(camW, camU);
+		const glm::vec3 viewportU = viewportWidth * camU;
+		const glm::vec3 viewportV = viewportHeight * -camV;
+
+		FrameConstants frame{};
+		frame.camPos = camera.position;
+		frame.pixelDeltaU = viewportU / static_cast<f32>(width);
+		frame.pixelDeltaV = viewportV / static_cast<f32>(height);
+		const glm::vec3 viewportUpperLeft = camera.position - (FOCAL_DISTANCE * camW) - (viewportU / 2.0f) - (viewportV / 2.0f);
+		frame.pixel00Location = viewportUpperLeft + 0.5f * (frame.pixelDeltaU + frame.pixelDeltaV);
+		frame.maxRaytraceDepth = maxRaytraceDepth;
+		frame.raysPerPixel = raysPerPixel;
+		frame.seed = seed;
+
+		const u32 tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+		const u32 tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+		this->scheduler.parallelFor(tilesX * tilesY, [&](u32 tile, u32) {
+			const u32 x0 = (tile % tilesX) * TILE_SIZE;
+			const u32 y0 = (tile / tilesX) * TILE_SIZE;
+			for (u32 y = y0; y < std::min(y0 + TILE_SIZE, height); y++) {
+				for (u32 x = x0; x < std::min(x0 + TILE_SIZE, width); x++)
+					this->tracePixel(frame, x, y);
+			}
+		});
+		return std::chrono::duration<f64, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	auto ReferenceRaytracer::getImageAsFloats() const -> std::vector<f32> {
+		std::vector<f32> rgba(this->image.size() * 4);
+		for (size_t i = 0; i < this->image.size(); i++) {
+			for (u32 c = 0; c < 4; c++)
+				rgba[i * 4 + c] = this->image[i][c];
+		}
+		return rgba;
+	}
+
+	// every rays per pixel dispatch of main() for one pixel. pixels don't depend on each other, so doing all
+	// passes of a pixel back to back gives the same result as the gpu's pass by pass order
+	auto ReferenceRaytracer::tracePixel(const FrameConstants& frame, u32 x, u32 y) -> void {
+		auto& texel = this->image[static_cast<size_t>(y) * this->width + x]; // each tile owns its texels, no locking needed
+		for (u32 pass = 0; pass < frame.raysPerPixel; pass++) {
+			u32 rngState;
+			if (frame.seed.deterministic) {
+				rngState = deterministicSeed(x, y, this->width, pass, frame.seed.frameIndex, frame.seed.userSeed);
+			}
+			else {
+				rngState = (600 * x + y) * (frame.seed.randomState + 1);
+				// float -> uint out of range is undefined in both glsl and c++. alpha starts at 1.0 after the clear,
+				// which rounds past UINT_MAX, so saturate like gpu drivers do
+				const f32 scaledAlpha = texel.w * 4294967294.0f;
+				rngState += scaledAlpha >= 4294967295.0f ? 0xFFFFFFFFu : static_cast<u32>(scaledAlpha);
+				// the shader calls stepRNG(rngState) here and drops the result, so nothing to mirror
+			}
+			const f32 nextRandom = random(rngState);
+
+			const glm::vec3 pixelSample = frame.pixel00Location
+				+ (static_cast<f32>(x) * frame.pixelDeltaU)
+				+ (static_cast<f32>(y) * frame.pixelDeltaV);
+			const Ray r{ frame.camPos, glm::normalize(pixelSample - frame.camPos) };
+
+			const glm::vec3 pixelColor = this->rayColor(frame, r, rngState);
+			texel = glm::vec4(pixelColor + glm::vec3(texel), nextRandom);
+		}
+	}
+
+	auto ReferenceRaytracer::rayColor(const FrameConstants& frame, const Ray& r, u32& rngState) const -> glm::vec3 {
+		HitRecord rec{};
+		glm::vec3 color{ 0 };
+		glm::vec3 globalAttenuation{ 1 };
+		Ray curr{ r.origin, glm::normalize(r.direction) };
+		for (u32 i = 0; i < frame.maxRaytraceDepth; i++) {
+			if (!this->hitBVH(curr, 0.001f, 10000000.0f, rec)) {
+				color += BACKGROUND_COLOR * globalAttenuation;
+				break;
+			}
+			const auto& material = this->materials[rec.materialIndex];
+			const u32 materialType = static_cast<u32>(material.materialType);
+			if (materialType == LIGHT_MATERIAL) // emitted
+				color += material.albedo * globalAttenuation;
+			if (materialType != DIFFUSE_MATERIAL) // scatter. only diffuse scatters
+				break;
+			globalAttenuation *= material.albedo;
+			curr = Ray{ rec.p, glm::normalize(rec.normal + randomUnitVector(rngState)) };
+		}
+		return color;
+	}
+
+	auto ReferenceRaytracer::hitBVH(const Ray& r, f32 tMin, f32 tMax, HitRecord& rec) const -> bool {
+		if (this->bvh.nodes.empty())
+			return false;
+		bool hit = false;
+		f32 closestSoFar = tMax;
+
+		u32 stack[MAX_STACK_DEPTH];
+		u32 toVisitOffset = 0;
+		u32 currentNodeIndex = 0;
+		while (true) {
+			const auto& node = this->bvh.nodes[currentNodeIndex];
+			if (AABBhitCheck(r.origin, r.direction, node.aabb)) {
+				if (node.left == INVALID_NODE_INDEX && node.right == INVALID_NODE_INDEX) { // leaf
+					if (node.primitiveType == SPHERE_PRIMITIVE) {
+						if (this->sphereHit(node.primitiveIndex, r, tMin, closestSoFar, rec)) {
+							hit = true;
+							closestSoFar = rec.t;
+						}
+					}
+					else if (node.primitiveType == TRIANGLE_PRIMITIVE) {
+						if (this->triangleHit(node.primitiveIndex, r, tMin, closestSoFar, rec)) {
+							hit = true;
+							closestSoFar = rec.t;
+						}
+					}
+					if (toVisitOffset == 0)
+						break;
+					currentNodeIndex = stack[--toVisitOffset];
+				}
+				else { // internal, right first then left
+					stack[toVisitOffset++] = node.left;
+					currentNodeIndex = node.right;
+				}
+			}
+			else {
+				if (toVisitOffset == 0)
+					break;
+				currentNodeIndex = stack[--toVisitOffset];
+			}
+		}
+		return hit;
+	}
+
+	auto ReferenceRaytracer::triangleHit(u32 triangleIndex, const Ray& r, f32 tMin, f32 tMax, HitRecord& rec) const -> bool {
+		const auto& tri = this->triangles[triangleIndex];
+		const glm::vec3 u = tri.v1 - tri.v0;
+		const glm::vec3 v = tri.v2 - tri.v0;
+		const glm::vec3 triNormalUnnormalized = glm::cross(u, v);
+		const glm::vec3 triNormal = glm::normalize(triNormalUnnormalized);
+		const f32 D = glm::dot(triNormal, tri.v0);
+		const glm::vec3 w = triNormalUnnormalized / glm::dot(triNormalUnnormalized, triNormalUnnormalized);
+		const f32 denom = glm::dot(triNormal, r.direction);
+		if (std::abs(denom) < 0.0001f)
+			return false;
+
+		const f32 t = (D - glm::dot(triNormal, r.origin)) / denom;
+		if (t < tMin || t > tMax)
+			return false;
+
+		const glm::vec3 possIntersectionPoint = r.origin + t * r.direction;
+		const glm::vec3 pointOnPlane = possIntersectionPoint - tri.v0;
+		const f32 a = glm::dot(w, glm::cross(pointOnPlane, v));
+		const f32 b = glm::dot(w, glm::cross(u, pointOnPlane));
+		if (a < 0 || b < 0 || a + b > 1)
+			return false;
+
+		rec.t = t;
+		rec.p = possIntersectionPoint;
+		rec.u = a;
+		rec.v = b;
+		rec.normal = triNormal;
+		rec.backFaceInt = glm::dot(r.direction, rec.normal) > 0 ? 1 : 0;
+		rec.normal *= static_cast<f32>(1 - 2 * rec.backFaceInt);
+		rec.materialIndex = tri.materialIndex;
+		return true;
+	}
+
+	auto ReferenceRaytracer::sphereHit(u32 sphereIndex, const Ray& r, f32 tMin, f32 tMax, HitRecord& rec) const -> bool {
+		const auto& s = this->spheres[sphereIndex];
+		const glm::vec3 oc = r.origin - s.center;
+		const f32 a = glm::dot(r.direction, r.direction);
+		const f32 halfB = glm::dot(oc, r.direction);
+		const f32 c = glm::dot(oc, oc) - (s.radius * s.radius);
+		const f32 underRadical = (halfB * halfB) - (a * c);
+		if (underRadical < 0)
+			return false;
+
+		const f32 radical = std::sqrt(underRadical);
+		f32 root = (-halfB - radical) / a;
+		if (root < tMin || root > tMax) {
+			root = (-halfB + radical) / a;
+			if (root < tMin || root > tMax)
+				return false;
+		}
+
+		rec.t = root;
+		rec.p = r.origin + rec.t * r.direction;
+		rec.u = (std::atan2(-s.center.z, s.center.x) + pi) / (2 * pi); // uses the center like the shader does
+		rec.v = std::acos(-s.center.y) / pi;
+		rec.normal = (rec.p - s.center) / s.radius;
+		rec.backFaceInt = glm::dot(r.direction, rec.normal) > 0 ? 1 : 0;
+		rec.normal *= static_cast<f32>(1 - 2 * rec.backFaceInt);
+		rec.materialIndex = s.materialIndex;
+		return true;
+	}
+
+	auto renderReference(const std::string& sceneName, u32 width, u32 height, u32 frames, u32 threadCount, const std::string& outputPath) -> void {
+		Device device{}; // declared first so the scene's buffers are destroyed before it
+		auto scene = std::make_unique<RaytraceScene>(device);
+		findScene(sceneName)(scene);
+		if (Config::get().raysPerPixel > 0)
+			scene->setRaysPerPixel(Config::get().raysPerPixel);
+		if (Config::get().maxRaytraceDepth > 0)
+			scene->setMaxRaytraceDepth(Config::get().maxRaytraceDepth);
+
+		ReferenceRaytracer reference{
+			scene->getHostModels(), scene->getHostTriangles(), scene->getHostSpheres(), scene->getHostMaterials(), threadCount
+		};
+		std::cout << std::format(
+			"CPU reference lbvh: {} nodes, sah cost {:.2f}\n", reference.getBVH().nodes.size(), sahCost(reference.getBVH().nodes)
+		);
+		{ // what bvhBuilder=sah would upload instead, for comparison
+			auto triangles = scene->getHostTriangles();
+			auto spheres = scene->getHostSpheres();
+			transformToWorldSpace(scene->getHostModels(), triangles, spheres);
+			Util::WorkStealingScheduler scheduler{ threadCount };
+			const auto start = std::chrono::high_resolution_clock::now();
+			const auto nodes = buildBinnedSAH(triangles, spheres, scheduler);
+			const f64 buildMs = std::chrono::duration<f64, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			std::cout << std::format("CPU reference binned sah: {} nodes, sah cost {:.2f}, built in {:.3f}ms\n", nodes.size(), sahCost(nodes), buildMs);
+		}
+		ReferenceCamera camera{};
+		camera.verticalFOV = scene->getCamera().getVerticalFOV();
+		const u32 raysPerPixel = scene->getRaysPerPixel();
+		const u32 maxRaytraceDepth = scene->getMaxRaytraceDepth();
+
+		const auto& settings = Config::get();
+		std::mt19937 gen{
+			settings.deterministicSeeding
+				? settings.seed
+				: static_cast<u32>(std::chrono::system_clock::now().time_since_epoch().count())
+		};
+		for (u32 i = 0; i < frames; i++) {
+			ReferenceSeed seed{ static_cast<u32>(gen()), i, settings.seed, settings.deterministicSeeding };
+			const f64 frameMs = reference.renderFrame(camera, width, height, raysPerPixel, maxRaytraceDepth, seed);
+			const f64 primaryRays = static_cast<f64>(width) * height * raysPerPixel;
+			std::cout << std::format(
+				"CPU reference frame {}: {:.3f}ms, {:.2f} Mrays/s on {} threads ({} x {}, rpp {}, depth {})\n",
+				i, frameMs, primaryRays / (frameMs * 1000.0), reference.getThreadCount(), width, height, raysPerPixel, maxRaytraceDepth
+			);
+		}
+		Util::writeAccumulatedImage(outputPath, width, height, reference.getImageAsFloats(), raysPerPixel);
+		std::cout << std::format("wrote {}x{} image to {}\n", width, height, outputPath);
+	}
+};
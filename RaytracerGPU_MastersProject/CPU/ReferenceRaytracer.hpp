@@ -0,0 +1,93 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS					// functions expect radians, not degrees
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE			// Depth buffer values will range from 0 to 1, not -1 to 1
+#include <glm/glm.hpp>
+
+#include "../utils/PrimitiveTypes.hpp"
+#include "../utils/WorkStealingScheduler.hpp"
+#include "../VulkanWrapper/SceneTypes.hpp"
+#include "LBVH.hpp"
+
+#include <string>
+#include <vector>
+
+/*
+CPU path tracer running the same algorithm as raytraceBVH.comp: same camera setup, hit math, materials,
+bvh traversal and pcg rng (random.glsl), including the rng being reseeded from the image alpha each pass.
+Meant as a baseline on hosts without a gpu and as ground truth when checking gpu output. Results match
+the gpu statistically, not bit for bit (transcendentals and fma contraction differ).
+Tiles of the image are spread across cores with Util::WorkStealingScheduler.
+*/
+namespace CPU {
+	struct ReferenceCamera { // defaults are the fixed camera RaytracerBVH puts in its ubo
+		glm::vec3 position{ 275.0f, 275.0f, -800.0f };
+		glm::vec3 lookAt{ 275.0f, 275.0f, 0.0f };
+		glm::vec3 upDir{ 0.0f, 1.0f, 0.0f };
+		f32 verticalFOV = 40.0f;
+	};
+
+	struct ReferenceSeed { // the seeding fields of the raytrace ubo
+		u32 randomState = 0;
+		u32 frameIndex = 0;
+		u32 userSeed = 0;
+		bool deterministic = false;
+	};
+
+	class ReferenceRaytracer {
+		static constexpr const u32 TILE_SIZE = 16;
+
+		// world space copies. host vectors are in model space, like the gpu buffers before S1
+		std::vector<SceneTypes::GPU::Triangle> triangles;
+		std::vector<SceneTypes::GPU::Sphere> spheres;
+		std::vector<SceneTypes::GPU::Material> materials;
+		LBVH bvh;
+
+		Util::WorkStealingScheduler scheduler;
+
+		u32 width = 0;
+		u32 height = 0;
+		std::vector<glm::vec4> image; // same contents as computeImage: summed color, alpha = next rng seed
+
+		struct Ray {
+			glm::vec3 origin;
+			glm::vec3 direction;
+		};
+		struct HitRecord {
+			glm::vec3 p;
+			glm::vec3 normal;
+			u32 materialIndex;
+			f32 t;
+			i32 backFaceInt;
+			f32 u;
+			f32 v;
+		};
+		struct FrameConstants; // per frame camera basis, the shader's _ globals
+
+		auto tracePixel(const FrameConstants& frame, u32 x, u32 y) -> void;
+		auto rayColor(const FrameConstants& frame, const Ray& r, u32& rngState) const -> glm::vec3;
+		auto hitBVH(const Ray& r, f32 tMin, f32 tMax, HitRecord& rec) const -> bool;
+		auto triangleHit(u32 triangleIndex, const Ray& r, f32 tMin, f32 tMax, HitRecord& rec) const -> bool;
+		auto sphereHit(u32 sphereIndex, const Ray& r, f32 tMin, f32 tMax, HitRecord& rec) const -> bool;
+	public:
+		ReferenceRaytracer(
+			const std::vector<SceneTypes::GPU::Model>& models,
+			const std::vector<SceneTypes::GPU::Triangle>& triangles,
+			const std::vector<SceneTypes::GPU::Sphere>& spheres,
+			const std::vector<SceneTypes::GPU::Material>& materials,
+			u32 threadCount = 0 // 0 = every core
+		);
+
+		// one doIteration worth of work: clear the image, then raysPerPixel accumulating passes. returns wall time in ms
+		auto renderFrame(const ReferenceCamera& camera, u32 width, u32 height, u32 raysPerPixel, u32 maxRaytraceDepth, const ReferenceSeed& seed) -> f64;
+
+		auto getImage() const -> const std::vector<glm::vec4>& { return this->image; }
+		auto getImageAsFloats() const -> std::vector<f32>; // rgba, same layout readComputeImage returns
+		auto getBVH() const -> const LBVH& { return this->bvh; }
+		auto getThreadCount() const -> u32 { return this->scheduler.getThreadCount(); }
+	};
+
+	// Programs::CPUReference. builds the named scene (a headless device is still needed to construct RaytraceScene),
+	// renders it on the cpu and writes the result like RaytracerBVH::renderHeadless
+	auto renderReference(const std::string& sceneName, u32 width, u32 height, u32 frames, u32 threadCount, const std::string& outputPath) -> void;
+};
@@ -0,0 +1,93 @@
+#include "TwoLevelBVH.hpp"
+#include "BinnedSAH.hpp"
+#include "LBVH.hpp"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace CPU {
+	namespace {
+		// box around the 8 transformed corners, loose for rotations but never missing anything
+		auto transformAABB(const SceneTypes::GPU::AABB& box, const glm::mat4& matrix) -> SceneTypes::GPU::AABB {
+			SceneTypes::GPU::AABB transformed{ FLT_MAX, -FLT_MAX, FLT_MAX, -FLT_MAX, FLT_MAX, -FLT_MAX };
+			for (u32 corner = 0; corner < 8; corner++) {
+				const glm::vec4 point = matrix * glm::vec4(
+					(corner & 1) ? box.maxX : box.minX,
+					(corner & 2) ? box.maxY : box.minY,
+					(corner & 4) ? box.maxZ : box.minZ,
+					1.0f
+				);
+				transformed.minX = std::min(transformed.minX, point.x);
+				transformed.maxX = std::max(transformed.maxX, point.x);
+				transformed.minY = std::min(transformed.minY, point.y);
+				transformed.maxY = std::max(transformed.maxY, point.y);
+				transformed.minZ = std::min(transformed.minZ, point.z);
+				transformed.maxZ = std::max(transformed.maxZ, point.z);
+			}
+			return transformed;
+		}
+	}
+
+	auto TwoLevelBVH::addBLAS(
+		const std::vector<SceneTypes::CPU::Instance>& instances,
+		const std::vector<SceneTypes::GPU::Triangle>& triangles,
+		const std::vector<SceneTypes::GPU::Sphere>& spheres,
+		Util::WorkStealingScheduler& scheduler
+	) -> bool {
+		bool built = false;
+		for (const auto& instance : instances) {
+			if (instance.primitiveCount == 0 || this->blasCache.contains(instance.model))
+				continue;
+			std::vector<SceneTypes::GPU::Triangle> blasTriangles;
+			std::vector<SceneTypes::GPU::Sphere> blasSpheres;
+			if (instance.triangles)
+				blasTriangles.assign(triangles.begin() + instance.firstPrimitive, triangles.begin() + instance.firstPrimitive + instance.primitiveCount);
+			else
+				blasSpheres.push_back(spheres[instance.firstPrimitive]);
+			const auto nodes = buildBinnedSAH(blasTriangles, blasSpheres, scheduler);
+
+			const u32 offset = static_cast<u32>(this->blasNodes.size());
+			for (auto node : nodes) {
+				if (node.left == INVALID_NODE_INDEX) { // leaf, back to the scene buffer's index
+					node.primitiveIndex += instance.firstPrimitive;
+				}
+				else { // no BLAS root is anyone's child, so an offset child is never mistaken for INVALID_NODE_INDEX
+					node.left += offset;
+					node.right += offset;
+				}
+				this->blasNodes.push_back(node);
+			}
+			this->blasCache.emplace(instance.model, BLAS{ offset, nodes[0].aabb });
+			built = true;
+		}
+		return built;
+	}
+
+	auto TwoLevelBVH::buildTLAS(
+		const std::vector<SceneTypes::CPU::Instance>& instances,
+		const std::vector<SceneTypes::GPU::Model>& models,
+		Util::WorkStealingScheduler& scheduler,
+		std::vector<SceneTypes::GPU::Instance>& gpuInstances
+	) const -> std::vector<SceneTypes::GPU::BVHNode> {
+		gpuInstances.clear();
+		std::vector<SceneTypes::GPU::AABB> boxes;
+		for (const auto& instance : instances) {
+			const auto blas = this->blasCache.find(instance.model);
+			if (blas == this->blasCache.end())
+				continue; // no primitives
+			const glm::mat4& modelMatrix = models[instance.modelIndex].modelMatrix;
+			gpuInstances.push_back({
+				glm::inverse(modelMatrix),
+				blas->second.root,
+				instance.materialIndex,
+				instance.modelIndex,
+				0
+			});
+			boxes.push_back(transformAABB(blas->second.bounds, modelMatrix));
+		}
+		auto nodes = buildBinnedSAH(boxes, INSTANCE_PRIMITIVE, scheduler);
+		if (nodes.empty()) // inverted box, fails every slab test
+			nodes.push_back({ { FLT_MAX, -FLT_MAX, FLT_MAX, -FLT_MAX, FLT_MAX, -FLT_MAX }, INVALID_NODE_INDEX, INVALID_NODE_INDEX, 0, INSTANCE_PRIMITIVE });
+		return nodes;
+	}
+};
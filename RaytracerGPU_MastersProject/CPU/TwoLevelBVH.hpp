@@ -0,0 +1,50 @@
+#pragma once
+
+#include "../utils/PrimitiveTypes.hpp"
+#include "../utils/WorkStealingScheduler.hpp"
+#include "../VulkanWrapper/SceneTypes.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+/*
+Two level acceleration structure for BVHBuilder::TwoLevel. Every distinct RTModel gets a bottom level BVH
+(buildBinnedSAH in model space) the first time an instance of it is seen, cached and shared by every GameObject
+made from it. BLAS are concatenated into one node array (uploaded once into HLBVHNodesBuffer), each in buildLBVH's
+layout offset to its root, leaves indexing the first instance's primitives in the scene's model space buffers.
+The top level is rebuilt from the instances' transformed BLAS bounds every frame, so moving a rigid object costs
+O(instances) rather than a rebuild over every primitive.
+*/
+namespace CPU {
+	constexpr const u32 INSTANCE_PRIMITIVE = 2; // INSTANCE_PRIMITIVE, TLAS leaves. primitiveIndex is the instance
+
+	class TwoLevelBVH {
+		struct BLAS {
+			u32 root; // into blasNodes
+			SceneTypes::GPU::AABB bounds; // model space
+		};
+
+		std::unordered_map<const void*, BLAS> blasCache; // by RTModel
+		std::vector<SceneTypes::GPU::BVHNode> blasNodes;
+	public:
+		// builds the BLAS of every instance's model that isn't cached yet, from the model space primitives.
+		// returns whether any was built, so the BLAS nodes need uploading again
+		auto addBLAS(
+			const std::vector<SceneTypes::CPU::Instance>& instances,
+			const std::vector<SceneTypes::GPU::Triangle>& triangles,
+			const std::vector<SceneTypes::GPU::Sphere>& spheres,
+			Util::WorkStealingScheduler& scheduler
+		) -> bool;
+		auto getBLASNodes() const -> const std::vector<SceneTypes::GPU::BVHNode>& { return this->blasNodes; }
+
+		// TLAS over the world space bounds of every instance with a BLAS, in the LBVH node layout with INSTANCE_PRIMITIVE
+		// leaves indexing gpuInstances, which is refilled alongside. never empty, a scene without instances gets one
+		// node no ray hits
+		auto buildTLAS(
+			const std::vector<SceneTypes::CPU::Instance>& instances,
+			const std::vector<SceneTypes::GPU::Model>& models,
+			Util::WorkStealingScheduler& scheduler,
+			std::vector<SceneTypes::GPU::Instance>& gpuInstances
+		) const -> std::vector<SceneTypes::GPU::BVHNode>;
+	};
+};
@@ -0,0 +1,338 @@
+#include "Config.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+
+namespace Config {
+	namespace {
+		Settings settings{};
+
+		struct Option {
+			const char* name;
+			const char* description;
+			std::function<void(Settings&, const std::string&)> set;
+			std::function<std::string(const Settings&)> show;
+		};
+
+		constexpr const std::array<Programs, 7> programs = {
+			Programs::LogisticMap, Programs::Raytracer, Programs::RaytracerBVH,
+			Programs::RaytracerBVHBenchmark, Programs::CPUReference, Programs::ImageRegression,
+			Programs::RadixSortBenchmark
+		};
+
+		auto trim(const std::string& text) -> std::string {
+			const auto first = text.find_first_not_of(" \t\r\n");
+			if (first == std::string::npos)
+				return "";
+			const auto last = text.find_last_not_of(" \t\r\n");
+			return text.substr(first, last - first + 1);
+		}
+		auto split(const std::string& text, char separator) -> std::vector<std::string> {
+			std::vector<std::string> parts;
+			size_t start = 0;
+			while (true) {
+				const auto end = text.find(separator, start);
+				const auto part = trim(text.substr(start, end == std::string::npos ? std::string::npos : end - start));
+				if (!part.empty())
+					parts.push_back(part);
+				if (end == std::string::npos)
+					return parts;
+				start = end + 1;
+			}
+		}
+		auto join(const std::vector<std::string>& parts) -> std::string {
+			std::string joined;
+			for (size_t i = 0; i < parts.size(); i++)
+				joined += (i > 0 ? "," : "") + parts[i];
+			return joined;
+		}
+
+		auto parseU32(const char* name, const std::string& value) -> u32 {
+			u32 result = 0;
+			const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+			if (error != std::errc() || end != value.data() + value.size())
+				throw std::runtime_error(std::format("{} expects an unsigned integer, got \"{}\"", name, value));
+			return result;
+		}
+		auto parseBool(const char* name, const std::string& value) -> bool {
+			if (value == "1" || value == "true" || value == "on")
+				return true;
+			if (value == "0" || value == "false" || value == "off")
+				return false;
+			throw std::runtime_error(std::format("{} expects 1/0, true/false or on/off, got \"{}\"", name, value));
+		}
+
+		auto u32Option(const char* name, u32 Settings::* member, const char* description) -> Option {
+			return {
+				name, description,
+				[name, member](Settings& s, const std::string& value) { s.*member = parseU32(name, value); },
+				[member](const Settings& s) { return std::to_string(s.*member); }
+			};
+		}
+		auto boolOption(const char* name, bool Settings::* member, const char* description) -> Option {
+			return {
+				name, description,
+				[name, member](Settings& s, const std::string& value) { s.*member = parseBool(name, value); },
+				[member](const Settings& s) { return std::string(s.*member ? "true" : "false"); }
+			};
+		}
+		auto stringOption(const char* name, std::string Settings::* member, const char* description) -> Option {
+			return {
+				name, description,
+				[member](Settings& s, const std::string& value) { s.*member = value; },
+				[member](const Settings& s) { return s.*member; }
+			};
+		}
+		auto levelOption(const char* name, Util::Telemetry::Level Settings::* member, const char* description) -> Option {
+			return {
+				name, description,
+				[member](Settings& s, const std::string& value) { s.*member = Util::Telemetry::parseLevel(value); },
+				[member](const Settings& s) { return std::string(Util::Telemetry::levelName(s.*member)); }
+			};
+		}
+		auto stringListOption(const char* name, std::vector<std::string> Settings::* member, const char* description) -> Option {
+			return {
+				name, description,
+				[member](Settings& s, const std::string& value) { s.*member = split(value, ','); },
+				[member](const Settings& s) { return join(s.*member); }
+			};
+		}
+		auto u32ListOption(const char* name, std::vector<u32> Settings::* member, const char* description) -> Option {
+			return {
+				name, description,
+				[name, member](Settings& s, const std::string& value) {
+					(s.*member).clear();
+					for (const auto& part : split(value, ','))
+						(s.*member).push_back(parseU32(name, part));
+				},
+				[member](const Settings& s) {
+					std::vector<std::string> parts;
+					for (const auto v : s.*member)
+						parts.push_back(std::to_string(v));
+					return join(parts);
+				}
+			};
+		}
+		auto resolutionListOption(const char* name, std::vector<std::array<u32, 2>> Settings::* member, const char* description) -> Option {
+			return {
+				name, description,
+				[name, member](Settings& s, const std::string& value) {
+					(s.*member).clear();
+					for (const auto& part : split(value, ',')) {
+						const auto size = split(part, 'x');
+						if (size.size() != 2)
+							throw std::runtime_error(std::format("{} expects WIDTHxHEIGHT entries, got \"{}\"", name, part));
+						(s.*member).push_back({ parseU32(name, size[0]), parseU32(name, size[1]) });
+					}
+				},
+				[member](const Settings& s) {
+					std::vector<std::string> parts;
+					for (const auto& r : s.*member)
+						parts.push_back(std::format("{}x{}", r[0], r[1]));
+					return join(parts);
+				}
+			};
+		}
+
+		auto options() -> const std::vector<Option>& {
+			static const std::vector<Option> table = {
+				{
+					"program", "LogisticMap, Raytracer, RaytracerBVH, RaytracerBVHBenchmark, CPUReference, ImageRegression or RadixSortBenchmark",
+					[](Settings& s, const std::string& value) {
+						for (const auto program : programs) {
+							if (value == programName(program)) {
+								s.program = program;
+								return;
+							}
+						}
+						throw std::runtime_error(std::format("unknown program \"{}\"", value));
+					},
+					[](const Settings& s) { return std::string(programName(s.program)); }
+				},
+				stringOption("scene", &Settings::scene, "scene name from Scenes.cpp"),
+				u32Option("width", &Settings::width, "window width, or image width when headless"),
+				u32Option("height", &Settings::height, "window height, or image height when headless"),
+				u32Option("raysPerPixel", &Settings::raysPerPixel, "0 keeps the scene's value"),
+				u32Option("maxRaytraceDepth", &Settings::maxRaytraceDepth, "0 keeps the scene's value"),
+				boolOption("headless", &Settings::headless, "render offscreen and write the image to outputPath"),
+				u32Option("frames", &Settings::frames, "frames to render when headless or on the cpu"),
+				stringOption("outputPath", &Settings::outputPath, ".ppm, or .pfm for linear float radiance"),
+				u32Option("threadCount", &Settings::threadCount, "CPUReference and bvhBuilder=sah worker threads, 0 = every core"),
+				boolOption("deterministicSeeding", &Settings::deterministicSeeding, "seed samples and scenes from seed for reproducible images"),
+				u32Option("seed", &Settings::seed, "user seed for deterministicSeeding"),
+				levelOption("logLevel", &Settings::logLevel, "console output: off, error, info, frame or debug"),
+				levelOption("telemetryLevel", &Settings::telemetryLevel, "telemetryPath output, same levels as logLevel"),
+				stringOption("telemetryPath", &Settings::telemetryPath, "chrome trace json, or csv when it ends in .csv"),
+				u32Option("mortonCodeBits", &Settings::mortonCodeBits, "30, 63, or 0 to pick by primitive count"),
+				u32Option("wideMortonCodeMinPrimitives", &Settings::wideMortonCodeMinPrimitives, "primitive count from which mortonCodeBits=0 uses 63 bit codes"),
+				u32Option("treeletOptimizationRounds", &Settings::treeletOptimizationRounds, "treelet restructuring passes after the bvh build, 0 = off"),
+				stringOption("bvhBuilder", &Settings::bvhBuilder, "scene, lbvh, ploc, sah (binned sah on the cpu, static scenes) or twolevel (per model blas, per frame tlas)"),
+				u32Option("plocSearchRadius", &Settings::plocSearchRadius, "ploc neighbours searched either side of each cluster, 1-32"),
+				u32Option("plocMaxIterations", &Settings::plocMaxIterations, "ploc clustering iterations recorded per build"),
+				u32Option("bvhWidth", &Settings::bvhWidth, "2 traces the binary bvh, 4 collapses it into a bvh4 first"),
+				boolOption("compressedBVH", &Settings::compressedBVH, "quantize the bvh4 nodes' child boxes to 8 bits (bvhWidth 4)"),
+				u32Option("maxLeafPrimitives", &Settings::maxLeafPrimitives, "1-16 primitives per bvh leaf, 1 = no leaf collapse"),
+				boolOption("leafCollapseSAH", &Settings::leafCollapseSAH, "collapse leaves by sah cost instead of size alone"),
+				boolOption("bvhRefit", &Settings::bvhRefit, "refit the last built bvh each frame instead of rebuilding it (lbvh, ploc)"),
+				u32Option("refitRebuildSAHGrowth", &Settings::refitRebuildSAHGrowth, "percent sah cost growth of a refit bvh that triggers a full rebuild"),
+				u32Option("bvhAnalysisInterval", &Settings::bvhAnalysisInterval, "frames between bvh quality reports in the telemetry, 0 = off"),
+				boolOption("asyncBVHBuild", &Settings::asyncBVHBuild, "build each frame's bvh on a second compute queue, traced the next frame (lbvh, ploc)"),
+				u32Option("mortonExtentBits", &Settings::mortonExtentBits, "0-8 bits of primitive size above the morton code, 0 keys on centroid only"),
+				u32Option("presplitBudget", &Settings::presplitBudget, "percent more triangles from splitting slivers and large triangles at load, 0 = off"),
+				boolOption("gpuProfiling", &Settings::gpuProfiling, "per pass gpu timestamps"),
+				boolOption("traversalStats", &Settings::traversalStats, "count bvh traversal work per frame (slower raytrace shader)"),
+				boolOption("heatmap", &Settings::heatmap, "false-colour bvh traversal cost per pixel instead of radiance"),
+				boolOption("heatmapClock", &Settings::heatmapClock, "heatmap of shader clock kilocycles per sample, where supported"),
+				u32Option("heatmapMaxCost", &Settings::heatmapMaxCost, "heatmap cost per sample mapped to red"),
+				boolOption("showBufferDebug", &Settings::showBufferDebug, "print buffer contents every frame"),
+				boolOption("fake1SecondDelay", &Settings::fake1SecondDelay, "busy wait 1 second every frame"),
+				stringListOption("benchmarkScenes", &Settings::benchmarkScenes, "scenes to benchmark"),
+				resolutionListOption("benchmarkResolutions", &Settings::benchmarkResolutions, "WIDTHxHEIGHT list to benchmark"),
+				u32ListOption("benchmarkRaysPerPixel", &Settings::benchmarkRaysPerPixel, "rays per pixel values to benchmark"),
+				u32ListOption("benchmarkMaxRaytraceDepths", &Settings::benchmarkMaxRaytraceDepths, "max depths to benchmark"),
+				u32ListOption("benchmarkMortonExtentBits", &Settings::benchmarkMortonExtentBits, "mortonExtentBits values to benchmark"),
+				u32Option("benchmarkWarmupFrames", &Settings::benchmarkWarmupFrames, "unmeasured frames per configuration"),
+				u32Option("benchmarkMeasuredFrames", &Settings::benchmarkMeasuredFrames, "measured frames per configuration"),
+				stringOption("benchmarkJsonPath", &Settings::benchmarkJsonPath, "benchmark results as json"),
+				stringOption("benchmarkCsvPath", &Settings::benchmarkCsvPath, "benchmark results as csv"),
+				u32ListOption("radixSortBenchmarkKeyCounts", &Settings::radixSortBenchmarkKeyCounts, "key counts to sort"),
+				u32Option("radixSortBenchmarkRepetitions", &Settings::radixSortBenchmarkRepetitions, "timed sorts per key count and kernel"),
+				u32Option("radixSortBenchmarkLegacyMaxKeys", &Settings::radixSortBenchmarkLegacyMaxKeys, "largest key count given to RadixSortSimple"),
+				stringOption("radixSortBenchmarkCsvPath", &Settings::radixSortBenchmarkCsvPath, "radix sort benchmark results as csv"),
+				stringOption("regressionDirectory", &Settings::regressionDirectory, "where reference images live"),
+				boolOption("regressionRecord", &Settings::regressionRecord, "write new references instead of comparing"),
+				boolOption("rayPerPixelIncreasingDemo", &Settings::rayPerPixelIncreasingDemo, "Raytracer only, writes runtimes.csv"),
+				u32Option("demoRunsBeforeIncrease", &Settings::demoRunsBeforeIncrease, "frames per rays per pixel step"),
+				u32Option("demoStartRaysPerPixel", &Settings::demoStartRaysPerPixel, "first rays per pixel value"),
+				u32Option("demoMaxRaysPerPixel", &Settings::demoMaxRaysPerPixel, "stops once rays per pixel passes this"),
+				u32Option("demoIncreaseAmount", &Settings::demoIncreaseAmount, "rays per pixel added each step")
+			};
+			return table;
+		}
+
+		auto apply(Settings& s, const std::string& name, const std::string& value) -> void {
+			for (const auto& option : options()) {
+				if (name == option.name) {
+					option.set(s, value);
+					return;
+				}
+			}
+			throw std::runtime_error(std::format("unknown setting \"{}\" (see --help)", name));
+		}
+
+		auto applyFile(Settings& s, const std::string& path) -> void {
+			std::ifstream in(path);
+			if (!in)
+				throw std::runtime_error("failed to open config file " + path);
+			std::string line;
+			for (u32 lineNumber = 1; std::getline(in, line); lineNumber++) {
+				line = trim(line.substr(0, line.find('#')));
+				if (line.empty())
+					continue;
+				const auto equals = line.find('=');
+				try {
+					if (equals == std::string::npos)
+						apply(s, line, "true"); // bare name, same as --name
+					else
+						apply(s, trim(line.substr(0, equals)), trim(line.substr(equals + 1)));
+				}
+				catch (const std::runtime_error& e) {
+					throw std::runtime_error(std::format("{}:{}: {}", path, lineNumber, e.what()));
+				}
+			}
+		}
+	}
+
+	auto load(int argc, char** argv) -> void {
+		Settings loaded{};
+		std::vector<std::pair<std::string, std::string>> commandLine;
+		for (int i = 1; i < argc; i++) {
+			const std::string argument = argv[i];
+			if (argument == "--help" || argument == "-h") {
+				std::cout << usage();
+				std::exit(0);
+			}
+			if (!argument.starts_with("--"))
+				throw std::runtime_error(std::format("expected --name=value, got \"{}\"", argument));
+			const auto equals = argument.find('=');
+			const auto name = argument.substr(2, equals == std::string::npos ? std::string::npos : equals - 2);
+			const auto value = equals == std::string::npos ? std::string("true") : argument.substr(equals + 1);
+			if (name == "config")
+				applyFile(loaded, value); // files first, so the command line always wins
+			else
+				commandLine.emplace_back(name, value);
+		}
+		for (const auto& [name, value] : commandLine)
+			apply(loaded, name, value);
+		if (loaded.mortonCodeBits != 0 && loaded.mortonCodeBits != 30 && loaded.mortonCodeBits != 63)
+			throw std::runtime_error(std::format("mortonCodeBits must be 0, 30 or 63, got {}", loaded.mortonCodeBits));
+		if (loaded.mortonExtentBits > 8)
+			throw std::runtime_error(std::format("mortonExtentBits must be at most 8, got {}", loaded.mortonExtentBits));
+		for (const auto bits : loaded.benchmarkMortonExtentBits)
+			if (bits > 8)
+				throw std::runtime_error(std::format("benchmarkMortonExtentBits must be at most 8, got {}", bits));
+		if (loaded.bvhBuilder != "scene" && loaded.bvhBuilder != "lbvh" && loaded.bvhBuilder != "ploc" && loaded.bvhBuilder != "sah" && loaded.bvhBuilder != "twolevel")
+			throw std::runtime_error(std::format("bvhBuilder must be scene, lbvh, ploc, sah or twolevel, got \"{}\"", loaded.bvhBuilder));
+		if (loaded.plocSearchRadius == 0 || loaded.plocSearchRadius > 32)
+			throw std::runtime_error(std::format("plocSearchRadius must be 1 to 32, got {}", loaded.plocSearchRadius));
+		if (loaded.bvhWidth != 2 && loaded.bvhWidth != 4)
+			throw std::runtime_error(std::format("bvhWidth must be 2 or 4, got {}", loaded.bvhWidth));
+		if (loaded.presplitBudget > 1000)
+			throw std::runtime_error(std::format("presplitBudget must be 0 to 1000 percent, got {}", loaded.presplitBudget));
+		if (loaded.compressedBVH && loaded.bvhWidth != 4)
+			throw std::runtime_error("compressedBVH quantizes the bvh4 nodes, needs bvhWidth 4");
+		if (loaded.maxLeafPrimitives == 0 || loaded.maxLeafPrimitives > 16)
+			throw std::runtime_error(std::format("maxLeafPrimitives must be 1 to 16, got {}", loaded.maxLeafPrimitives));
+		if (loaded.bvhRefit && loaded.refitRebuildSAHGrowth == 0)
+			throw std::runtime_error("refitRebuildSAHGrowth must be above 0, 0 would rebuild every frame");
+		if (loaded.heatmapClock)
+			loaded.heatmap = true;
+		if (loaded.heatmap && loaded.traversalStats)
+			throw std::runtime_error("heatmap and traversalStats use different raytrace shader builds, pick one");
+		if (loaded.heatmap && loaded.heatmapMaxCost == 0)
+			throw std::runtime_error("heatmapMaxCost must be greater than 0");
+		settings = std::move(loaded);
+	}
+
+	auto get() -> const Settings& {
+		return settings;
+	}
+
+	auto usage() -> std::string {
+		const Settings defaults{};
+		std::string text = "usage: RaytracerGPU_MastersProject [--config=file] [--name=value ...]\n";
+		for (const auto& option : options())
+			text += std::format("  --{:<28} {} (default: {})\n", option.name, option.description, option.show(defaults));
+		return text;
+	}
+
+	auto programName(Programs program) -> const char* {
+		switch (program) {
+			case Programs::LogisticMap: return "LogisticMap";
+			case Programs::Raytracer: return "Raytracer";
+			case Programs::RaytracerBVH: return "RaytracerBVH";
+			case Programs::RaytracerBVHBenchmark: return "RaytracerBVHBenchmark";
+			case Programs::CPUReference: return "CPUReference";
+			case Programs::ImageRegression: return "ImageRegression";
+			case Programs::RadixSortBenchmark: return "RadixSortBenchmark";
+		}
+		return "unknown";
+	}
+
+	auto mortonCodeBitsFor(u32 primitiveCount) -> u32 {
+		if (settings.mortonCodeBits != 0)
+			return settings.mortonCodeBits;
+		return primitiveCount >= settings.wideMortonCodeMinPrimitives ? 63 : 30;
+	}
+
+	auto mortonKeyBits(u32 mortonCodeBits, u32 mortonExtentBits) -> u32 {
+		if (mortonExtentBits == 0)
+			return mortonCodeBits;
+		return mortonCodeBits == 63 ? 64 : 32 + mortonExtentBits;
+	}
+};
@@ -1,24 +1,163 @@
 #pragma once
 
 #include "utils/PrimitiveTypes.hpp"
+#include "utils/Telemetry.hpp"
 
+#include <array>
+#include <string>
+#include <vector>
+
+/*
+Launch configuration. Every Settings field can be set without recompiling, either as --name=value
+on the command line or as name=value lines in a file passed with --config=path (# starts a comment).
+Command line values win over the file. --help lists every setting with its default.
+Bools accept 1/0, true/false, on/off, and a bare --name (or name line) means true. Lists are comma separated.
+*/
 namespace Config {
 	enum struct Programs {
 		LogisticMap,
 		Raytracer,
-		RaytracerBVH
+		RaytracerBVH,
+		RaytracerBVHBenchmark,
+		CPUReference,
+		ImageRegression,
+		RadixSortBenchmark
 	};
 
-	constexpr const Programs CurrentProgram = Programs::RaytracerBVH;
+	struct Settings {
+		Programs program = Programs::RaytracerBVH;
+
+		// RaytracerBVH, CPUReference
+		std::string scene = "complexScene"; // name from getScenes()
+		u32 width = 800; // window size, or the offscreen image size when headless
+		u32 height = 800;
+		u32 raysPerPixel = 0; // 0 keeps the scene's own value
+		u32 maxRaytraceDepth = 0; // 0 keeps the scene's own value
+		bool headless = false; // RaytracerBVH. no window or swapchain, renders offscreen and writes the image to disk
+		u32 frames = 1; // headless and CPUReference
+		std::string outputPath = "render.ppm"; // .pfm keeps linear float radiance instead
+		u32 threadCount = 0; // CPUReference and bvhBuilder=sah. 0 = every core
+
+		// seeds every sample from (pixel, sample index, frame index, seed) instead of the clock and the previous
+		// sample's alpha, and seeds scene generation too, so identical runs give identical images
+		bool deterministicSeeding = false;
+		u32 seed = 1;
+
+		// frame telemetry (Util::Telemetry). written off the render thread, so it doesn't skew the timings it reports
+		Util::Telemetry::Level logLevel = Util::Telemetry::Level::Info; // console. frame prints every frame
+		Util::Telemetry::Level telemetryLevel = Util::Telemetry::Level::Off; // telemetryPath
+		std::string telemetryPath = "telemetry.json"; // chrome trace, or csv for a .csv path
+
+		// morton code width for the bvh build (gpu and cpu). 30 is 10 bits per axis, 63 is 21 bits per axis, which
+		// keeps dense meshes from collapsing into long runs of equal codes. 0 picks by primitive count
+		u32 mortonCodeBits = 0;
+		u32 wideMortonCodeMinPrimitives = 1 << 17; // mortonCodeBits = 0 uses 63 bit codes from this many primitives on
+		// 0-8. puts the primitive's quantized (log scale) size above the morton code bits, so scene sized primitives
+		// (walls, ground spheres) split off near the root instead of inflating the nodes they'd share with small ones
+		u32 mortonExtentBits = 0;
+		// RaytracerBVH. percent of the triangle count added by cutting triangles whose world box far outgrows them
+		// (slivers, large walls) into smaller ones once at load, before any build (CPU::presplitTriangles). 0 is off
+		u32 presplitBudget = 0;
+		// RaytracerBVH. TRBVH style passes after the LBVH build, each rebuilding 7 leaf treelets bottom up into their
+		// lowest sah cost topology. costs a few ms of build for a faster trace, 3 is usually where the gains stop
+		u32 treeletOptimizationRounds = 0;
+		// RaytracerBVH. scene uses each scene's own choice (RaytraceScene::setBVHBuilder), lbvh, ploc or sah overrides it.
+		// sah builds once on the cpu (threadCount workers) and assumes nothing in the scene moves afterwards.
+		// twolevel builds a model space BLAS per model once and a TLAS over the GameObjects on the cpu every frame
+		std::string bvhBuilder = "scene";
+		u32 plocSearchRadius = 16; // 1-32. neighbours looked at either side of each cluster, higher is better trees and slower builds
+		u32 plocMaxIterations = 96; // recorded clustering iterations. trees needing more are finished by a slow single invocation pass
+		// RaytracerBVH. 2 traces the binary tree as built, 4 collapses it into BVH4 nodes after every build (CollapseBVH4)
+		// and traces those, testing four child boxes per node fetch
+		u32 bvhWidth = 2;
+		// RaytracerBVH, bvhWidth 4. CollapseBVH4 quantizes the child boxes to 8 bits within their node's box, so nodes are
+		// 64 bytes instead of 112 and leaves are packed into the child words. boxes grow by up to 1/255 of the node's
+		bool compressedBVH = false;
+		// RaytracerBVH. 2-16 collapses subtrees of up to this many primitives into single leaves over a range of a depth
+		// first primitive array after every build (LeafCollapse), 1 keeps one primitive per leaf
+		u32 maxLeafPrimitives = 1;
+		bool leafCollapseSAH = true; // only collapse where the sah prefers the leaf, otherwise every small enough subtree
+		// RaytracerBVH, lbvh and ploc builders. frames after a full build only refit the boxes of the last topology
+		// (RefitBVH) until its sah cost has grown refitRebuildSAHGrowth percent past the freshly built tree's
+		bool bvhRefit = false;
+		u32 refitRebuildSAHGrowth = 25;
+		// RaytracerBVH. every this many frames the bvh is read back and analysed (CPU::analyseBVH) into info level
+		// telemetry: sah cost, sibling overlap, depths, leaf sizes, duplicate morton codes. 0 never does
+		u32 bvhAnalysisInterval = 0;
+		// RaytracerBVH, lbvh and ploc builders. each frame's build runs on a second compute queue while the trace works
+		// through the previous build, a frame behind, from one of two copies. the trace only waits on a semaphore. turns
+		// gpuProfiling off, since timestamps from both queues would share one query pool
+		bool asyncBVHBuild = false;
+
+		bool gpuProfiling = true; // RaytracerBVH. per pass timestamp queries, reported with the frame timings
+		bool traversalStats = false; // RaytracerBVH. instrumented raytraceBVH build counting rays, node visits and primitive tests per frame
+		// RaytracerBVH. shows bvh nodes + primitives tested per sample as a false-colour image instead of radiance.
+		// heatmapClock times each invocation with shader clock instead (kilocycles), if the device supports it
+		bool heatmap = false;
+		bool heatmapClock = false;
+		u32 heatmapMaxCost = 400; // cost per sample drawn at the top (red) of the colormap
+		bool showBufferDebug = false; // reads buffers back and prints them every frame. very slow
+		bool fake1SecondDelay = false;
+
+		// RaytracerBVHBenchmark. every combination is rendered headless
+		std::vector<std::string> benchmarkScenes = { "randomSpheres", "cornellBoxScene", "complexScene" };
+		std::vector<std::array<u32, 2>> benchmarkResolutions = { { 800, 800 }, { 1920, 1080 } }; // written as 800x800
+		std::vector<u32> benchmarkRaysPerPixel = { 1, 10, 50 };
+		std::vector<u32> benchmarkMaxRaytraceDepths = { 5, 10 };
+		std::vector<u32> benchmarkMortonExtentBits = { 0 }; // every value also reports the bvh's sah cost, and traversal counts with traversalStats
+		u32 benchmarkWarmupFrames = 5;
+		u32 benchmarkMeasuredFrames = 30;
+		std::string benchmarkJsonPath = "benchmark.json";
+		std::string benchmarkCsvPath = "benchmark.csv";
+
+		// RadixSortBenchmark. sorts random morton keys with RadixSortSimple (one workgroup) and RadixSort (device wide)
+		std::vector<u32> radixSortBenchmarkKeyCounts = { 1 << 10, 1 << 12, 1 << 14, 1 << 16, 1 << 18, 1 << 20, 1 << 22, 1 << 24 };
+		u32 radixSortBenchmarkRepetitions = 10;
+		u32 radixSortBenchmarkLegacyMaxKeys = 1 << 22; // RadixSortSimple takes seconds past this, long enough to trip driver timeouts
+		std::string radixSortBenchmarkCsvPath = "radixsort_benchmark.csv";
+
+		// ImageRegression
+		std::string regressionDirectory = "references/"; // <scene>.pfm, failures also write <scene>.actual.pfm
+		bool regressionRecord = false; // overwrite the references with the current output instead of comparing
+
+		// Raytracer only. RaytracerBVH uses RaytracerBVHBenchmark instead
+		bool rayPerPixelIncreasingDemo = false;
+		u32 demoRunsBeforeIncrease = 4;
+		u32 demoStartRaysPerPixel = 100;
+		u32 demoMaxRaysPerPixel = 200;
+		u32 demoIncreaseAmount = 5;
+	};
 
-	constexpr const bool ShowBufferDebug = 0;
-	constexpr const bool Fake1SecondDelay = 0;
+	// parses the command line (and any --config file) into the settings returned by get(). throws on unknown names or bad values
+	auto load(int argc, char** argv) -> void;
+	auto get() -> const Settings&;
+	auto usage() -> std::string;
+	auto programName(Programs program) -> const char*;
+	auto mortonCodeBitsFor(u32 primitiveCount) -> u32; // 30 or 63, from mortonCodeBits and wideMortonCodeMinPrimitives
+	// significant bits of the (codeHigh, code) sort key. extent bits sit above 30 bit codes in codeHigh, and replace
+	// the lowest morton bits of 63 bit codes
+	auto mortonKeyBits(u32 mortonCodeBits, u32 mortonExtentBits) -> u32;
 
-	constexpr const bool RunRayPerPixelIncreasingDemo = 0;
-	namespace RayPerPixelIncreasingDemoConfig {
-		constexpr const u32 runsBeforeIncrease = 4;
-		constexpr const u32 startRaysPerPixel = 100;
-		constexpr const u32 maxRaysPerPixel = 200;
-		constexpr const u32 increaseAmount = 5;
+	namespace RegressionConfig { // ImageRegression. fixed so stored references stay valid
+		struct Tolerance {
+			const char* scene; // name from getScenes()
+			f64 maxRMSE; // display units (gamma corrected, [0, 1])
+			f64 minPSNR; // dB
+			f64 minSSIM;
+		};
+		// same device and driver should be exact. the slack is for other drivers reordering float math
+		constexpr const std::array<Tolerance, 5> scenes = { {
+			{ "randomSpheres", 0.01, 40.0, 0.98 },
+			{ "cornellMixedScene", 0.01, 40.0, 0.98 },
+			{ "cornellBoxScene", 0.01, 40.0, 0.98 },
+			{ "simpleScene", 0.01, 40.0, 0.98 },
+			{ "complexScene", 0.02, 34.0, 0.95 } // dense meshes, most sensitive to traversal precision
+		} };
+		constexpr const u32 width = 256;
+		constexpr const u32 height = 256;
+		constexpr const u32 raysPerPixel = 16;
+		constexpr const u32 maxRaytraceDepth = 8;
+		constexpr const u32 frames = 1;
+		constexpr const u32 seed = 1234;
 	};
 };
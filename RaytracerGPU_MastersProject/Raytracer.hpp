@@ -41,6 +41,8 @@ namespace RaytracerRenderer {
 	};
 	struct FragmentUniformBufferObject {
 		u32 raysPerPixel; // used in gamma correction
+		u32 visualizationMode; // 0 radiance, 1 traversal cost heatmap
+		f32 heatmapMaxCost;
 	};
 
 	class Raytracer {
@@ -182,7 +184,7 @@ namespace RaytracerRenderer {
 							)
 						);
 				};
-			if constexpr (Config::ShowBufferDebug) {
+			if (Config::get().showBufferDebug) {
 				if (this->iteration > 0) {
 					std::cout << "after\n";
 					auto spheres = this->DEBUGgetDeployedBufferAs<SceneTypes::GPU::Sphere>(
@@ -228,7 +230,7 @@ namespace RaytracerRenderer {
 			this->scene->updateScene();
 			this->scene->getCamera().updateCameraForFrame(this->window, frameTime, this->swapChain->extentAspectRatio());
 
-			if constexpr (Config::ShowBufferDebug) {
+			if (Config::get().showBufferDebug) {
 				auto resultFromGPU = this->DEBUGgetDeployedBufferAs<SceneTypes::GPU::Model>(
 					this->scene->getModelBuffer()->getBuffer(),
 					this->scene->getModelCount()
@@ -242,7 +244,7 @@ namespace RaytracerRenderer {
 					);
 				}
 			}
-			if constexpr (Config::ShowBufferDebug) {
+			if (Config::get().showBufferDebug) {
 				std::cout << "before\n";
 				auto resultFromGPU = this->DEBUGgetDeployedBufferAs<SceneTypes::GPU::Sphere>(
 					this->scene->getSphereBuffer()->getBuffer(),
@@ -267,7 +269,7 @@ namespace RaytracerRenderer {
 					);
 				}
 			}
-			if constexpr (Config::ShowBufferDebug) {
+			if (Config::get().showBufferDebug) {
 				auto resultFromGPU = this->DEBUGgetDeployedBufferAs<f32>(
 					this->scratchBuffer->getBuffer(),
 					this->scratchSize
@@ -303,7 +305,7 @@ namespace RaytracerRenderer {
 			this->fragUniformBuffer->writeToBuffer(&fUbo);
 			this->fragUniformBuffer->flush();
 
-			if constexpr (Config::ShowBufferDebug) {
+			if (Config::get().showBufferDebug) {
 				auto resultFromGPU = this->DEBUGgetDeployedBufferAs<RaytracerRenderer::RaytracingUniformBufferObject>(
 					this->rayUniformBuffer->getBuffer(),
 					1
@@ -318,7 +320,7 @@ namespace RaytracerRenderer {
 				);
 			}
 
-			if constexpr (Config::Fake1SecondDelay) { // fake 1 second delay
+			if (Config::get().fake1SecondDelay) { // fake 1 second delay
 				auto currentTime = std::chrono::high_resolution_clock::now();
 				auto newTime = std::chrono::high_resolution_clock::now();
 				while (std::chrono::duration<float, std::chrono::milliseconds::period>(newTime - currentTime).count() < 1000.0f)
@@ -369,8 +371,8 @@ namespace RaytracerRenderer {
 			if (vkCreateFence(this->device.device(), &fenceInfo, nullptr, &this->computeComplete) != VK_SUCCESS)
 				throw std::runtime_error("failed to create fence");
 
-			if constexpr (Config::RunRayPerPixelIncreasingDemo) {
-				this->scene->setRaysPerPixel(Config::RayPerPixelIncreasingDemoConfig::startRaysPerPixel);
+			if (Config::get().rayPerPixelIncreasingDemo) {
+				this->scene->setRaysPerPixel(Config::get().demoStartRaysPerPixel);
 			}
 
 			while (!this->window.shouldClose()) {
@@ -384,10 +386,10 @@ namespace RaytracerRenderer {
 					<< std::endl;
 				doIteration(std::chrono::duration<float, std::chrono::microseconds::period>(frameTime).count());
 				
-				if constexpr (Config::RunRayPerPixelIncreasingDemo) {
+				if (Config::get().rayPerPixelIncreasingDemo) {
 					if (this->iteration != 0) {
-						u32 index = (this->iteration - 1) / Config::RayPerPixelIncreasingDemoConfig::runsBeforeIncrease;
-						if (this->scene->getRaysPerPixel() > Config::RayPerPixelIncreasingDemoConfig::maxRaysPerPixel) {
+						u32 index = (this->iteration - 1) / Config::get().demoRunsBeforeIncrease;
+						if (this->scene->getRaysPerPixel() > Config::get().demoMaxRaysPerPixel) {
 							break;
 						}
 						if (this->times.size() == index) {
@@ -396,8 +398,8 @@ namespace RaytracerRenderer {
 						else {
 							this->times[index].push_back(frameTime);
 						}
-						if (this->iteration % Config::RayPerPixelIncreasingDemoConfig::runsBeforeIncrease == 0) {
-							this->scene->setRaysPerPixel(this->scene->getRaysPerPixel() + Config::RayPerPixelIncreasingDemoConfig::increaseAmount);
+						if (this->iteration % Config::get().demoRunsBeforeIncrease == 0) {
+							this->scene->setRaysPerPixel(this->scene->getRaysPerPixel() + Config::get().demoIncreaseAmount);
 						}
 					}
 				}
@@ -406,15 +408,15 @@ namespace RaytracerRenderer {
 			}
 			vkDeviceWaitIdle(this->device.device());
 
-			if constexpr (Config::RunRayPerPixelIncreasingDemo) {
+			if (Config::get().rayPerPixelIncreasingDemo) {
 				std::ofstream out;
 				out.open("runtimes.csv", std::ios::out | std::ios::trunc);
 				for (auto i = 0; i < this->times.size(); i++) {
 					std::chrono::microseconds sum = this->times[i].at(0); // assumes at least 1
-					for (auto j = 1; j < Config::RayPerPixelIncreasingDemoConfig::runsBeforeIncrease; j++) {
+					for (auto j = 1; j < Config::get().demoRunsBeforeIncrease; j++) {
 						sum += this->times[i][j];
 					}
-					out << (i + 1) << ", " << sum / Config::RayPerPixelIncreasingDemoConfig::runsBeforeIncrease << ",\n";
+					out << (i + 1) << ", " << sum / Config::get().demoRunsBeforeIncrease << ",\n";
 				}
 				out.close();
 			}
@@ -1,17 +1,57 @@
 
 #include "RaytracerBVH.hpp"
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cmath>
 #include "Scenes.hpp"
+#include "utils/ImageIO.hpp"
 
 namespace RaytracerBVHRenderer {
-	Raytracer::Raytracer() :
-		window{ 800, 800, "Compute-based Images" },
-		device{ window } {
+	namespace {
+		constexpr const u32 ENCLOSING_AABB_WORKGROUP_SIZE = 256; // matches GetEnclosingAABB.comp
+		constexpr const u32 ENCLOSING_AABB_MAX_WORKGROUPS = 1024; // past this each invocation strides over more primitives
+
+		auto enclosingAABBWorkgroupCount(u32 primitiveCount) -> u32 {
+			return std::clamp((primitiveCount + ENCLOSING_AABB_WORKGROUP_SIZE - 1) / ENCLOSING_AABB_WORKGROUP_SIZE, 1u, ENCLOSING_AABB_MAX_WORKGROUPS);
+		}
+		// floatToOrdered in shaders/include/orderedFloat.glsl
+		auto orderedFloatBits(f32 value) -> u32 {
+			const u32 bits = std::bit_cast<u32>(value);
+			return (bits & 0x80000000u) != 0 ? ~bits : bits | 0x80000000u;
+		}
+	}
+
+	Raytracer::Raytracer(SceneFunction sceneFunction, u32 windowWidth, u32 windowHeight) :
+		window{ std::make_unique<Window>(windowWidth, windowHeight, "Compute-based Images") },
+		device{ *window },
+		imageExtent{},
+		sceneFunction{ sceneFunction },
+		firstRun{ true },
+		iterationCurrentTime{ std::chrono::high_resolution_clock::now() },
+		iterationNewTime{ iterationCurrentTime } {
+		this->initVulkan();
+	}
+	Raytracer::Raytracer(u32 width, u32 height, SceneFunction sceneFunction) :
+		window{ nullptr },
+		device{},
+		imageExtent{ width, height },
+		sceneFunction{ sceneFunction },
+		firstRun{ true },
+		iterationCurrentTime{ std::chrono::high_resolution_clock::now() },
+		iterationNewTime{ iterationCurrentTime } {
 		this->initVulkan();
 	}
 	Raytracer::~Raytracer() {
+		vkDeviceWaitIdle(this->device.device()); // an asyncBVHBuild S1 may still be running when the last frame returns
 		this->modelToWorldPipeline = nullptr;
 		vkDestroyPipelineLayout(this->device.device(), this->modelToWorldPipelineLayout, nullptr);
+		this->optimizeTreeletsPipeline = nullptr;
+		vkDestroyPipelineLayout(this->device.device(), this->optimizeTreeletsPipelineLayout, nullptr);
+		this->collapseBVH4Pipeline = nullptr;
+		vkDestroyPipelineLayout(this->device.device(), this->collapseBVH4PipelineLayout, nullptr);
+		this->refitBVHPipeline = nullptr;
+		vkDestroyPipelineLayout(this->device.device(), this->refitBVHPipelineLayout, nullptr);
 		this->raytracePipeline = nullptr;
 		vkDestroyPipelineLayout(this->device.device(), this->raytracePipelineLayout, nullptr);
 
@@ -25,6 +65,8 @@ namespace RaytracerBVHRenderer {
 
 		vkDestroyFence(this->device.device(), this->computeS1Complete, nullptr);
 		vkDestroyFence(this->device.device(), this->computeS2Complete, nullptr);
+		for (auto semaphore : this->bvhSnapshotReady)
+			vkDestroySemaphore(this->device.device(), semaphore, nullptr); // null handles when not asyncBVHBuild
 
 		this->rayUniformBuffer = nullptr; // deconstruct uniformBuffer
 		this->fragUniformBuffer = nullptr;
@@ -38,9 +80,9 @@ namespace RaytracerBVHRenderer {
 	}
 
 	auto Raytracer::createSwapChain() -> void {
-		auto extent = this->window.getExtent();
+		auto extent = this->window->getExtent();
 		while (extent.width == 0 || extent.height == 0) {
-			extent = this->window.getExtent();
+			extent = this->window->getExtent();
 			glfwWaitEvents();
 		}
 		vkDeviceWaitIdle(this->device.device());
@@ -49,6 +91,7 @@ namespace RaytracerBVHRenderer {
 		else {
 			std::runtime_error("swap chain already created! (can use this for swap chain recreation later caused by window resize)");
 		}
+		this->imageExtent = this->swapChain->getSwapChainExtent();
 	}
 
 	auto Raytracer::createComputeDescriptorSetLayout() -> void {
@@ -75,6 +118,28 @@ namespace RaytracerBVHRenderer {
 				1
 			).build();
 		this->enclosingAABBDescriptorSetLayout = DescriptorSetLayout::Builder(this->device)
+			.addBinding(
+				0,
+				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).addBinding(
+				1,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).addBinding(
+				2,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).addBinding(
+				3,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).build();
+		this->generateMortonCodeDescriptorSetLayout = DescriptorSetLayout::Builder(this->device)
 			.addBinding(
 				0,
 				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
@@ -100,8 +165,13 @@ namespace RaytracerBVHRenderer {
 				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 				VK_SHADER_STAGE_COMPUTE_BIT,
 				1
+			).addBinding(
+				5,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
 			).build();
-		this->generateMortonCodeDescriptorSetLayout = DescriptorSetLayout::Builder(this->device)
+		this->constructHLBVHDescriptorSetLayout = DescriptorSetLayout::Builder(this->device)
 			.addBinding(
 				0,
 				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
@@ -133,7 +203,7 @@ namespace RaytracerBVHRenderer {
 				VK_SHADER_STAGE_COMPUTE_BIT,
 				1
 			).build();
-		this->radixSortDescriptorSetLayout = DescriptorSetLayout::Builder(this->device)
+		this->constructAABBDescriptorSetLayout = DescriptorSetLayout::Builder(this->device)
 			.addBinding(
 				0,
 				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
@@ -150,7 +220,7 @@ namespace RaytracerBVHRenderer {
 				VK_SHADER_STAGE_COMPUTE_BIT,
 				1
 			).build();
-		this->constructHLBVHDescriptorSetLayout = DescriptorSetLayout::Builder(this->device)
+		this->optimizeTreeletsDescriptorSetLayout = DescriptorSetLayout::Builder(this->device)
 			.addBinding(
 				0,
 				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
@@ -171,18 +241,35 @@ namespace RaytracerBVHRenderer {
 				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 				VK_SHADER_STAGE_COMPUTE_BIT,
 				1
+			).build();
+		this->collapseBVH4DescriptorSetLayout = DescriptorSetLayout::Builder(this->device)
+			.addBinding(
+				0,
+				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
 			).addBinding(
-				4,
+				1,
 				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 				VK_SHADER_STAGE_COMPUTE_BIT,
 				1
 			).addBinding(
-				5,
+				2,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).addBinding(
+				3,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).addBinding(
+				4,
 				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 				VK_SHADER_STAGE_COMPUTE_BIT,
 				1
 			).build();
-		this->constructAABBDescriptorSetLayout = DescriptorSetLayout::Builder(this->device)
+		this->refitBVHDescriptorSetLayout = DescriptorSetLayout::Builder(this->device)
 			.addBinding(
 				0,
 				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
@@ -198,6 +285,31 @@ namespace RaytracerBVHRenderer {
 				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 				VK_SHADER_STAGE_COMPUTE_BIT,
 				1
+			).addBinding(
+				3,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).addBinding(
+				4,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).addBinding(
+				5,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).addBinding(
+				6,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).addBinding(
+				7,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
 			).build();
 		this->raytraceDescriptorSetLayout = DescriptorSetLayout::Builder(this->device)
 			.addBinding(
@@ -235,6 +347,31 @@ namespace RaytracerBVHRenderer {
 				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 				VK_SHADER_STAGE_COMPUTE_BIT,
 				1
+			).addBinding(
+				7,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).addBinding(
+				8,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).addBinding(
+				9,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).addBinding(
+				10,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
+			).addBinding(
+				11,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				1
 			).build();
 	}
 	auto Raytracer::createGraphicsDescriptorSetLayout() -> void {
@@ -281,15 +418,6 @@ namespace RaytracerBVHRenderer {
 		if (vkCreatePipelineLayout(this->device.device(), &pipelineLayoutInfo3, nullptr, &this->generateMortonCodePipelineLayout) != VK_SUCCESS)
 			throw std::runtime_error("failed to create compute pipeline layout!");
 
-		VkDescriptorSetLayout tempRadixSort = this->radixSortDescriptorSetLayout->getDescriptorSetLayout();
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo4{};
-		pipelineLayoutInfo4.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo4.setLayoutCount = 1;
-		pipelineLayoutInfo4.pSetLayouts = &tempRadixSort;
-
-		if (vkCreatePipelineLayout(this->device.device(), &pipelineLayoutInfo4, nullptr, &this->radixSortPipelineLayout) != VK_SUCCESS)
-			throw std::runtime_error("failed to create compute pipeline layout!");
-
 		VkDescriptorSetLayout tempBVH = this->constructHLBVHDescriptorSetLayout->getDescriptorSetLayout();
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo5{};
 		pipelineLayoutInfo5.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -308,11 +436,56 @@ namespace RaytracerBVHRenderer {
 		if (vkCreatePipelineLayout(this->device.device(), &pipelineLayoutInfo2, nullptr, &this->constructAABBPipelineLayout) != VK_SUCCESS)
 			throw std::runtime_error("failed to create compute pipeline layout!");
 
+		VkDescriptorSetLayout tempTreelets = this->optimizeTreeletsDescriptorSetLayout->getDescriptorSetLayout();
+		VkPushConstantRange treeletPushConstantRange{};
+		treeletPushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		treeletPushConstantRange.offset = 0;
+		treeletPushConstantRange.size = sizeof(TreeletPushConstants);
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo4{};
+		pipelineLayoutInfo4.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo4.setLayoutCount = 1;
+		pipelineLayoutInfo4.pSetLayouts = &tempTreelets;
+		pipelineLayoutInfo4.pushConstantRangeCount = 1;
+		pipelineLayoutInfo4.pPushConstantRanges = &treeletPushConstantRange;
+
+		if (vkCreatePipelineLayout(this->device.device(), &pipelineLayoutInfo4, nullptr, &this->optimizeTreeletsPipelineLayout) != VK_SUCCESS)
+			throw std::runtime_error("failed to create compute pipeline layout!");
+
+		VkDescriptorSetLayout tempCollapse = this->collapseBVH4DescriptorSetLayout->getDescriptorSetLayout();
+		VkPushConstantRange collapsePushConstantRange{};
+		collapsePushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		collapsePushConstantRange.offset = 0;
+		collapsePushConstantRange.size = sizeof(CollapsePushConstants);
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo8{};
+		pipelineLayoutInfo8.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo8.setLayoutCount = 1;
+		pipelineLayoutInfo8.pSetLayouts = &tempCollapse;
+		pipelineLayoutInfo8.pushConstantRangeCount = 1;
+		pipelineLayoutInfo8.pPushConstantRanges = &collapsePushConstantRange;
+
+		if (vkCreatePipelineLayout(this->device.device(), &pipelineLayoutInfo8, nullptr, &this->collapseBVH4PipelineLayout) != VK_SUCCESS)
+			throw std::runtime_error("failed to create compute pipeline layout!");
+
+		VkDescriptorSetLayout tempRefit = this->refitBVHDescriptorSetLayout->getDescriptorSetLayout();
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo9{};
+		pipelineLayoutInfo9.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo9.setLayoutCount = 1;
+		pipelineLayoutInfo9.pSetLayouts = &tempRefit;
+
+		if (vkCreatePipelineLayout(this->device.device(), &pipelineLayoutInfo9, nullptr, &this->refitBVHPipelineLayout) != VK_SUCCESS)
+			throw std::runtime_error("failed to create compute pipeline layout!");
+
 		VkDescriptorSetLayout tempRaytrace = this->raytraceDescriptorSetLayout->getDescriptorSetLayout();
+		VkPushConstantRange raytracePushConstantRange{};
+		raytracePushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		raytracePushConstantRange.offset = 0;
+		raytracePushConstantRange.size = sizeof(RaytracePushConstants);
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo6{};
 		pipelineLayoutInfo6.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 		pipelineLayoutInfo6.setLayoutCount = 1;
 		pipelineLayoutInfo6.pSetLayouts = &tempRaytrace;
+		pipelineLayoutInfo6.pushConstantRangeCount = 1;
+		pipelineLayoutInfo6.pPushConstantRanges = &raytracePushConstantRange;
 
 		if (vkCreatePipelineLayout(this->device.device(), &pipelineLayoutInfo6, nullptr, &this->raytracePipelineLayout) != VK_SUCCESS)
 			throw std::runtime_error("failed to create compute pipeline layout!");
@@ -343,10 +516,10 @@ namespace RaytracerBVHRenderer {
 		{
 			ComputePipelineConfigInfo pipelineConfig{};
 			ComputePipeline::defaultPipelineConfigInfo(pipelineConfig);
-			pipelineConfig.pipelineLayout = this->generateMortonCodePipelineLayout;
-			this->generateMortonCodePipeline = std::make_unique<ComputePipeline>(
+			pipelineConfig.pipelineLayout = this->enclosingAABBPipelineLayout;
+			this->enclosingAABBFinalizePipeline = std::make_unique<ComputePipeline>(
 				this->device,
-				"shaders/compiled/GenerateMortonCodesOfPrimitives.comp.spv",
+				"shaders/compiled/GetEnclosingAABBFinalize.comp.spv",
 				pipelineConfig
 			);
 		}
@@ -354,10 +527,10 @@ namespace RaytracerBVHRenderer {
 		{
 			ComputePipelineConfigInfo pipelineConfig{};
 			ComputePipeline::defaultPipelineConfigInfo(pipelineConfig);
-			pipelineConfig.pipelineLayout = this->radixSortPipelineLayout;
-			this->radixSortComputePipeline = std::make_unique<ComputePipeline>(
+			pipelineConfig.pipelineLayout = this->generateMortonCodePipelineLayout;
+			this->generateMortonCodePipeline = std::make_unique<ComputePipeline>(
 				this->device,
-				"shaders/compiled/RadixSortSimple.comp.spv",
+				"shaders/compiled/GenerateMortonCodesOfPrimitives.comp.spv",
 				pipelineConfig
 			);
 		}
@@ -384,13 +557,58 @@ namespace RaytracerBVHRenderer {
 			);
 		}
 
+		{
+			ComputePipelineConfigInfo pipelineConfig{};
+			ComputePipeline::defaultPipelineConfigInfo(pipelineConfig);
+			pipelineConfig.pipelineLayout = this->optimizeTreeletsPipelineLayout;
+			this->optimizeTreeletsPipeline = std::make_unique<ComputePipeline>(
+				this->device,
+				"shaders/compiled/OptimizeTreelets.comp.spv",
+				pipelineConfig
+			);
+		}
+
+		{
+			ComputePipelineConfigInfo pipelineConfig{};
+			ComputePipeline::defaultPipelineConfigInfo(pipelineConfig);
+			pipelineConfig.pipelineLayout = this->collapseBVH4PipelineLayout;
+			this->collapseBVH4Pipeline = std::make_unique<ComputePipeline>(
+				this->device,
+				"shaders/compiled/CollapseBVH4.comp.spv",
+				pipelineConfig
+			);
+		}
+
+		{
+			ComputePipelineConfigInfo pipelineConfig{};
+			ComputePipeline::defaultPipelineConfigInfo(pipelineConfig);
+			pipelineConfig.pipelineLayout = this->refitBVHPipelineLayout;
+			this->refitBVHPipeline = std::make_unique<ComputePipeline>(
+				this->device,
+				"shaders/compiled/RefitBVH.comp.spv",
+				pipelineConfig
+			);
+		}
+
 		{
 			ComputePipelineConfigInfo pipelineConfig{};
 			ComputePipeline::defaultPipelineConfigInfo(pipelineConfig);
 			pipelineConfig.pipelineLayout = this->raytracePipelineLayout;
+			if (Config::get().heatmapClock) {
+				this->heatmapClock = this->device.shaderClockSupported();
+				if (!this->heatmapClock)
+					std::cout << "shader clock isn't supported on this device, heatmap falls back to nodes + primitives tested\n";
+			}
+			const char* raytraceShader = "shaders/compiled/raytraceBVH.comp.spv";
+			if (this->heatmapClock)
+				raytraceShader = "shaders/compiled/raytraceBVHHeatmapClock.comp.spv"; // -DHEATMAP -DUSE_SHADER_CLOCK
+			else if (this->heatmap)
+				raytraceShader = "shaders/compiled/raytraceBVHHeatmap.comp.spv"; // -DHEATMAP
+			else if (this->traversalStats)
+				raytraceShader = "shaders/compiled/raytraceBVHStats.comp.spv"; // -DTRAVERSAL_STATS
 			this->raytracePipeline = std::make_unique<ComputePipeline>(
 				this->device,
-				"shaders/compiled/raytraceBVH.comp.spv",
+				raytraceShader,
 				pipelineConfig
 			);
 		}
@@ -400,15 +618,16 @@ namespace RaytracerBVHRenderer {
 		VkImageCreateInfo imageInfo{};
 		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		imageInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageInfo.extent.width = this->swapChain->getSwapChainExtent().width;
-		imageInfo.extent.height = this->swapChain->getSwapChainExtent().height;
+		imageInfo.extent.width = this->imageExtent.width;
+		imageInfo.extent.height = this->imageExtent.height;
 		imageInfo.extent.depth = 1;
 		imageInfo.mipLevels = 1;
 		imageInfo.arrayLayers = 1;
 		imageInfo.format = VK_FORMAT_R32G32B32A32_SFLOAT; //VK_FORMAT_R8G8B8A8_UNORM;
 		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL; // using sfloat to additively store multiple ray colors in same location
 		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+			| VK_IMAGE_USAGE_TRANSFER_SRC_BIT; // transfer src for reading the image back (headless output)
 		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		imageInfo.flags = 0;
@@ -507,8 +726,29 @@ namespace RaytracerBVHRenderer {
 			sizeof(f32) * scratchSize
 		);
 
+		this->traversalStatsBuffer = std::make_unique<Buffer>(
+			this->device,
+			sizeof(u32),
+			static_cast<u32>(TraversalStat::WordCount),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // zeroed and read back with transfers
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		);
+		this->traversalStatsReadbackBuffer = std::make_unique<Buffer>(
+			this->device,
+			sizeof(u32),
+			static_cast<u32>(TraversalStat::WordCount),
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+		this->traversalStatsReadbackBuffer->map();
+
 		this->scene = std::make_unique<RaytraceScene>(this->device);
-		complexScene(this->scene);
+		this->scene->setPresplitBudget(Config::get().presplitBudget);
+		this->sceneFunction(this->scene);
+		if (Config::get().raysPerPixel > 0)
+			this->scene->setRaysPerPixel(Config::get().raysPerPixel);
+		if (Config::get().maxRaytraceDepth > 0)
+			this->scene->setMaxRaytraceDepth(Config::get().maxRaytraceDepth);
 
 		const u32 primCount = this->scene->getTriangleCount() + this->scene->getSphereCount();
 		
@@ -533,6 +773,8 @@ namespace RaytracerBVHRenderer {
 			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // is ssbo and will transfer into
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 		);
+		this->radixSort = std::make_unique<RadixSort>(this->device, *this->mortonPrimitiveBuffer1, *this->mortonPrimitiveBuffer2, primCount);
+		this->mortonCodeBits = Config::mortonCodeBitsFor(primCount);
 		this->HLBVHNodesBuffer = std::make_unique<Buffer>(
 			this->device,
 			sizeof(SceneTypes::GPU::BVHNode),
@@ -547,6 +789,238 @@ namespace RaytracerBVHRenderer {
 			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // is ssbo and will transfer into
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 		);
+		this->HLBVHTreeletInfoBuffer = std::make_unique<Buffer>(
+			this->device,
+			sizeof(f32) + sizeof(u32),
+			primCount + primCount - 1,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		);
+		const u32 wideNodeCount = std::max(primCount - 1, 1u);
+		this->BVH4NodesBuffer = std::make_unique<Buffer>(
+			this->device,
+			sizeof(SceneTypes::GPU::BVH4Node),
+			this->compressedBVH ? 1 : wideNodeCount, // raytrace binding 7 is bound at bvhWidth 2 too, so always allocated
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // copied into the asyncBVHBuild snapshots
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		);
+		this->compressedBVH4NodesBuffer = std::make_unique<Buffer>(
+			this->device,
+			sizeof(SceneTypes::GPU::CompressedBVH4Node),
+			this->compressedBVH ? wideNodeCount : 1, // likewise bound either way, one unused node otherwise
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // copied into the asyncBVHBuild snapshots
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		);
+		this->primitiveReferenceBuffer = std::make_unique<Buffer>(
+			this->device,
+			sizeof(u32),
+			primCount, // bound for raytrace even without leaf collapse
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // copied into the asyncBVHBuild snapshots
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		);
+		this->bvhQualityBuffer = std::make_unique<Buffer>(
+			this->device,
+			sizeof(f32),
+			1,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT // read after every S1 in bvhRefit
+		);
+		this->bvhQualityBuffer->map();
+		const u32 instanceCount = std::max(static_cast<u32>(this->scene->getHostInstances().size()), 1u);
+		this->tlasNodesBuffer = std::make_unique<Buffer>(
+			this->device,
+			sizeof(SceneTypes::GPU::BVHNode),
+			instanceCount + instanceCount - 1, // raytrace binds both TwoLevel buffers whatever the builder, so always allocated
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+		this->tlasNodesBuffer->map();
+		this->instanceBuffer = std::make_unique<Buffer>(
+			this->device,
+			sizeof(SceneTypes::GPU::Instance),
+			instanceCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+		this->instanceBuffer->map();
+		if (this->compressedBVH && this->maxLeafPrimitives > 1 && primCount > COMPRESSED_RANGE_FIRST_MASK + 1)
+			throw std::runtime_error(std::format("compressedBVH range leaves address at most {} primitive references, the scene has {}", COMPRESSED_RANGE_FIRST_MASK + 1, primCount));
+		if (this->maxLeafPrimitives > 1) {
+			this->leafCollapse = std::make_unique<LeafCollapse>(
+				this->device,
+				*this->rayUniformBuffer,
+				*this->HLBVHNodesBuffer,
+				*this->HLBVHConstructionInfoBuffer,
+				*this->primitiveReferenceBuffer,
+				primCount
+			);
+		}
+
+		this->bvhBuilder = this->scene->getBVHBuilder();
+		if (Config::get().bvhBuilder == "lbvh")
+			this->bvhBuilder = SceneTypes::BVHBuilder::LBVH;
+		else if (Config::get().bvhBuilder == "ploc")
+			this->bvhBuilder = SceneTypes::BVHBuilder::PLOC;
+		else if (Config::get().bvhBuilder == "sah")
+			this->bvhBuilder = SceneTypes::BVHBuilder::BinnedSAH;
+		else if (Config::get().bvhBuilder == "twolevel")
+			this->bvhBuilder = SceneTypes::BVHBuilder::TwoLevel;
+		if (this->bvhBuilder == SceneTypes::BVHBuilder::PLOC) {
+			this->ploc = std::make_unique<PLOC>(
+				this->device,
+				*this->rayUniformBuffer,
+				*this->scene->getTriangleBuffer(),
+				*this->scene->getSphereBuffer(),
+				*this->mortonPrimitiveBuffer1,
+				*this->HLBVHNodesBuffer,
+				*this->HLBVHConstructionInfoBuffer,
+				primCount
+			);
+		}
+		if (this->bvhBuilder == SceneTypes::BVHBuilder::BinnedSAH && primCount > 0) {
+			// from the load time transforms, the same world space primitives ModelSpaceToWorldSpace gives every frame
+			auto triangles = this->scene->getHostTriangles();
+			auto spheres = this->scene->getHostSpheres();
+			CPU::transformToWorldSpace(this->scene->getHostModels(), triangles, spheres);
+
+			const auto buildStart = Util::Telemetry::Clock::now();
+			Util::WorkStealingScheduler scheduler(Config::get().threadCount);
+			const auto nodes = CPU::buildBinnedSAH(triangles, spheres, scheduler);
+			Util::Telemetry::span(Util::Telemetry::Level::Info, "cpu", "buildBinnedSAH", 0, buildStart, Util::Telemetry::Clock::now());
+			Util::Telemetry::counter(Util::Telemetry::Level::Info, "bvh", "binnedSAHCost", 0, CPU::sahCost(nodes));
+
+			this->uploadBVHNodes(nodes);
+
+			// CollapseBVH4 climbs parents, which the gpu builders leave in the construction info
+			std::vector<SceneTypes::GPU::BVHConstructionInfo> constructionInfo(nodes.size(), { 0, 0 });
+			for (u32 i = 0; i + 1 < primCount; i++) {
+				constructionInfo[nodes[i].left].parent = i;
+				constructionInfo[nodes[i].right].parent = i;
+			}
+			Buffer constructionInfoStagingBuffer(
+				this->device,
+				sizeof(SceneTypes::GPU::BVHConstructionInfo),
+				static_cast<u32>(constructionInfo.size()),
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			);
+			constructionInfoStagingBuffer.map();
+			constructionInfoStagingBuffer.writeToBuffer((void*)constructionInfo.data());
+			this->device.copyBuffer(
+				this->device.graphicsQueue(),
+				this->device.getGraphicsCommandPool(),
+				constructionInfoStagingBuffer.getBuffer(),
+				this->HLBVHConstructionInfoBuffer->getBuffer(),
+				sizeof(SceneTypes::GPU::BVHConstructionInfo) * constructionInfo.size()
+			);
+		}
+		if (this->bvhBuilder == SceneTypes::BVHBuilder::TwoLevel) {
+			if (this->bvhWidth != 2 || this->leafCollapse)
+				throw std::runtime_error("bvhBuilder twolevel traces binary single primitive leaves, needs bvhWidth 2 and maxLeafPrimitives 1");
+			this->bvhRefit = false; // the TLAS is rebuilt every frame, the BLAS never need to be
+
+			const auto buildStart = Util::Telemetry::Clock::now();
+			Util::WorkStealingScheduler scheduler(Config::get().threadCount);
+			this->twoLevelBVH = std::make_unique<CPU::TwoLevelBVH>();
+			this->twoLevelBVH->addBLAS(this->scene->getHostInstances(), this->scene->getHostTriangles(), this->scene->getHostSpheres(), scheduler);
+			Util::Telemetry::span(Util::Telemetry::Level::Info, "cpu", "buildBLAS", 0, buildStart, Util::Telemetry::Clock::now());
+			// at most one BLAS node per scene node, since instances of the same model share theirs
+			if (!this->twoLevelBVH->getBLASNodes().empty())
+				this->uploadBVHNodes(this->twoLevelBVH->getBLASNodes());
+			this->tlasScheduler = std::make_unique<Util::WorkStealingScheduler>(1);
+		}
+		if (this->bvhBuilder == SceneTypes::BVHBuilder::BinnedSAH || this->bvhBuilder == SceneTypes::BVHBuilder::TwoLevel)
+			this->asyncBVHBuild = false; // nothing is built on the gpu per frame, so there's no build to hide
+		if (this->asyncBVHBuild) {
+			const auto snapshotOf = [this](const Buffer& source) -> std::unique_ptr<Buffer> {
+				return std::make_unique<Buffer>(
+					this->device,
+					source.getInstanceSize(),
+					source.getInstanceCount(),
+					VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+				);
+			};
+			for (auto& snapshot : this->bvhSnapshots) {
+				snapshot.triangles = snapshotOf(*this->scene->getTriangleBuffer());
+				snapshot.spheres = snapshotOf(*this->scene->getSphereBuffer());
+				snapshot.nodes = snapshotOf(*this->HLBVHNodesBuffer);
+				snapshot.bvh4Nodes = snapshotOf(*this->BVH4NodesBuffer);
+				snapshot.compressedBVH4Nodes = snapshotOf(*this->compressedBVH4NodesBuffer);
+				snapshot.primitiveReferences = snapshotOf(*this->primitiveReferenceBuffer);
+			}
+			if (!this->device.hasAsyncComputeQueue())
+				Util::Telemetry::message(Util::Telemetry::Level::Info, "asyncBVHBuild", "the compute queue family has one queue, builds share it with the trace");
+		}
+	}
+
+	auto Raytracer::uploadBVHNodes(const std::vector<SceneTypes::GPU::BVHNode>& nodes) -> void {
+		Buffer nodeStagingBuffer(
+			this->device,
+			sizeof(SceneTypes::GPU::BVHNode),
+			static_cast<u32>(nodes.size()),
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+		nodeStagingBuffer.map();
+		nodeStagingBuffer.writeToBuffer((void*)nodes.data());
+		this->device.copyBuffer(
+			this->device.graphicsQueue(),
+			this->device.getGraphicsCommandPool(),
+			nodeStagingBuffer.getBuffer(),
+			this->HLBVHNodesBuffer->getBuffer(),
+			sizeof(SceneTypes::GPU::BVHNode) * nodes.size()
+		);
+	}
+	auto Raytracer::updateTLAS() -> void {
+		const auto buildStart = Util::Telemetry::Clock::now();
+		const auto nodes = this->twoLevelBVH->buildTLAS(
+			this->scene->getHostInstances(),
+			this->scene->getHostModels(),
+			*this->tlasScheduler,
+			this->hostInstances
+		);
+		Util::Telemetry::span(Util::Telemetry::Level::Frame, "cpu", "buildTLAS", this->iteration, buildStart, Util::Telemetry::Clock::now());
+		this->tlasNodesBuffer->writeToBuffer((void*)nodes.data(), sizeof(SceneTypes::GPU::BVHNode) * nodes.size());
+		this->hostTLASNodes = nodes;
+		if (!this->hostInstances.empty())
+			this->instanceBuffer->writeToBuffer((void*)this->hostInstances.data(), sizeof(SceneTypes::GPU::Instance) * this->hostInstances.size());
+	}
+
+	auto Raytracer::analyseBVH() -> CPU::BVHAnalysis {
+		vkDeviceWaitIdle(this->device.device());
+		if (this->twoLevelBVH) // the BLAS don't change after load, the TLAS is what each frame builds
+			return CPU::analyseBVH(this->hostTLASNodes);
+		const u32 primCount = this->scene->getTriangleCount() + this->scene->getSphereCount();
+		auto analysis = CPU::analyseBVH(this->DEBUGgetDeployedBufferAs<SceneTypes::GPU::BVHNode>(
+			this->HLBVHNodesBuffer->getBuffer(), primCount + primCount - 1
+		));
+		if (this->bvhBuilder == SceneTypes::BVHBuilder::LBVH || this->bvhBuilder == SceneTypes::BVHBuilder::PLOC) {
+			analysis.mortonCodesAnalysed = true; // sorted in place by the last full build
+			analysis.duplicateMortonCodes = CPU::countDuplicateMortonCodes(this->DEBUGgetDeployedBufferAs<SceneTypes::GPU::MortonPrimitive>(
+				this->mortonPrimitiveBuffer1->getBuffer(), primCount
+			));
+		}
+		return analysis;
+	}
+	auto Raytracer::reportBVHAnalysis() -> void {
+		static constexpr const std::array<const char*, CPU::LEAF_SIZE_HISTOGRAM_BINS> LEAF_SIZE_NAMES = {
+			"leafSize1", "leafSize2", "leafSize3", "leafSize4", "leafSize5", "leafSize6", "leafSize7", "leafSize8",
+			"leafSize9", "leafSize10", "leafSize11", "leafSize12", "leafSize13", "leafSize14", "leafSize15", "leafSize16"
+		};
+		const auto analysis = this->analyseBVH();
+		const u32 frame = this->iteration;
+		Util::Telemetry::counter(Util::Telemetry::Level::Info, "bvh", "sahCost", frame, analysis.sahCost);
+		Util::Telemetry::counter(Util::Telemetry::Level::Info, "bvh", "siblingOverlap", frame, analysis.siblingOverlap);
+		Util::Telemetry::counter(Util::Telemetry::Level::Info, "bvh", "maxDepth", frame, analysis.maxDepth);
+		Util::Telemetry::counter(Util::Telemetry::Level::Info, "bvh", "averageLeafDepth", frame, analysis.averageLeafDepth);
+		Util::Telemetry::counter(Util::Telemetry::Level::Info, "bvh", "leaves", frame, analysis.leaves);
+		if (analysis.mortonCodesAnalysed)
+			Util::Telemetry::counter(Util::Telemetry::Level::Info, "bvh", "duplicateMortonCodes", frame, analysis.duplicateMortonCodes);
+		for (u32 bin = 0; bin < CPU::LEAF_SIZE_HISTOGRAM_BINS; bin++) {
+			if (analysis.leafSizeHistogram[bin] > 0)
+				Util::Telemetry::counter(Util::Telemetry::Level::Info, "bvh", LEAF_SIZE_NAMES[bin], frame, analysis.leafSizeHistogram[bin]);
+		}
 	}
 
 	auto Raytracer::createUniformBuffers() -> void {
@@ -580,18 +1054,13 @@ namespace RaytracerBVHRenderer {
 		this->enclosingAABBDescriptorPool = DescriptorPool::Builder(this->device)
 			.setMaxSets(1)
 			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
-			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3)
 			.build();
 		this->generateMortonCodeDescriptorPool = DescriptorPool::Builder(this->device)
 			.setMaxSets(1)
 			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
 			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5)
 			.build();
-		this->radixSortDescriptorPool = DescriptorPool::Builder(this->device)
-			.setMaxSets(1)
-			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
-			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2)
-			.build();
 		this->constructHLBVHDescriptorPool = DescriptorPool::Builder(this->device)
 			.setMaxSets(1)
 			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
@@ -602,11 +1071,27 @@ namespace RaytracerBVHRenderer {
 			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
 			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2)
 			.build();
-		this->raytraceDescriptorPool = DescriptorPool::Builder(this->device)
+		this->optimizeTreeletsDescriptorPool = DescriptorPool::Builder(this->device)
+			.setMaxSets(1)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3)
+			.build();
+		this->collapseBVH4DescriptorPool = DescriptorPool::Builder(this->device)
+			.setMaxSets(1)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4)
+			.build();
+		this->refitBVHDescriptorPool = DescriptorPool::Builder(this->device)
 			.setMaxSets(1)
 			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
-			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1)
-			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7)
+			.build();
+		const u32 raytraceSetCount = this->asyncBVHBuild ? 2 : 1; // one per snapshot
+		this->raytraceDescriptorPool = DescriptorPool::Builder(this->device)
+			.setMaxSets(raytraceSetCount)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, raytraceSetCount)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, raytraceSetCount)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 11 * raytraceSetCount)
 			.build();
 	}
 
@@ -614,8 +1099,10 @@ namespace RaytracerBVHRenderer {
 		this->modelToWorldDescriptorSets.resize(1);
 		this->constructAABBDescriptorSets.resize(1);
 		this->generateMortonCodeDescriptorSets.resize(1);
-		this->radixSortDescriptorSets.resize(1);
 		this->constructHLBVHDescriptorSets.resize(1);
+		this->optimizeTreeletsDescriptorSets.resize(1);
+		this->collapseBVH4DescriptorSets.resize(1);
+		this->refitBVHDescriptorSets.resize(1);
 		this->raytraceDescriptorSets.resize(1);
 		this->enclosingAABBDescriptorSets.resize(1);
 		auto uboBufferInfo = this->rayUniformBuffer->descriptorInfo();
@@ -625,10 +1112,17 @@ namespace RaytracerBVHRenderer {
 		auto ssboSphereBufferInfo = this->scene->getSphereBuffer()->descriptorInfo();
 		auto ssboMaterialBufferInfo = this->scene->getMaterialBuffer()->descriptorInfo();
 		auto ssboScratchBufferInfo = this->scratchBuffer->descriptorInfo();
+		auto ssboTraversalStatsBufferInfo = this->traversalStatsBuffer->descriptorInfo();
 		auto ssboMortonBufferInfo1 = this->mortonPrimitiveBuffer1->descriptorInfo();
-		auto ssboMortonBufferInfo2 = this->mortonPrimitiveBuffer2->descriptorInfo();
 		auto ssboBVHNodeInfo = this->HLBVHNodesBuffer->descriptorInfo();
 		auto ssboBVHConstructionInfoInfo = this->HLBVHConstructionInfoBuffer->descriptorInfo();
+		auto ssboBVHTreeletInfoInfo = this->HLBVHTreeletInfoBuffer->descriptorInfo();
+		auto ssboBVH4NodeInfo = this->BVH4NodesBuffer->descriptorInfo();
+		auto ssboCompressedBVH4NodeInfo = this->compressedBVH4NodesBuffer->descriptorInfo();
+		auto ssboPrimitiveReferenceInfo = this->primitiveReferenceBuffer->descriptorInfo();
+		auto ssboBVHQualityInfo = this->bvhQualityBuffer->descriptorInfo();
+		auto ssboTLASNodeInfo = this->tlasNodesBuffer->descriptorInfo();
+		auto ssboInstanceInfo = this->instanceBuffer->descriptorInfo();
 
 		VkDescriptorImageInfo descImageInfo{};
 		descImageInfo.sampler = nullptr;
@@ -646,7 +1140,6 @@ namespace RaytracerBVHRenderer {
 			.writeBuffer(1, &ssboEnclosingAABBBufferInfo)
 			.writeBuffer(2, &ssboTriangleBufferInfo)
 			.writeBuffer(3, &ssboSphereBufferInfo)
-			.writeBuffer(4, &ssboScratchBufferInfo)
 			.build(this->enclosingAABBDescriptorSets[0]);
 		DescriptorWriter(*this->generateMortonCodeDescriptorSetLayout, *this->generateMortonCodeDescriptorPool)
 			.writeBuffer(0, &uboBufferInfo)
@@ -656,11 +1149,6 @@ namespace RaytracerBVHRenderer {
 			.writeBuffer(4, &ssboMortonBufferInfo1)
 			.writeBuffer(5, &ssboScratchBufferInfo)
 			.build(this->generateMortonCodeDescriptorSets[0]);
-		DescriptorWriter(*this->radixSortDescriptorSetLayout, *this->radixSortDescriptorPool)
-			.writeBuffer(0, &uboBufferInfo)
-			.writeBuffer(1, &ssboMortonBufferInfo1)
-			.writeBuffer(2, &ssboMortonBufferInfo2)
-			.build(this->radixSortDescriptorSets[0]);
 		DescriptorWriter(*this->constructHLBVHDescriptorSetLayout, *this->constructHLBVHDescriptorPool)
 			.writeBuffer(0, &uboBufferInfo)
 			.writeBuffer(1, &ssboTriangleBufferInfo)
@@ -674,6 +1162,56 @@ namespace RaytracerBVHRenderer {
 			.writeBuffer(1, &ssboBVHNodeInfo)
 			.writeBuffer(2, &ssboBVHConstructionInfoInfo)
 			.build(this->constructAABBDescriptorSets[0]);
+		DescriptorWriter(*this->optimizeTreeletsDescriptorSetLayout, *this->optimizeTreeletsDescriptorPool)
+			.writeBuffer(0, &uboBufferInfo)
+			.writeBuffer(1, &ssboBVHNodeInfo)
+			.writeBuffer(2, &ssboBVHConstructionInfoInfo)
+			.writeBuffer(3, &ssboBVHTreeletInfoInfo)
+			.build(this->optimizeTreeletsDescriptorSets[0]);
+		DescriptorWriter(*this->collapseBVH4DescriptorSetLayout, *this->collapseBVH4DescriptorPool)
+			.writeBuffer(0, &uboBufferInfo)
+			.writeBuffer(1, &ssboBVHNodeInfo)
+			.writeBuffer(2, &ssboBVHConstructionInfoInfo)
+			.writeBuffer(3, &ssboBVH4NodeInfo)
+			.writeBuffer(4, &ssboCompressedBVH4NodeInfo)
+			.build(this->collapseBVH4DescriptorSets[0]);
+		DescriptorWriter(*this->refitBVHDescriptorSetLayout, *this->refitBVHDescriptorPool)
+			.writeBuffer(0, &uboBufferInfo)
+			.writeBuffer(1, &ssboTriangleBufferInfo)
+			.writeBuffer(2, &ssboSphereBufferInfo)
+			.writeBuffer(3, &ssboBVHNodeInfo)
+			.writeBuffer(4, &ssboBVHConstructionInfoInfo)
+			.writeBuffer(5, &ssboBVHTreeletInfoInfo)
+			.writeBuffer(6, &ssboPrimitiveReferenceInfo)
+			.writeBuffer(7, &ssboBVHQualityInfo)
+			.build(this->refitBVHDescriptorSets[0]);
+		if (this->asyncBVHBuild) { // traces the snapshots instead, which S1 copies everything it wrote into
+			this->raytraceDescriptorSets.resize(this->bvhSnapshots.size());
+			for (size_t i = 0; i < this->bvhSnapshots.size(); i++) {
+				const auto& snapshot = this->bvhSnapshots[i];
+				auto snapshotTriangleInfo = snapshot.triangles->descriptorInfo();
+				auto snapshotSphereInfo = snapshot.spheres->descriptorInfo();
+				auto snapshotBVHNodeInfo = snapshot.nodes->descriptorInfo();
+				auto snapshotBVH4NodeInfo = snapshot.bvh4Nodes->descriptorInfo();
+				auto snapshotPrimitiveReferenceInfo = snapshot.primitiveReferences->descriptorInfo();
+				auto snapshotCompressedBVH4NodeInfo = snapshot.compressedBVH4Nodes->descriptorInfo();
+				DescriptorWriter(*this->raytraceDescriptorSetLayout, *this->raytraceDescriptorPool)
+					.writeBuffer(0, &uboBufferInfo)
+					.writeImage(1, &descImageInfo)
+					.writeBuffer(2, &snapshotTriangleInfo)
+					.writeBuffer(3, &snapshotSphereInfo)
+					.writeBuffer(4, &ssboMaterialBufferInfo)
+					.writeBuffer(5, &snapshotBVHNodeInfo)
+					.writeBuffer(6, &ssboTraversalStatsBufferInfo)
+					.writeBuffer(7, &snapshotBVH4NodeInfo)
+					.writeBuffer(8, &snapshotPrimitiveReferenceInfo)
+					.writeBuffer(9, &ssboTLASNodeInfo)
+					.writeBuffer(10, &ssboInstanceInfo)
+					.writeBuffer(11, &snapshotCompressedBVH4NodeInfo)
+					.build(this->raytraceDescriptorSets[i]);
+			}
+			return;
+		}
 		DescriptorWriter(*this->raytraceDescriptorSetLayout, *this->raytraceDescriptorPool)
 			.writeBuffer(0, &uboBufferInfo)
 			.writeImage(1, &descImageInfo)
@@ -681,7 +1219,12 @@ namespace RaytracerBVHRenderer {
 			.writeBuffer(3, &ssboSphereBufferInfo)
 			.writeBuffer(4, &ssboMaterialBufferInfo)
 			.writeBuffer(5, &ssboBVHNodeInfo)
-			.writeBuffer(6, &ssboScratchBufferInfo)
+			.writeBuffer(6, &ssboTraversalStatsBufferInfo)
+			.writeBuffer(7, &ssboBVH4NodeInfo)
+			.writeBuffer(8, &ssboPrimitiveReferenceInfo)
+			.writeBuffer(9, &ssboTLASNodeInfo)
+			.writeBuffer(10, &ssboInstanceInfo)
+			.writeBuffer(11, &ssboCompressedBVH4NodeInfo)
 			.build(this->raytraceDescriptorSets[0]);
 	}
 	auto Raytracer::createGraphicsDescriptorPool() -> void {
@@ -731,15 +1274,32 @@ namespace RaytracerBVHRenderer {
 		if (vkAllocateCommandBuffers(this->device.device(), &allocInfo, &this->graphicsCommandBuffer) != VK_SUCCESS)
 			throw std::runtime_error("Failed to allocate compute Command Buffers!");
 	}
-	auto Raytracer::recordComputeS1CommandBuffer(VkCommandBuffer commandBuffer, u32 currImageIndex) -> void {
-		static bool firstRun = true;
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
-			throw std::runtime_error("failed to begin recording compute command buffer!");
+	auto Raytracer::createProfiler() -> void {
+		this->profiler = std::make_unique<GPUProfiler>(
+			this->device,
+			std::vector<std::string>(GPU_PASS_NAMES.begin(), GPU_PASS_NAMES.end())
+		);
+		if (!this->profiler->isSupported())
+			std::cout << "GPU profiler disabled: compute queue doesn't support timestamps\n";
+	}
+	auto Raytracer::createFences() -> void {
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+		if (vkCreateFence(this->device.device(), &fenceInfo, nullptr, &this->computeS1Complete) != VK_SUCCESS)
+			throw std::runtime_error("failed to create fence");
+		if (vkCreateFence(this->device.device(), &fenceInfo, nullptr, &this->computeS2Complete) != VK_SUCCESS)
+			throw std::runtime_error("failed to create fence");
+		if (!this->asyncBVHBuild)
+			return;
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		for (auto& semaphore : this->bvhSnapshotReady) {
+			if (vkCreateSemaphore(this->device.device(), &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+				throw std::runtime_error("failed to create semaphore");
 		}
-
+	}
+	auto Raytracer::recordComputeImageClear(VkCommandBuffer commandBuffer) -> void {
 		VkImageSubresourceRange range{};
 		range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		range.levelCount = VK_REMAINING_MIP_LEVELS;
@@ -752,7 +1312,7 @@ namespace RaytracerBVHRenderer {
 		reset.pNext = nullptr;
 		reset.srcAccessMask = 0;
 		reset.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
-		reset.oldLayout = firstRun ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		reset.oldLayout = this->firstRun ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 		reset.newLayout = VK_IMAGE_LAYOUT_GENERAL;
 		reset.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		reset.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
@@ -775,6 +1335,50 @@ namespace RaytracerBVHRenderer {
 			VK_IMAGE_LAYOUT_GENERAL, &clearValue, 1, &range
 		);
 
+		VkImageMemoryBarrier clearToTrace; // the clear is a transfer, raytrace accumulates into the image after it
+		clearToTrace.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		clearToTrace.pNext = nullptr;
+		clearToTrace.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearToTrace.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
+		clearToTrace.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		clearToTrace.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		clearToTrace.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		clearToTrace.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		clearToTrace.image = this->computeImage;
+		clearToTrace.subresourceRange = range;
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, // src stage
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, // dst stage
+			0, // no dependencies
+			0, nullptr, // no memory barriers
+			0, nullptr, // no buffer memory barriers
+			1, &clearToTrace // 1 imageMemoryBarrier
+		);
+		this->firstRun = false;
+	}
+	auto Raytracer::recordComputeS1CommandBuffer(VkCommandBuffer commandBuffer, u32 currImageIndex) -> void {
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording compute command buffer!");
+		}
+
+		if (this->profiler)
+			this->profiler->beginFrame(commandBuffer);
+
+		if (!this->asyncBVHBuild) // S2 clears it itself, this S1 overlaps the previous frame's trace
+			this->recordComputeImageClear(commandBuffer);
+
+		if (this->bvhBuilder == SceneTypes::BVHBuilder::TwoLevel) { // primitives stay in model space, updateTLAS placed the instances
+			if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to record compute command buffer!");
+			}
+			return;
+		}
+
 		this->modelToWorldPipeline->bind(commandBuffer);
 		vkCmdBindDescriptorSets(
 			commandBuffer,
@@ -786,7 +1390,9 @@ namespace RaytracerBVHRenderer {
 			0,
 			nullptr
 		);
+		this->beginProfiledPass(commandBuffer, GPUPass::ModelToWorld);
 		vkCmdDispatch(commandBuffer, ((this->scene->getTriangleCount() + this->scene->getSphereCount()) / 32) + 1, 1, 1);
+		this->endProfiledPass(commandBuffer, GPUPass::ModelToWorld);
 
 		VkMemoryBarrier waitForWorldSpaceTransformation;
 		waitForWorldSpaceTransformation.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
@@ -828,6 +1434,62 @@ namespace RaytracerBVHRenderer {
 			nullptr
 		);
 
+		this->lastS1Refit = this->bvhRefit && !this->bvhRebuildNeeded && this->bvhBuilder != SceneTypes::BVHBuilder::BinnedSAH;
+		if (this->lastS1Refit) { // only the transforms changed since the last build, keep its topology
+			this->recordRefitBVH(commandBuffer);
+			if (this->bvhWidth == 4)
+				this->recordCollapseBVH4(commandBuffer);
+			if (this->asyncBVHBuild)
+				this->recordBVHSnapshotCopy(commandBuffer);
+			if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to record compute command buffer!");
+			}
+			return;
+		}
+
+		if (this->bvhBuilder == SceneTypes::BVHBuilder::BinnedSAH) { // HLBVHNodesBuffer was filled once in createScene
+			if (this->leafCollapse && !this->leafRangesCollapsed) {
+				this->recordLeafCollapse(commandBuffer);
+				this->leafRangesCollapsed = true;
+			}
+			if (this->bvhWidth == 4)
+				this->recordCollapseBVH4(commandBuffer);
+			if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to record compute command buffer!");
+			}
+			return;
+		}
+
+		// GetEnclosingAABB atomically mins/maxes ordered float bits into enclosingAABBBuffer, so preset it to the identities
+		const u32 presetMin = orderedFloatBits(1000000000.0f);
+		const u32 presetMax = orderedFloatBits(-1000000000.0f);
+		vkCmdFillBuffer(commandBuffer, this->enclosingAABBBuffer->getBuffer(), 0, sizeof(glm::vec4), presetMin);
+		vkCmdFillBuffer(commandBuffer, this->enclosingAABBBuffer->getBuffer(), sizeof(glm::vec4), sizeof(glm::vec4), presetMax);
+
+		VkBufferMemoryBarrier presetToReduce;
+		presetToReduce.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		presetToReduce.pNext = nullptr;
+		presetToReduce.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		presetToReduce.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		presetToReduce.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		presetToReduce.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		presetToReduce.buffer = this->enclosingAABBBuffer->getBuffer();
+		presetToReduce.offset = 0;
+		presetToReduce.size = VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			0,
+			nullptr,
+			1,
+			&presetToReduce,
+			0,
+			nullptr
+		);
+
 		this->enclosingAABBPipeline->bind(commandBuffer);
 		vkCmdBindDescriptorSets(
 			commandBuffer,
@@ -839,16 +1501,45 @@ namespace RaytracerBVHRenderer {
 			0,
 			nullptr
 		);
+		this->beginProfiledPass(commandBuffer, GPUPass::EnclosingAABB);
+		vkCmdDispatch(commandBuffer, enclosingAABBWorkgroupCount(this->scene->getTriangleCount() + this->scene->getSphereCount()), 1, 1);
+
+		VkBufferMemoryBarrier reduceToFinalize;
+		reduceToFinalize.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		reduceToFinalize.pNext = nullptr;
+		reduceToFinalize.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		reduceToFinalize.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		reduceToFinalize.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		reduceToFinalize.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		reduceToFinalize.buffer = this->enclosingAABBBuffer->getBuffer();
+		reduceToFinalize.offset = 0;
+		reduceToFinalize.size = VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			0,
+			nullptr,
+			1,
+			&reduceToFinalize,
+			0,
+			nullptr
+		);
+
+		this->enclosingAABBFinalizePipeline->bind(commandBuffer); // same layout, so the descriptor set stays bound
 		vkCmdDispatch(commandBuffer, 1, 1, 1);
+		this->endProfiledPass(commandBuffer, GPUPass::EnclosingAABB);
 
 		VkBufferMemoryBarrier enclosingAABBBarrier;
 		enclosingAABBBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
 		enclosingAABBBarrier.pNext = nullptr;
 		enclosingAABBBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		enclosingAABBBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		enclosingAABBBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 		enclosingAABBBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		enclosingAABBBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		enclosingAABBBarrier.buffer = this->mortonPrimitiveBuffer1->getBuffer();
+		enclosingAABBBarrier.buffer = this->enclosingAABBBuffer->getBuffer();
 		enclosingAABBBarrier.offset = 0;
 		enclosingAABBBarrier.size = VK_WHOLE_SIZE;
 
@@ -876,13 +1567,15 @@ namespace RaytracerBVHRenderer {
 			0,
 			nullptr
 		);
+		this->beginProfiledPass(commandBuffer, GPUPass::MortonCodes);
 		vkCmdDispatch(commandBuffer, ((this->scene->getTriangleCount() + this->scene->getSphereCount()) / 32) + 1, 1, 1);
+		this->endProfiledPass(commandBuffer, GPUPass::MortonCodes);
 
 		VkBufferMemoryBarrier mortonCodeBarrier;
 		mortonCodeBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
 		mortonCodeBarrier.pNext = nullptr;
 		mortonCodeBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		mortonCodeBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		mortonCodeBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 		mortonCodeBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		mortonCodeBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		mortonCodeBarrier.buffer = this->mortonPrimitiveBuffer1->getBuffer();
@@ -902,25 +1595,15 @@ namespace RaytracerBVHRenderer {
 			nullptr
 		);
 
-		this->radixSortComputePipeline->bind(commandBuffer);
-		vkCmdBindDescriptorSets(
-			commandBuffer,
-			VK_PIPELINE_BIND_POINT_COMPUTE,
-			this->radixSortPipelineLayout,
-			0,
-			1,
-			&this->radixSortDescriptorSets[0],
-			0,
-			nullptr
-		);
-		vkCmdDispatch(commandBuffer, 1, 1, 1); // only 1 workgroup
-		// see RadixSortSimple for reason
+		this->beginProfiledPass(commandBuffer, GPUPass::RadixSort);
+		this->radixSort->record(commandBuffer, this->scene->getTriangleCount() + this->scene->getSphereCount(), Config::mortonKeyBits(this->mortonCodeBits, this->mortonExtentBits)); // sorted back into mortonPrimitiveBuffer1
+		this->endProfiledPass(commandBuffer, GPUPass::RadixSort);
 
 		VkBufferMemoryBarrier sortingBarrier;
 		sortingBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
 		sortingBarrier.pNext = nullptr;
 		sortingBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		sortingBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		sortingBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 		sortingBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		sortingBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		sortingBarrier.buffer = this->mortonPrimitiveBuffer1->getBuffer();
@@ -940,60 +1623,270 @@ namespace RaytracerBVHRenderer {
 			nullptr
 		);
 
-		this->constructHLBVHComputePipeline->bind(commandBuffer);
+		if (this->bvhBuilder == SceneTypes::BVHBuilder::PLOC) {
+			this->beginProfiledPass(commandBuffer, GPUPass::PLOC);
+			this->ploc->record(
+				commandBuffer,
+				this->scene->getTriangleCount() + this->scene->getSphereCount(),
+				Config::get().plocSearchRadius,
+				Config::get().plocMaxIterations
+			); // same nodes and construction info as the two passes below
+			this->endProfiledPass(commandBuffer, GPUPass::PLOC);
+		}
+		else {
+			this->constructHLBVHComputePipeline->bind(commandBuffer);
+			vkCmdBindDescriptorSets(
+				commandBuffer,
+				VK_PIPELINE_BIND_POINT_COMPUTE,
+				this->constructHLBVHPipelineLayout,
+				0,
+				1,
+				&this->constructHLBVHDescriptorSets[0],
+				0,
+				nullptr
+			);
+			this->beginProfiledPass(commandBuffer, GPUPass::ConstructHLBVH);
+			vkCmdDispatch(commandBuffer, ((this->scene->getTriangleCount() + this->scene->getSphereCount()) / 256) + 1, 1, 1);
+			this->endProfiledPass(commandBuffer, GPUPass::ConstructHLBVH);
+
+			VkBufferMemoryBarrier bvhBarrier;
+			bvhBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			bvhBarrier.pNext = nullptr;
+			bvhBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			bvhBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			bvhBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bvhBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bvhBarrier.buffer = this->mortonPrimitiveBuffer1->getBuffer();
+			bvhBarrier.offset = 0;
+			bvhBarrier.size = VK_WHOLE_SIZE;
+
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				0,
+				nullptr,
+				1,
+				&bvhBarrier,
+				0,
+				nullptr
+			);
+
+			this->constructAABBPipeline->bind(commandBuffer);
+			vkCmdBindDescriptorSets(
+				commandBuffer,
+				VK_PIPELINE_BIND_POINT_COMPUTE,
+				this->constructAABBPipelineLayout,
+				0,
+				1,
+				&this->constructAABBDescriptorSets[0],
+				0,
+				nullptr
+			);
+			this->beginProfiledPass(commandBuffer, GPUPass::ConstructAABBs);
+			vkCmdDispatch(commandBuffer, ((this->scene->getTriangleCount() + this->scene->getSphereCount()) / 32) + 1, 1, 1);
+			this->endProfiledPass(commandBuffer, GPUPass::ConstructAABBs);
+		}
+
+		if (this->treeletOptimizationRounds > 0) {
+			// nodes, construction info and treelet info all carry over between rounds
+			VkMemoryBarrier treeletBarrier{};
+			treeletBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			treeletBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			treeletBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+			this->optimizeTreeletsPipeline->bind(commandBuffer);
+			vkCmdBindDescriptorSets(
+				commandBuffer,
+				VK_PIPELINE_BIND_POINT_COMPUTE,
+				this->optimizeTreeletsPipelineLayout,
+				0,
+				1,
+				&this->optimizeTreeletsDescriptorSets[0],
+				0,
+				nullptr
+			);
+			this->beginProfiledPass(commandBuffer, GPUPass::OptimizeTreelets);
+			for (u32 round = 0; round < this->treeletOptimizationRounds; round++) {
+				vkCmdPipelineBarrier(
+					commandBuffer,
+					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+					0,
+					1,
+					&treeletBarrier,
+					0,
+					nullptr,
+					0,
+					nullptr
+				);
+				// each round only starts treelets under twice as many primitives, spending less time per round on the
+				// small subtrees the previous rounds already optimized
+				TreeletPushConstants push{ TREELET_LEAVES << std::min(round, 24u) };
+				vkCmdPushConstants(commandBuffer, this->optimizeTreeletsPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+				vkCmdDispatch(commandBuffer, ((this->scene->getTriangleCount() + this->scene->getSphereCount()) / 32) + 1, 1, 1);
+			}
+			this->endProfiledPass(commandBuffer, GPUPass::OptimizeTreelets);
+		}
+
+		if (this->leafCollapse)
+			this->recordLeafCollapse(commandBuffer);
+		if (this->bvhRefit)
+			this->recordRefitBVH(commandBuffer); // nothing moved, only measures the fresh tree's sah cost for the next refits
+		if (this->bvhWidth == 4)
+			this->recordCollapseBVH4(commandBuffer);
+
+		if (this->asyncBVHBuild)
+			this->recordBVHSnapshotCopy(commandBuffer);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record compute command buffer!");
+		}
+	}
+	auto Raytracer::recordBVHSnapshotCopy(VkCommandBuffer commandBuffer) -> void {
+		VkMemoryBarrier builtToCopy{}; // the last build (or refit) pass wrote what gets copied
+		builtToCopy.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		builtToCopy.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		builtToCopy.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0,
+			1, &builtToCopy,
+			0, nullptr,
+			0, nullptr
+		);
+
+		// the S2 that read this snapshot two frames ago was waited on, and the semaphore S1 signals makes the copies visible
+		const auto& snapshot = this->bvhSnapshots[this->nextBVHSnapshot];
+		const auto copyWhole = [commandBuffer](const Buffer& source, const Buffer& destination) -> void {
+			VkBufferCopy copyRegion{};
+			copyRegion.size = source.getBufferSize();
+			vkCmdCopyBuffer(commandBuffer, source.getBuffer(), destination.getBuffer(), 1, &copyRegion);
+		};
+		copyWhole(*this->scene->getTriangleBuffer(), *snapshot.triangles);
+		copyWhole(*this->scene->getSphereBuffer(), *snapshot.spheres);
+		copyWhole(*this->HLBVHNodesBuffer, *snapshot.nodes);
+		if (this->bvhWidth == 4 && this->compressedBVH) // only the one CollapseBVH4 writes, the other is a single unused node
+			copyWhole(*this->compressedBVH4NodesBuffer, *snapshot.compressedBVH4Nodes);
+		else if (this->bvhWidth == 4)
+			copyWhole(*this->BVH4NodesBuffer, *snapshot.bvh4Nodes);
+		if (this->leafCollapse) // unchanged by refits, but the other snapshot may predate the last full build
+			copyWhole(*this->primitiveReferenceBuffer, *snapshot.primitiveReferences);
+	}
+	auto Raytracer::recordLeafCollapse(VkCommandBuffer commandBuffer) -> void {
+		VkMemoryBarrier builtBarrier{}; // the builder (and OptimizeTreelets) wrote the nodes, parents and visitation counts
+		builtBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		builtBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		builtBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			1,
+			&builtBarrier,
+			0,
+			nullptr,
+			0,
+			nullptr
+		);
+
+		this->beginProfiledPass(commandBuffer, GPUPass::LeafCollapse);
+		this->leafCollapse->record(
+			commandBuffer,
+			this->scene->getTriangleCount() + this->scene->getSphereCount(),
+			this->maxLeafPrimitives,
+			Config::get().leafCollapseSAH
+		);
+		this->endProfiledPass(commandBuffer, GPUPass::LeafCollapse);
+	}
+	auto Raytracer::recordRefitBVH(VkCommandBuffer commandBuffer) -> void {
+		VkMemoryBarrier builtBarrier{}; // ModelToWorld moved the primitives, or the build wrote the nodes and visitation counts
+		builtBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		builtBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		builtBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			1,
+			&builtBarrier,
+			0,
+			nullptr,
+			0,
+			nullptr
+		);
+
+		this->refitBVHPipeline->bind(commandBuffer);
 		vkCmdBindDescriptorSets(
 			commandBuffer,
 			VK_PIPELINE_BIND_POINT_COMPUTE,
-			this->constructHLBVHPipelineLayout,
+			this->refitBVHPipelineLayout,
 			0,
 			1,
-			&this->constructHLBVHDescriptorSets[0],
+			&this->refitBVHDescriptorSets[0],
 			0,
 			nullptr
 		);
+		this->beginProfiledPass(commandBuffer, GPUPass::RefitBVH);
 		vkCmdDispatch(commandBuffer, ((this->scene->getTriangleCount() + this->scene->getSphereCount()) / 256) + 1, 1, 1);
+		this->endProfiledPass(commandBuffer, GPUPass::RefitBVH);
 
-		VkBufferMemoryBarrier bvhBarrier;
-		bvhBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-		bvhBarrier.pNext = nullptr;
-		bvhBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		bvhBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		bvhBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		bvhBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		bvhBarrier.buffer = this->mortonPrimitiveBuffer1->getBuffer();
-		bvhBarrier.offset = 0;
-		bvhBarrier.size = VK_WHOLE_SIZE;
-
+		VkMemoryBarrier qualityToHost{}; // sah cost is read by updateRefitHeuristic after the S1 fence
+		qualityToHost.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		qualityToHost.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		qualityToHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
 		vkCmdPipelineBarrier(
 			commandBuffer,
 			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_HOST_BIT,
 			0,
+			1,
+			&qualityToHost,
 			0,
 			nullptr,
+			0,
+			nullptr
+		);
+	}
+	auto Raytracer::recordCollapseBVH4(VkCommandBuffer commandBuffer) -> void {
+		VkMemoryBarrier builtBarrier{}; // whichever builder ran last wrote the nodes and parents
+		builtBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		builtBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		builtBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
 			1,
-			&bvhBarrier,
+			&builtBarrier,
+			0,
+			nullptr,
 			0,
 			nullptr
 		);
 
-		this->constructAABBPipeline->bind(commandBuffer);
+		this->collapseBVH4Pipeline->bind(commandBuffer);
 		vkCmdBindDescriptorSets(
 			commandBuffer,
 			VK_PIPELINE_BIND_POINT_COMPUTE,
-			this->constructAABBPipelineLayout,
+			this->collapseBVH4PipelineLayout,
 			0,
 			1,
-			&this->constructAABBDescriptorSets[0],
+			&this->collapseBVH4DescriptorSets[0],
 			0,
 			nullptr
 		);
-		vkCmdDispatch(commandBuffer, ((this->scene->getTriangleCount() + this->scene->getSphereCount()) / 32) + 1, 1, 1);
-
-		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-			throw std::runtime_error("failed to record compute command buffer!");
-		}
-		firstRun = false;
+		CollapsePushConstants push{ this->compressedBVH };
+		vkCmdPushConstants(commandBuffer, this->collapseBVH4PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+		this->beginProfiledPass(commandBuffer, GPUPass::CollapseBVH4);
+		vkCmdDispatch(commandBuffer, ((this->scene->getTriangleCount() + this->scene->getSphereCount()) / 256) + 1, 1, 1);
+		this->endProfiledPass(commandBuffer, GPUPass::CollapseBVH4);
 	}
 	auto Raytracer::recordComputeS2CommandBuffer(VkCommandBuffer commandBuffer, u32 currImageIndex) -> void {
 		VkCommandBufferBeginInfo beginInfo{};
@@ -1010,7 +1903,33 @@ namespace RaytracerBVHRenderer {
 			throw std::runtime_error("failed to begin recording compute command buffer!");
 		}
 
-		VkExtent2D imageSize = this->swapChain->getSwapChainExtent();
+		if (this->asyncBVHBuild)
+			this->recordComputeImageClear(commandBuffer);
+
+		if (this->traversalStats) { // counters cover the whole frame, so zero them before the first dispatch
+			vkCmdFillBuffer(commandBuffer, this->traversalStatsBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+			VkBufferMemoryBarrier clearToTrace{};
+			clearToTrace.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			clearToTrace.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			clearToTrace.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			clearToTrace.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			clearToTrace.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			clearToTrace.buffer = this->traversalStatsBuffer->getBuffer();
+			clearToTrace.offset = 0;
+			clearToTrace.size = VK_WHOLE_SIZE;
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				0, nullptr,
+				1, &clearToTrace,
+				0, nullptr
+			);
+		}
+
+		VkExtent2D imageSize = this->imageExtent;
+		this->beginProfiledPass(commandBuffer, GPUPass::Raytrace); // covers every rays-per-pixel dispatch
 		this->raytracePipeline->bind(commandBuffer);
 		vkCmdBindDescriptorSets(
 			commandBuffer,
@@ -1018,10 +1937,12 @@ namespace RaytracerBVHRenderer {
 			this->raytracePipelineLayout,
 			0,
 			1,
-			&this->raytraceDescriptorSets[0],
+			&this->raytraceDescriptorSets[this->asyncBVHBuild ? this->tracedBVHSnapshot : 0],
 			0,
 			nullptr
 		);
+		RaytracePushConstants pushConstants{ 0, this->bvhWidth == 4, this->bvhBuilder == SceneTypes::BVHBuilder::TwoLevel, this->compressedBVH };
+		vkCmdPushConstants(commandBuffer, this->raytracePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(RaytracePushConstants), &pushConstants);
 		vkCmdDispatch(commandBuffer, (imageSize.width / 32) + 1, (imageSize.height / 32) + 1, 1); // assume once cause doesn't make much sense to go below that
 		// and need barrier between each dispatch but not before or after all
 		for (auto i = 1; i < this->scene->getRaysPerPixel(); i++) {
@@ -1046,8 +1967,53 @@ namespace RaytracerBVHRenderer {
 				1, &waitForLastTraceSet // 1 imageMemoryBarrier
 			);
 
+			pushConstants.sampleIndex = i;
+			vkCmdPushConstants(commandBuffer, this->raytracePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(RaytracePushConstants), &pushConstants);
 			vkCmdDispatch(commandBuffer, (imageSize.width / 32) + 1, (imageSize.height / 32) + 1, 1);
 		}
+		this->endProfiledPass(commandBuffer, GPUPass::Raytrace);
+
+		if (this->traversalStats) { // copy into host memory here so reading it back never needs another submit
+			VkBufferMemoryBarrier traceToCopy{};
+			traceToCopy.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			traceToCopy.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			traceToCopy.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			traceToCopy.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			traceToCopy.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			traceToCopy.buffer = this->traversalStatsBuffer->getBuffer();
+			traceToCopy.offset = 0;
+			traceToCopy.size = VK_WHOLE_SIZE;
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				0,
+				0, nullptr,
+				1, &traceToCopy,
+				0, nullptr
+			);
+			VkBufferCopy copyRegion{};
+			copyRegion.size = this->traversalStatsBuffer->getBufferSize();
+			vkCmdCopyBuffer(commandBuffer, this->traversalStatsBuffer->getBuffer(), this->traversalStatsReadbackBuffer->getBuffer(), 1, &copyRegion);
+			VkBufferMemoryBarrier copyToHost{};
+			copyToHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			copyToHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			copyToHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			copyToHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			copyToHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			copyToHost.buffer = this->traversalStatsReadbackBuffer->getBuffer();
+			copyToHost.offset = 0;
+			copyToHost.size = VK_WHOLE_SIZE;
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_HOST_BIT,
+				0,
+				0, nullptr,
+				1, &copyToHost,
+				0, nullptr
+			);
+		}
 
 		// TODO sync2: https://github.com/KhronosGroup/Vulkan-Docs/wiki/Synchronization-Examples#dispatch-writes-into-a-storage-image-draw-samples-that-image-in-a-fragment-shader
 		VkImageMemoryBarrier computeToPresent;
@@ -1147,4 +2113,98 @@ namespace RaytracerBVHRenderer {
 			throw std::runtime_error("failed to acquire next image!");
 		return nextImageIndex;
 	}
+	auto Raytracer::readTraversalStatistics() -> TraversalStatistics {
+		const auto* words = static_cast<const u32*>(this->traversalStatsReadbackBuffer->getMappedMemory());
+		const auto total = [words](TraversalStat stat) -> u64 {
+			const u32 offset = static_cast<u32>(stat);
+			return (static_cast<u64>(words[offset + 1]) << 32) | words[offset];
+		};
+		TraversalStatistics statistics{};
+		statistics.rays = total(TraversalStat::Rays);
+		statistics.aabbTests = total(TraversalStat::AABBTests);
+		statistics.nodesVisited = total(TraversalStat::NodesVisited);
+		statistics.triangleTests = total(TraversalStat::TriangleTests);
+		statistics.sphereTests = total(TraversalStat::SphereTests);
+		statistics.stackDepthSum = total(TraversalStat::StackDepthSum);
+		statistics.maxStackDepth = words[static_cast<u32>(TraversalStat::MaxStackDepth)];
+		return statistics;
+	}
+	auto Raytracer::readBVHSAHCost() const -> f32 {
+		return *static_cast<const f32*>(this->bvhQualityBuffer->getMappedMemory());
+	}
+	auto Raytracer::updateRefitHeuristic() -> void {
+		const f32 sahCost = this->readBVHSAHCost();
+		if (!this->lastS1Refit) {
+			this->builtSAHCost = sahCost;
+			this->bvhRebuildNeeded = false;
+			return;
+		}
+		// refitting never changes which primitives share a node, so the cost only drifts as they move apart
+		const f32 growth = 1.0f + static_cast<f32>(Config::get().refitRebuildSAHGrowth) / 100.0f;
+		this->bvhRebuildNeeded = sahCost > this->builtSAHCost * growth;
+	}
+	auto Raytracer::readComputeImage() -> std::vector<f32> {
+		// computeImage is left in SHADER_READ_ONLY_OPTIMAL by the end of S2
+		const auto transition = [this](VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess) {
+			VkCommandBuffer commandBuffer = this->device.beginSingleTimeCommands(this->device.getComputeCommandPool());
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = srcAccess;
+			barrier.dstAccessMask = dstAccess;
+			barrier.oldLayout = oldLayout;
+			barrier.newLayout = newLayout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = this->computeImage;
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+				VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				1, &barrier
+			);
+			this->device.endSingleTimeCommands(this->device.computeQueue(), this->device.getComputeCommandPool(), commandBuffer);
+		};
+		const u64 texelCount = static_cast<u64>(this->imageExtent.width) * this->imageExtent.height;
+		Buffer stagingBuffer(
+			this->device,
+			sizeof(f32) * 4, // R32G32B32A32_SFLOAT
+			static_cast<u32>(texelCount),
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+		transition(
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT
+		);
+		this->device.copyImageToBuffer(
+			this->device.computeQueue(),
+			this->device.getComputeCommandPool(),
+			this->computeImage,
+			stagingBuffer.getBuffer(),
+			this->imageExtent.width,
+			this->imageExtent.height,
+			1
+		);
+		transition(
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_READ_BIT, 0
+		);
+
+		stagingBuffer.map();
+		const f32* texels = reinterpret_cast<const f32*>(stagingBuffer.getMappedMemory());
+		std::vector<f32> rgba(texels, texels + texelCount * 4);
+		stagingBuffer.unmap();
+		return rgba;
+	}
+	auto Raytracer::saveComputeImage(const std::string& path) -> void {
+		if (this->heatmap)
+			Util::writeHeatmapImage(path, this->imageExtent.width, this->imageExtent.height, this->readComputeImage(), this->scene->getRaysPerPixel(), static_cast<f32>(Config::get().heatmapMaxCost));
+		else
+			Util::writeAccumulatedImage(path, this->imageExtent.width, this->imageExtent.height, this->readComputeImage(), this->scene->getRaysPerPixel());
+		std::cout << std::format("wrote {}x{} image to {}\n", this->imageExtent.width, this->imageExtent.height, path);
+	}
 };
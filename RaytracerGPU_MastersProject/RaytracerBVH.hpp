@@ -17,7 +17,18 @@
 #include "VulkanWrapper/GraphicsPipeline.hpp"
 #include "VulkanWrapper/Buffer.hpp"
 #include "VulkanWrapper/Descriptors.hpp"
-
+#include "VulkanWrapper/GPUProfiler.hpp"
+#include "VulkanWrapper/RadixSort.hpp"
+#include "VulkanWrapper/PLOC.hpp"
+#include "VulkanWrapper/LeafCollapse.hpp"
+#include "CPU/LBVH.hpp"
+#include "CPU/BinnedSAH.hpp"
+#include "CPU/TwoLevelBVH.hpp"
+#include "CPU/BVHAnalysis.hpp"
+#include "utils/ImageIO.hpp"
+#include "utils/Telemetry.hpp"
+
+#include <array>
 #include <chrono>
 #include "VulkanWrapper/RaytraceScene.hpp"
 #include <random>
@@ -26,6 +37,7 @@
 #include <stdexcept>
 #include <bitset>
 #include "VulkanWrapper/SceneTypes.hpp"
+#include "Scenes.hpp"
 
 namespace RaytracerBVHRenderer {
 	struct RaytracingUniformBufferObject {
@@ -39,6 +51,47 @@ namespace RaytracerBVHRenderer {
 		u32 numLights;
 		u32 maxRayTraceDepth;
 		u32 randomState;
+		u32 frameIndex; // deterministic seeding only
+		u32 userSeed;
+		u32 deterministicSeeding;
+		u32 wideMortonCodes; // 63 bit morton codes, see mortonCodeBits
+		u32 mortonExtentBits;
+	};
+	struct TreeletPushConstants { // OptimizeTreelets
+		u32 minSubtreePrimitives;
+	};
+	struct CollapsePushConstants { // CollapseBVH4
+		u32 compress; // compressedBVH, write CompressedBVH4Nodes instead of BVH4Nodes
+	};
+	constexpr const u32 COMPRESSED_RANGE_FIRST_MASK = 0x1FFFFFF; // COMPRESSED_RANGE_FIRST_MASK in definitions.glsl
+	constexpr const u32 TREELET_LEAVES = 7; // TREELET_LEAVES in OptimizeTreelets.comp, also the first round's minSubtreePrimitives
+	struct RaytracePushConstants {
+		u32 sampleIndex; // which of the rays per pixel dispatches this is
+		u32 wideBVH; // bvhWidth 4, trace the BVH4 nodes
+		u32 twoLevel; // BVHBuilder::TwoLevel, trace the TLAS and the instances' BLAS
+		u32 compressedBVH; // with wideBVH, trace the compressed BVH4 nodes
+	};
+	enum struct TraversalStat : u32 { // word offsets into the traversal stats buffer, match the STAT_ defines in raytraceBVH.comp
+		Rays = 0, // totals are (low, high) u32 pairs
+		AABBTests = 2,
+		NodesVisited = 4,
+		TriangleTests = 6,
+		SphereTests = 8,
+		StackDepthSum = 10,
+		MaxStackDepth = 12, // single word
+		WordCount = 13
+	};
+	struct TraversalStatistics { // one frame, every rays per pixel dispatch
+		u64 rays; // sceneHit calls, so bounces included
+		u64 aabbTests;
+		u64 nodesVisited; // aabb tests that hit
+		u64 triangleTests;
+		u64 sphereTests;
+		u64 stackDepthSum;
+		u32 maxStackDepth;
+
+		auto averageStackDepth() const -> f64 { return this->aabbTests > 0 ? static_cast<f64>(this->stackDepthSum) / this->aabbTests : 0.0; }
+		auto aabbTestsPerRay() const -> f64 { return this->rays > 0 ? static_cast<f64>(this->aabbTests) / this->rays : 0.0; }
 	};
 	struct EnclosingAABBBufferObject {
 		alignas(16) glm::vec3 min;
@@ -46,40 +99,89 @@ namespace RaytracerBVHRenderer {
 	};
 	struct FragmentUniformBufferObject {
 		u32 raysPerPixel; // used in gamma correction
+		u32 visualizationMode; // 0 radiance, 1 traversal cost heatmap
+		f32 heatmapMaxCost;
+	};
+
+	enum struct GPUPass : u32 { // order matches the names given to the profiler in createProfiler
+		ModelToWorld,
+		EnclosingAABB,
+		MortonCodes,
+		RadixSort,
+		ConstructHLBVH,
+		ConstructAABBs,
+		PLOC, // instead of ConstructHLBVH and ConstructAABBs, for scenes built with BVHBuilder::PLOC
+		OptimizeTreelets,
+		LeafCollapse, // maxLeafPrimitives > 1 only
+		RefitBVH, // bvhRefit only, every frame either refits or measures the fresh build
+		CollapseBVH4, // bvhWidth 4 only
+		Raytrace
+	};
+
+	// telemetry names for each GPUPass, also given to the profiler
+	constexpr const std::array<const char*, 12> GPU_PASS_NAMES = {
+		"ModelSpaceToWorldSpace",
+		"GetEnclosingAABB",
+		"GenerateMortonCodesOfPrimitives",
+		"RadixSort",
+		"ConstructHLBVH",
+		"ConstructAABBsOfInternalNodes",
+		"PLOC",
+		"OptimizeTreelets",
+		"LeafCollapse",
+		"RefitBVH",
+		"CollapseBVH4",
+		"raytraceBVH"
+	};
+
+	struct FrameTimings {
+		f64 frameMs; // cpu wall clock for the whole iteration
+		f64 bvhBuildMs; // S1. gpu time when the profiler is available, cpu wait time otherwise (asyncBVHBuild: what the trace didn't hide)
+		f64 raytraceMs; // S2. same as above
+		bool fromGPUTimestamps;
+		TraversalStatistics traversal; // zeroed unless --traversalStats
 	};
 
 	class Raytracer {
-		Window window;
+		std::unique_ptr<Window> window; // nullptr when headless
 		Device device;
 		//Renderer renderer{ window, device };
 
 		// createSwapChain
-		std::unique_ptr<SwapChain> swapChain;
+		std::unique_ptr<SwapChain> swapChain; // nullptr when headless
+		VkExtent2D imageExtent; // size of computeImage. swapchain extent or the requested headless size
 
 		// createComputeDescriptorSetLayout
 		std::unique_ptr<DescriptorSetLayout> modelToWorldDescriptorSetLayout;
 		std::unique_ptr<DescriptorSetLayout> enclosingAABBDescriptorSetLayout;
 		std::unique_ptr<DescriptorSetLayout> generateMortonCodeDescriptorSetLayout;
-		std::unique_ptr<DescriptorSetLayout> radixSortDescriptorSetLayout;
 		std::unique_ptr<DescriptorSetLayout> constructHLBVHDescriptorSetLayout;
 		std::unique_ptr<DescriptorSetLayout> constructAABBDescriptorSetLayout;
+		std::unique_ptr<DescriptorSetLayout> optimizeTreeletsDescriptorSetLayout;
+		std::unique_ptr<DescriptorSetLayout> collapseBVH4DescriptorSetLayout;
+		std::unique_ptr<DescriptorSetLayout> refitBVHDescriptorSetLayout;
 		std::unique_ptr<DescriptorSetLayout> raytraceDescriptorSetLayout;
 		std::unique_ptr<DescriptorSetLayout> graphicsDescriptorSetLayout;
 
 		// createComputePipeline
 		std::unique_ptr<ComputePipeline> modelToWorldPipeline;
 		std::unique_ptr<ComputePipeline> enclosingAABBPipeline;
+		std::unique_ptr<ComputePipeline> enclosingAABBFinalizePipeline; // same layout and descriptor set as enclosingAABBPipeline
 		std::unique_ptr<ComputePipeline> generateMortonCodePipeline;
-		std::unique_ptr<ComputePipeline> radixSortComputePipeline;
 		std::unique_ptr<ComputePipeline> constructHLBVHComputePipeline;
 		std::unique_ptr<ComputePipeline> constructAABBPipeline;
+		std::unique_ptr<ComputePipeline> optimizeTreeletsPipeline;
+		std::unique_ptr<ComputePipeline> collapseBVH4Pipeline;
+		std::unique_ptr<ComputePipeline> refitBVHPipeline;
 		std::unique_ptr<ComputePipeline> raytracePipeline;
 		VkPipelineLayout modelToWorldPipelineLayout;
 		VkPipelineLayout enclosingAABBPipelineLayout;
 		VkPipelineLayout generateMortonCodePipelineLayout;
-		VkPipelineLayout radixSortPipelineLayout;
 		VkPipelineLayout constructHLBVHPipelineLayout;
 		VkPipelineLayout constructAABBPipelineLayout;
+		VkPipelineLayout optimizeTreeletsPipelineLayout;
+		VkPipelineLayout collapseBVH4PipelineLayout;
+		VkPipelineLayout refitBVHPipelineLayout;
 		VkPipelineLayout raytracePipelineLayout;
 
 		// createComputeImage
@@ -90,17 +192,56 @@ namespace RaytracerBVHRenderer {
 
 		// createGraphicsPipeline
 		std::unique_ptr<GraphicsPipeline> graphicsPipeline;
-		VkPipelineLayout graphicsPipelineLayout;
+		VkPipelineLayout graphicsPipelineLayout = VK_NULL_HANDLE;
 
 		// createShaderStorageBuffers
 		std::unique_ptr<RaytraceScene> scene;
+		SceneFunction sceneFunction; // fills the scene in createScene
 		std::unique_ptr<Buffer> enclosingAABBBuffer;
 		std::unique_ptr<Buffer> mortonPrimitiveBuffer1;
 		std::unique_ptr<Buffer> mortonPrimitiveBuffer2;
+		std::unique_ptr<RadixSort> radixSort; // sorts mortonPrimitiveBuffer1, using mortonPrimitiveBuffer2 as scratch
+		u32 mortonCodeBits = 30; // 30 or 63, set in createScene
+		u32 mortonExtentBits = Config::get().mortonExtentBits;
+		u32 treeletOptimizationRounds = Config::get().treeletOptimizationRounds;
+		SceneTypes::BVHBuilder bvhBuilder = SceneTypes::BVHBuilder::LBVH; // the scene's, unless Config bvhBuilder overrides it. set in createScene
+		std::unique_ptr<PLOC> ploc; // only created for BVHBuilder::PLOC
 		std::unique_ptr<Buffer> HLBVHNodesBuffer;
 		std::unique_ptr<Buffer> HLBVHConstructionInfoBuffer;
+		std::unique_ptr<Buffer> HLBVHTreeletInfoBuffer; // per node sah cost and primitive count, OptimizeTreelets and RefitBVH
+		u32 bvhWidth = Config::get().bvhWidth;
+		std::unique_ptr<Buffer> BVH4NodesBuffer; // CollapseBVH4 output, indexed like the binary internal nodes
+		bool compressedBVH = Config::get().compressedBVH;
+		std::unique_ptr<Buffer> compressedBVH4NodesBuffer; // CollapseBVH4 output instead of BVH4NodesBuffer when compressedBVH
+		u32 maxLeafPrimitives = Config::get().maxLeafPrimitives;
+		std::unique_ptr<LeafCollapse> leafCollapse; // only created when maxLeafPrimitives > 1
+		std::unique_ptr<Buffer> primitiveReferenceBuffer; // LeafCollapse's depth first primitives, raytrace binding 8
+		bool leafRangesCollapsed = false; // BinnedSAH trees are only built once, so only collapsed once
+		bool bvhRefit = Config::get().bvhRefit; // ignored for BinnedSAH, which never rebuilds anyway
+		std::unique_ptr<Buffer> bvhQualityBuffer; // host visible, RefitBVH writes the root's sah cost into it
+		bool bvhRebuildNeeded = true; // set after every bvhRefit S1 from the sah cost read back
+		bool lastS1Refit = false; // whether the S1 just recorded only refit the boxes
+		f32 builtSAHCost = 0.0f; // sah cost of the tree as last fully built, what refits are compared against
+		std::unique_ptr<CPU::TwoLevelBVH> twoLevelBVH; // only created for BVHBuilder::TwoLevel, BLAS live in HLBVHNodesBuffer
+		std::unique_ptr<Util::WorkStealingScheduler> tlasScheduler; // one thread, the TLAS is small enough to build inline
+		std::vector<SceneTypes::GPU::Instance> hostInstances;
+		std::vector<SceneTypes::GPU::BVHNode> hostTLASNodes; // as last uploaded, for analyseBVH
+		std::unique_ptr<Buffer> tlasNodesBuffer; // host visible, raytrace binding 9. rewritten every frame by updateTLAS
+		std::unique_ptr<Buffer> instanceBuffer; // host visible, raytrace binding 10
+		bool asyncBVHBuild = Config::get().asyncBVHBuild; // cleared in createScene for the builders that don't rebuild on the gpu
+		struct BVHSnapshot { // asyncBVHBuild. everything S2 reads that S1 writes, copied at the end of S1
+			std::unique_ptr<Buffer> triangles; // world space, as ModelSpaceToWorldSpace leaves them
+			std::unique_ptr<Buffer> spheres;
+			std::unique_ptr<Buffer> nodes;
+			std::unique_ptr<Buffer> bvh4Nodes;
+			std::unique_ptr<Buffer> compressedBVH4Nodes;
+			std::unique_ptr<Buffer> primitiveReferences;
+		};
+		std::array<BVHSnapshot, 2> bvhSnapshots; // one filled by this frame's S1 while S2 traces the other
 		// temp buffers for debugging
 		std::unique_ptr<Buffer> scratchBuffer;
+		std::unique_ptr<Buffer> traversalStatsBuffer; // raytrace binding 6, only written by the TRAVERSAL_STATS shader build
+		std::unique_ptr<Buffer> traversalStatsReadbackBuffer; // host visible, copied into at the end of S2
 
 		// createUniformBuffers
 		std::unique_ptr<Buffer> rayUniformBuffer;
@@ -110,9 +251,11 @@ namespace RaytracerBVHRenderer {
 		std::unique_ptr<DescriptorPool> modelToWorldDescriptorPool;
 		std::unique_ptr<DescriptorPool> enclosingAABBDescriptorPool;
 		std::unique_ptr<DescriptorPool> generateMortonCodeDescriptorPool;
-		std::unique_ptr<DescriptorPool> radixSortDescriptorPool;
 		std::unique_ptr<DescriptorPool> constructHLBVHDescriptorPool;
 		std::unique_ptr<DescriptorPool> constructAABBDescriptorPool;
+		std::unique_ptr<DescriptorPool> optimizeTreeletsDescriptorPool;
+		std::unique_ptr<DescriptorPool> collapseBVH4DescriptorPool;
+		std::unique_ptr<DescriptorPool> refitBVHDescriptorPool;
 		std::unique_ptr<DescriptorPool> raytraceDescriptorPool;
 		std::unique_ptr<DescriptorPool> graphicsDescriptorPool;
 
@@ -120,9 +263,11 @@ namespace RaytracerBVHRenderer {
 		std::vector<VkDescriptorSet> modelToWorldDescriptorSets;
 		std::vector<VkDescriptorSet> enclosingAABBDescriptorSets;
 		std::vector<VkDescriptorSet> generateMortonCodeDescriptorSets;
-		std::vector<VkDescriptorSet> radixSortDescriptorSets;
 		std::vector<VkDescriptorSet> constructHLBVHDescriptorSets;
 		std::vector<VkDescriptorSet> constructAABBDescriptorSets;
+		std::vector<VkDescriptorSet> optimizeTreeletsDescriptorSets;
+		std::vector<VkDescriptorSet> collapseBVH4DescriptorSets;
+		std::vector<VkDescriptorSet> refitBVHDescriptorSets;
 		std::vector<VkDescriptorSet> raytraceDescriptorSets;
 		std::vector<VkDescriptorSet> graphicsDescriptorSets;
 
@@ -133,14 +278,35 @@ namespace RaytracerBVHRenderer {
 
 		VkFence computeS1Complete;
 		VkFence computeS2Complete;
+		// asyncBVHBuild. S1 signals its snapshot's semaphore on the async compute queue and the S2 tracing that snapshot
+		// waits on it. S2 is still waited on every frame, so the next S1 into the same snapshot never needs a semaphore
+		std::array<VkSemaphore, 2> bvhSnapshotReady{};
+		std::array<bool, 2> bvhSnapshotReadyPending{}; // signalled by an S1 and not waited on by any S2 yet
+		u32 nextBVHSnapshot = 0; // the one the next S1 fills
+		u32 tracedBVHSnapshot = 0; // the one the S2 being recorded reads
+		bool bvhSnapshotBuilt = false; // an S1 has been submitted, so S2 traces the previous frame's snapshot
 
-		// mainLoop -> doIteration
-		u32 iteration;
+		// createProfiler
+		std::unique_ptr<GPUProfiler> profiler; // nullptr when --gpuProfiling is off
 
-		std::mt19937 gen{ static_cast<u32>(std::chrono::system_clock::now().time_since_epoch().count()) };
+		// mainLoop -> doIteration
+		u32 iteration = 0;
+		bool firstRun; // computeImage is still VK_IMAGE_LAYOUT_UNDEFINED until recordComputeImageClear first runs
+		std::chrono::high_resolution_clock::time_point iterationCurrentTime; // end of the previous doIteration phase
+		std::chrono::high_resolution_clock::time_point iterationNewTime;
+
+		std::mt19937 gen{
+			Config::get().deterministicSeeding
+				? Config::get().seed
+				: static_cast<u32>(std::chrono::system_clock::now().time_since_epoch().count())
+		};
 		const f32 scratchSize = 20;
 
-		std::vector<std::vector<std::chrono::microseconds>> times;
+		bool traversalStats = Config::get().traversalStats;
+		bool heatmap = Config::get().heatmap;
+		bool heatmapClock = false; // heatmapClock requested and the device has shader clock, set in createComputePipeline
+		bool deterministicSeeding = Config::get().deterministicSeeding;
+		u32 userSeed = Config::get().seed;
 
 		auto initVulkan() -> void {
 			/* Device
@@ -152,31 +318,44 @@ namespace RaytracerBVHRenderer {
 				this->createCommandPool();
 			*/
 			// SwapChain
-			this->createSwapChain();
+			if (!this->isHeadless())
+				this->createSwapChain();
 			/*
 				this->createImageViews();
 				this->createRenderPass();
 				this->createFrameBuffers();
 			*/
 			this->createComputeDescriptorSetLayout();
-			this->createGraphicsDescriptorSetLayout();
+			if (!this->isHeadless())
+				this->createGraphicsDescriptorSetLayout();
 			this->createComputePipelineLayout();
 			this->createComputePipeline();
 			this->createComputeImage();
-			this->createGraphicsPipeline();
+			if (!this->isHeadless())
+				this->createGraphicsPipeline();
 
 			this->createUniformBuffers();			// in ubo
 			this->createScene();					// in ssbo
 
 			this->createComputeDescriptorPool();
 			this->createComputeDescriptorSets();
-			this->createGraphicsDescriptorPool();
-			this->createGraphicsDescriptorSets();
+			if (!this->isHeadless()) {
+				this->createGraphicsDescriptorPool();
+				this->createGraphicsDescriptorSets();
+			}
 
 			this->createComputeCommandBuffers();
-			this->createGraphicsCommandBuffers();
+			if (!this->isHeadless())
+				this->createGraphicsCommandBuffers();
+			this->createFences();
+			if (Config::get().gpuProfiling && this->asyncBVHBuild)
+				Util::Telemetry::message(Util::Telemetry::Level::Info, "profiler", "GPU profiler disabled, asyncBVHBuild records S1 and S2 on different queues");
+			else if (Config::get().gpuProfiling)
+				this->createProfiler();
 		}
 
+		auto isHeadless() const -> bool { return this->window == nullptr; }
+
 		auto createSwapChain() -> void;
 
 		auto createComputeDescriptorSetLayout() -> void;
@@ -202,11 +381,29 @@ namespace RaytracerBVHRenderer {
 
 		auto createComputeCommandBuffers() -> void;
 		auto createGraphicsCommandBuffers() -> void;
+		auto createFences() -> void;
+		auto createProfiler() -> void;
 
-		auto doIteration(f32 frameTime) -> void {
-			static auto currentTime = std::chrono::high_resolution_clock::now();
-			static auto newTime = std::chrono::high_resolution_clock::now();
-			std::cout << std::format("iteration: {}\n", this->iteration);
+		auto beginProfiledPass(VkCommandBuffer commandBuffer, GPUPass pass) -> void {
+			if (this->profiler)
+				this->profiler->beginPass(commandBuffer, static_cast<u32>(pass));
+		}
+		auto endProfiledPass(VkCommandBuffer commandBuffer, GPUPass pass) -> void {
+			if (this->profiler)
+				this->profiler->endPass(commandBuffer, static_cast<u32>(pass));
+		}
+
+		auto doIteration(f32 frameTime) -> FrameTimings {
+			auto& currentTime = this->iterationCurrentTime;
+			auto& newTime = this->iterationNewTime;
+			const auto iterationStart = std::chrono::high_resolution_clock::now();
+			const auto endPhase = [&](const char* name) -> std::chrono::microseconds { // cpu time since the previous phase ended
+				newTime = std::chrono::high_resolution_clock::now();
+				Util::Telemetry::span(Util::Telemetry::Level::Frame, "cpu", name, this->iteration, currentTime, newTime);
+				const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(newTime - currentTime);
+				currentTime = newTime;
+				return elapsed;
+			};
 
 			constexpr const auto materialTypeToString = [](SceneTypes::MaterialType mt) -> std::string {
 				return mt == SceneTypes::MaterialType::DIFFUSE
@@ -222,7 +419,7 @@ namespace RaytracerBVHRenderer {
 							)
 						);
 				};
-			if constexpr (Config::ShowBufferDebug) {
+			if (Config::get().showBufferDebug) {
 				if (this->iteration > 0) {
 					std::cout << "after\n";
 					auto spheres = this->DEBUGgetDeployedBufferAs<SceneTypes::GPU::Sphere>(
@@ -261,22 +458,33 @@ namespace RaytracerBVHRenderer {
 			}
 
 			// fences are for syncing cpu and gpu. semaphores are for specifying the order of gpu tasks
-			u32 imageIndex = this->getNextImageIndex(); // await graphics completion
+			u32 imageIndex = this->isHeadless() ? 0 : this->getNextImageIndex(); // await graphics completion
 			u32 frameIndex = imageIndex % SwapChain::MAX_FRAMES_IN_FLIGHT;
 			// number of frames currently rendering and number of images in swap chain are not the same
 
-			newTime = std::chrono::high_resolution_clock::now();
-			auto prevPresentTime = std::chrono::duration_cast<std::chrono::microseconds>(newTime - currentTime);
-			currentTime = newTime;
+			endPhase("prevPresent");
+
+			std::chrono::microseconds asyncBuildWait{};
+			if (this->asyncBVHBuild && this->bvhSnapshotBuilt) { // the last frame's S1 still uses the buffers updateScene writes
+				const auto waitStart = std::chrono::high_resolution_clock::now();
+				if (vkWaitForFences(this->device.device(), 1, &this->computeS1Complete, VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+					throw std::runtime_error("failed to wait for the async bvh build!");
+				asyncBuildWait = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - waitStart);
+				if (this->bvhRefit)
+					this->updateRefitHeuristic();
+			}
 
 			this->scene->updateScene();
-			this->scene->getCamera().updateCameraForFrame(this->window, frameTime, this->swapChain->extentAspectRatio());
+			if (this->twoLevelBVH)
+				this->updateTLAS(); // the previous frame's S2 was waited on, nothing reads the TLAS buffers now
+			if (this->isHeadless())
+				this->scene->getCamera().updateCameraForFrame(static_cast<f32>(this->imageExtent.width) / static_cast<f32>(this->imageExtent.height));
+			else
+				this->scene->getCamera().updateCameraForFrame(*this->window, frameTime, this->swapChain->extentAspectRatio());
 
-			newTime = std::chrono::high_resolution_clock::now();
-			auto updateSceneTime = std::chrono::duration_cast<std::chrono::microseconds>(newTime - currentTime);
-			currentTime = newTime;
+			endPhase("updateScene");
 
-			if constexpr (Config::ShowBufferDebug) {
+			if (Config::get().showBufferDebug) {
 				auto resultFromGPU = this->DEBUGgetDeployedBufferAs<SceneTypes::GPU::Model>(
 					this->scene->getModelBuffer()->getBuffer(),
 					this->scene->getModelCount()
@@ -290,7 +498,7 @@ namespace RaytracerBVHRenderer {
 					);
 				}
 			}
-			/*if constexpr (Config::ShowBufferDebug) {
+			/*if (Config::get().showBufferDebug) {
 				std::cout << "before\n";
 				auto resultFromGPU = this->DEBUGgetDeployedBufferAs<SceneTypes::GPU::Sphere>(
 					this->scene->getSphereBuffer()->getBuffer(),
@@ -315,7 +523,7 @@ namespace RaytracerBVHRenderer {
 					);
 				}
 			}*/
-			if constexpr (Config::ShowBufferDebug) {
+			if (Config::get().showBufferDebug) {
 				auto resultFromGPU = this->DEBUGgetDeployedBufferAs<f32>(
 					this->scratchBuffer->getBuffer(),
 					this->scratchSize
@@ -327,15 +535,20 @@ namespace RaytracerBVHRenderer {
 				}
 			}
 
+			if (this->profiler)
+				this->profiler->collect(); // previous frames' timestamps, never waits
+
+			if (this->asyncBVHBuild) // the previous frame's build, unless this frame's is the first
+				this->tracedBVHSnapshot = this->bvhSnapshotBuilt ? this->nextBVHSnapshot ^ 1 : this->nextBVHSnapshot;
+
 			// imageIndex = index of image in swapchain
 			// frameIndex = index of frame in flight (ie, set of buffers to use to direct gpu)
 			this->recordComputeS1CommandBuffer(this->computeS1CommandBuffers[frameIndex], imageIndex);
 			this->recordComputeS2CommandBuffer(this->computeS2CommandBuffers[frameIndex], imageIndex);
-			this->recordGraphicsCommandBuffer(this->graphicsCommandBuffer, imageIndex);
+			if (!this->isHeadless())
+				this->recordGraphicsCommandBuffer(this->graphicsCommandBuffer, imageIndex);
 
-			newTime = std::chrono::high_resolution_clock::now();
-			auto rerecordCommandBuffersTime = std::chrono::duration_cast<std::chrono::microseconds>(newTime - currentTime);
-			currentTime = newTime;
+			endPhase("recordCommandBuffers");
 
 			RaytracerBVHRenderer::RaytracingUniformBufferObject rUbo{};
 			rUbo.camPos = glm::vec3(275.0f, 275.0f, -800.0f);
@@ -348,15 +561,22 @@ namespace RaytracerBVHRenderer {
 			rUbo.numLights = this->scratchSize;
 			rUbo.maxRayTraceDepth = this->scene->getMaxRaytraceDepth();
 			rUbo.randomState = this->gen();
+			rUbo.frameIndex = this->iteration;
+			rUbo.userSeed = this->userSeed;
+			rUbo.deterministicSeeding = this->deterministicSeeding;
+			rUbo.wideMortonCodes = this->mortonCodeBits == 63;
+			rUbo.mortonExtentBits = this->mortonExtentBits;
 			this->rayUniformBuffer->writeToBuffer(&rUbo);
 			this->rayUniformBuffer->flush(); // make visible to device
 
 			RaytracerBVHRenderer::FragmentUniformBufferObject fUbo{};
 			fUbo.raysPerPixel = this->scene->getRaysPerPixel();
+			fUbo.visualizationMode = this->heatmap ? 1 : 0;
+			fUbo.heatmapMaxCost = static_cast<f32>(Config::get().heatmapMaxCost);
 			this->fragUniformBuffer->writeToBuffer(&fUbo);
 			this->fragUniformBuffer->flush();
 
-			if constexpr (Config::ShowBufferDebug) {
+			if (Config::get().showBufferDebug) {
 				auto resultFromGPU = this->DEBUGgetDeployedBufferAs<RaytracerBVHRenderer::RaytracingUniformBufferObject>(
 					this->rayUniformBuffer->getBuffer(),
 					1
@@ -371,7 +591,7 @@ namespace RaytracerBVHRenderer {
 				);
 			}
 
-			if constexpr (Config::Fake1SecondDelay) { // fake 1 second delay
+			if (Config::get().fake1SecondDelay) { // fake 1 second delay
 				auto currentTime = std::chrono::high_resolution_clock::now();
 				auto newTime = std::chrono::high_resolution_clock::now();
 				while (std::chrono::duration<float, std::chrono::milliseconds::period>(newTime - currentTime).count() < 1000.0f)
@@ -389,25 +609,34 @@ namespace RaytracerBVHRenderer {
 
 			submitInfoS1.commandBufferCount = 1;
 			submitInfoS1.pCommandBuffers = &this->computeS1CommandBuffers[frameIndex];
+			if (this->asyncBVHBuild) {
+				submitInfoS1.signalSemaphoreCount = 1;
+				submitInfoS1.pSignalSemaphores = &this->bvhSnapshotReady[this->nextBVHSnapshot];
+			}
 
 			vkResetFences(this->device.device(), 1, &this->computeS1Complete);
-			newTime = std::chrono::high_resolution_clock::now();
-			auto flushUBOAndAwaitFenceComputeS1Time = std::chrono::duration_cast<std::chrono::microseconds>(newTime - currentTime);
-			currentTime = newTime;
+			endPhase("flushUBOAndAwaitFenceComputeS1");
 
-			auto subRes1 = vkQueueSubmit(this->device.computeQueue(), 1, &submitInfoS1, this->computeS1Complete);
+			auto subRes1 = vkQueueSubmit(
+				this->asyncBVHBuild ? this->device.asyncComputeQueue() : this->device.computeQueue(),
+				1, &submitInfoS1, this->computeS1Complete
+			);
 			if (subRes1 != VK_SUCCESS)
 				throw std::runtime_error("failed to submit compute command buffer!");
+			if (this->asyncBVHBuild)
+				this->bvhSnapshotReadyPending[this->nextBVHSnapshot] = true;
 
-			auto waitForComputeResult1 = vkWaitForFences(this->device.device(), 1, &this->computeS1Complete, VK_TRUE, UINT64_MAX);
-			if (waitForComputeResult1 != VK_SUCCESS)
-				throw std::runtime_error("failed to submit draw command buffer!");
+			if (!this->asyncBVHBuild || Config::get().showBufferDebug) { // async builds are waited on next frame, unless read back below
+				auto waitForComputeResult1 = vkWaitForFences(this->device.device(), 1, &this->computeS1Complete, VK_TRUE, UINT64_MAX);
+				if (waitForComputeResult1 != VK_SUCCESS)
+					throw std::runtime_error("failed to submit draw command buffer!");
+			}
 
-			newTime = std::chrono::high_resolution_clock::now();
-			auto compute1Time = std::chrono::duration_cast<std::chrono::microseconds>(newTime - currentTime);
-			currentTime = newTime;
+			auto compute1Time = endPhase("compute1");
+			if (this->bvhRefit && this->bvhBuilder != SceneTypes::BVHBuilder::BinnedSAH && !this->asyncBVHBuild)
+				this->updateRefitHeuristic(); // S1's fence was waited on, so the sah cost is ready
 			
-			if constexpr (true || Config::ShowBufferDebug) {
+			if (Config::get().showBufferDebug) {
 				auto mortonPrimitives = this->DEBUGgetDeployedBufferAs<SceneTypes::GPU::MortonPrimitive>(
 					this->mortonPrimitiveBuffer1->getBuffer(),
 					this->scene->getTriangleCount() + this->scene->getSphereCount()
@@ -424,9 +653,9 @@ namespace RaytracerBVHRenderer {
 				std::cout << "morton Primitives:\n";
 				for (auto i = 0; i < mortonPrimitives.size(); i++) {
 					std::cout << std::format(
-						"i: {}, primIndex: {}, primType: {}, mortPrim: 0b{:032b}\n",
+						"i: {}, primIndex: {}, primType: {}, mortPrim: 0b{:032b}{:032b}\n",
 						i, mortonPrimitives[i].primitiveIndex,
-						(mortonPrimitives[i].primitiveType == 0 ? "Sphere" : "Triangle"), mortonPrimitives[i].code
+						(mortonPrimitives[i].primitiveType == 0 ? "Sphere" : "Triangle"), mortonPrimitives[i].codeHigh, mortonPrimitives[i].code
 					);
 				}
 				/*
@@ -465,11 +694,16 @@ namespace RaytracerBVHRenderer {
 			submitInfoS2.pWaitDstStageMask = waitStages;
 			submitInfoS2.commandBufferCount = 1;
 			submitInfoS2.pCommandBuffers = &this->computeS2CommandBuffers[frameIndex];
+			VkPipelineStageFlags traceWaitStages[] = { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT }; // the clears before the trace don't read the snapshot
+			if (this->asyncBVHBuild && this->bvhSnapshotReadyPending[this->tracedBVHSnapshot]) {
+				submitInfoS2.waitSemaphoreCount = 1;
+				submitInfoS2.pWaitSemaphores = &this->bvhSnapshotReady[this->tracedBVHSnapshot];
+				submitInfoS2.pWaitDstStageMask = traceWaitStages;
+				this->bvhSnapshotReadyPending[this->tracedBVHSnapshot] = false;
+			}
 
 			vkResetFences(this->device.device(), 1, &this->computeS2Complete);
-			newTime = std::chrono::high_resolution_clock::now();
-			auto prepForCompute2Time = std::chrono::duration_cast<std::chrono::microseconds>(newTime - currentTime);
-			currentTime = newTime;
+			endPhase("prepForCompute2");
 
 			auto subRes2 = vkQueueSubmit(this->device.computeQueue(), 1, &submitInfoS2, this->computeS2Complete);
 
@@ -477,25 +711,78 @@ namespace RaytracerBVHRenderer {
 			if (waitForComputeResult2 != VK_SUCCESS)
 				throw std::runtime_error("failed to submit draw command buffer!");
 
-			newTime = std::chrono::high_resolution_clock::now();
-			auto compute2Time = std::chrono::duration_cast<std::chrono::microseconds>(newTime - currentTime);
-			currentTime = newTime;
-
-			this->swapChain->submitCommandBuffers(&this->graphicsCommandBuffer, &imageIndex);
-
-			std::cout << std::format(
-				"TIMINGS:"
-				"\n\tprevPresentTime: {}, Compute1Time: {}, compute2Time: {}"
-				"\n\tupdateSceneTime: {}, recordCommandBuffersTime: {}, flushUBOAndAwaitFenceComputeS1Time: {}, prepForCompute2Time: {}"
-				"\n\tTotal BVH Build Time: {}, Total Raytracing Time: {}, otherTime: {}\n",
-				prevPresentTime, compute1Time, compute2Time,
-				updateSceneTime, rerecordCommandBuffersTime, flushUBOAndAwaitFenceComputeS1Time, prepForCompute2Time,
-				updateSceneTime + rerecordCommandBuffersTime + flushUBOAndAwaitFenceComputeS1Time + compute1Time,
-				prepForCompute2Time + compute2Time, prevPresentTime
-			);
+			auto compute2Time = endPhase("compute2");
+			if (this->asyncBVHBuild) {
+				this->nextBVHSnapshot ^= 1;
+				this->bvhSnapshotBuilt = true;
+			}
+			TraversalStatistics traversal{};
+			if (this->traversalStats) // copied at the end of S2, so already visible after the fence
+				traversal = this->readTraversalStatistics();
+			if (this->profiler) {
+				this->profiler->endFrame();
+				this->profiler->collect(); // both fences were waited on, so this frame's results are ready
+			}
+
+			if (!this->isHeadless())
+				this->swapChain->submitCommandBuffers(&this->graphicsCommandBuffer, &imageIndex);
+
+			FrameTimings timings{};
+			timings.frameMs = std::chrono::duration<f64, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - iterationStart).count();
+			timings.fromGPUTimestamps = this->profiler && this->profiler->isSupported();
+			timings.traversal = traversal;
+			if (timings.fromGPUTimestamps) {
+				for (u32 pass = 0; pass < static_cast<u32>(GPUPass::Raytrace); pass++)
+					timings.bvhBuildMs += this->profiler->getStatistics(pass).lastMs;
+				timings.raytraceMs = this->profiler->getStatistics(static_cast<u32>(GPUPass::Raytrace)).lastMs;
+			}
+			else {
+				timings.bvhBuildMs = std::chrono::duration<f64, std::chrono::milliseconds::period>(this->asyncBVHBuild ? asyncBuildWait : compute1Time).count();
+				timings.raytraceMs = std::chrono::duration<f64, std::chrono::milliseconds::period>(compute2Time).count();
+			}
+			const u32 analysisInterval = Config::get().bvhAnalysisInterval;
+			if (analysisInterval > 0 && this->iteration % analysisInterval == 0 && Util::Telemetry::isEnabled(Util::Telemetry::Level::Info))
+				this->reportBVHAnalysis(); // after the timings, the readback would only inflate frameMs
+			if (!Util::Telemetry::isEnabled(Util::Telemetry::Level::Frame))
+				return timings;
+			const u32 frame = this->iteration;
+			Util::Telemetry::span(Util::Telemetry::Level::Frame, "cpu", "frame", frame, iterationStart, currentTime);
+			Util::Telemetry::counter(Util::Telemetry::Level::Frame, "frame", "bvhBuildMs", frame, timings.bvhBuildMs);
+			Util::Telemetry::counter(Util::Telemetry::Level::Frame, "frame", "raytraceMs", frame, timings.raytraceMs);
+			Util::Telemetry::counter(Util::Telemetry::Level::Debug, "frame", "raysPerPixel", frame, this->scene->getRaysPerPixel());
+			Util::Telemetry::counter(Util::Telemetry::Level::Debug, "frame", "maxRaytraceDepth", frame, this->scene->getMaxRaytraceDepth());
+			if (this->traversalStats) {
+				Util::Telemetry::counter(Util::Telemetry::Level::Frame, "traversal", "rays", frame, static_cast<f64>(traversal.rays));
+				Util::Telemetry::counter(Util::Telemetry::Level::Frame, "traversal", "aabbTests", frame, static_cast<f64>(traversal.aabbTests));
+				Util::Telemetry::counter(Util::Telemetry::Level::Frame, "traversal", "nodesVisited", frame, static_cast<f64>(traversal.nodesVisited));
+				Util::Telemetry::counter(Util::Telemetry::Level::Frame, "traversal", "triangleTests", frame, static_cast<f64>(traversal.triangleTests));
+				Util::Telemetry::counter(Util::Telemetry::Level::Frame, "traversal", "sphereTests", frame, static_cast<f64>(traversal.sphereTests));
+				Util::Telemetry::counter(Util::Telemetry::Level::Frame, "traversal", "averageStackDepth", frame, traversal.averageStackDepth());
+				Util::Telemetry::counter(Util::Telemetry::Level::Frame, "traversal", "maxStackDepth", frame, traversal.maxStackDepth);
+			}
+			if (this->bvhRefit && this->bvhBuilder != SceneTypes::BVHBuilder::BinnedSAH) {
+				if (!this->asyncBVHBuild) // an async S1 may still be writing it
+					Util::Telemetry::counter(Util::Telemetry::Level::Frame, "bvh", "sahCost", frame, this->readBVHSAHCost());
+				Util::Telemetry::counter(Util::Telemetry::Level::Frame, "bvh", "refit", frame, this->lastS1Refit ? 1.0 : 0.0);
+			}
+			if (timings.fromGPUTimestamps) {
+				for (u32 pass = 0; pass < this->profiler->getPassCount(); pass++)
+					Util::Telemetry::counter(Util::Telemetry::Level::Frame, "gpu", GPU_PASS_NAMES[pass], frame, this->profiler->getStatistics(pass).lastMs);
+			}
+			return timings;
 		}
 
 		auto recordComputeS1CommandBuffer(VkCommandBuffer, u32) -> void;
+		auto recordComputeImageClear(VkCommandBuffer) -> void; // start of S1, or of S2 with asyncBVHBuild
+		auto recordBVHSnapshotCopy(VkCommandBuffer) -> void; // end of S1 with asyncBVHBuild, into nextBVHSnapshot
+		auto recordLeafCollapse(VkCommandBuffer) -> void; // after the build when maxLeafPrimitives > 1
+		auto recordRefitBVH(VkCommandBuffer) -> void; // bvhRefit, instead of the build or after it
+		auto readBVHSAHCost() const -> f32;
+		auto updateTLAS() -> void; // TwoLevel, rebuilds the TLAS from this frame's model matrices
+		auto reportBVHAnalysis() -> void; // bvhAnalysisInterval, analyseBVH into telemetry
+		auto uploadBVHNodes(const std::vector<SceneTypes::GPU::BVHNode>&) -> void; // into HLBVHNodesBuffer, load time builders
+		auto updateRefitHeuristic() -> void; // picks whether the next S1 refits or rebuilds
+		auto recordCollapseBVH4(VkCommandBuffer) -> void; // end of S1 when bvhWidth is 4
 		auto recordComputeS2CommandBuffer(VkCommandBuffer, u32) -> void;
 		auto recordGraphicsCommandBuffer(VkCommandBuffer, u32) -> void;
 		auto beginRenderPass(VkCommandBuffer, u32) -> void;
@@ -503,72 +790,67 @@ namespace RaytracerBVHRenderer {
 
 		auto getNextImageIndex() -> u32;
 
+		auto reportProfiler() -> void { // once per run, per frame values go through telemetry
+			if (this->profiler && Config::get().logLevel >= Util::Telemetry::Level::Info)
+				std::cout << this->profiler->report();
+		}
+
+		auto readTraversalStatistics() -> TraversalStatistics;
+		auto readComputeImage() -> std::vector<f32>;
+		auto saveComputeImage(const std::string& path) -> void;
+
 		template <typename T, bool Compute = true>
 		auto DEBUGgetDeployedBufferAs(VkBuffer, u64) -> std::vector<T>;
 
 	public:
-		Raytracer();
+		Raytracer(SceneFunction sceneFunction = complexScene, u32 windowWidth = 800, u32 windowHeight = 800);
+		Raytracer(u32 width, u32 height, SceneFunction sceneFunction = complexScene); // headless, renders into an offscreen image of the given size
 		auto mainLoop() -> void {
 			auto currentTime = std::chrono::high_resolution_clock::now();
 
-			VkFenceCreateInfo fenceInfo{};
-			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-			fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-			if (vkCreateFence(this->device.device(), &fenceInfo, nullptr, &this->computeS1Complete) != VK_SUCCESS)
-				throw std::runtime_error("failed to create fence");
-			if (vkCreateFence(this->device.device(), &fenceInfo, nullptr, &this->computeS2Complete) != VK_SUCCESS)
-				throw std::runtime_error("failed to create fence");
-
-			if constexpr (Config::RunRayPerPixelIncreasingDemo) {
-				this->scene->setRaysPerPixel(Config::RayPerPixelIncreasingDemoConfig::startRaysPerPixel);
-			}
-
-			while (!this->window.shouldClose()) {
+			while (!this->window->shouldClose()) {
 				glfwPollEvents();
 				auto newTime = std::chrono::high_resolution_clock::now();
 				auto frameTime = std::chrono::duration_cast<std::chrono::microseconds>(newTime - currentTime);
 				currentTime = newTime;
-				std::cout << "Frame Time(us): " << frameTime
-					<< " RaysPerPixel: " << this->scene->getRaysPerPixel()
-					<< " Depth: " << this->scene->getMaxRaytraceDepth()
-					<< std::endl;
 				doIteration(std::chrono::duration<float, std::chrono::microseconds::period>(frameTime).count());
 
-				if constexpr (Config::RunRayPerPixelIncreasingDemo) {
-					if (this->iteration != 0) {
-						u32 index = (this->iteration - 1) / Config::RayPerPixelIncreasingDemoConfig::runsBeforeIncrease;
-						if (this->scene->getRaysPerPixel() > Config::RayPerPixelIncreasingDemoConfig::maxRaysPerPixel) {
-							break;
-						}
-						if (this->times.size() == index) {
-							this->times.push_back(std::vector<std::chrono::microseconds>{frameTime});
-						}
-						else {
-							this->times[index].push_back(frameTime);
-						}
-						if (this->iteration % Config::RayPerPixelIncreasingDemoConfig::runsBeforeIncrease == 0) {
-							this->scene->setRaysPerPixel(this->scene->getRaysPerPixel() + Config::RayPerPixelIncreasingDemoConfig::increaseAmount);
-						}
-					}
-				}
-
 				this->iteration++;
 			}
 			vkDeviceWaitIdle(this->device.device());
-
-			if constexpr (Config::RunRayPerPixelIncreasingDemo) {
-				std::ofstream out;
-				out.open("runtimes.csv", std::ios::out | std::ios::trunc);
-				for (auto i = 0; i < this->times.size(); i++) {
-					std::chrono::microseconds sum = this->times[i].at(0); // assumes at least 1
-					for (auto j = 1; j < Config::RayPerPixelIncreasingDemoConfig::runsBeforeIncrease; j++) {
-						sum += this->times[i][j];
-					}
-					out << (i + 1) << ", " << sum / Config::RayPerPixelIncreasingDemoConfig::runsBeforeIncrease << ",\n";
-				}
-				out.close();
+			this->reportProfiler();
+		}
+		auto renderHeadless(u32 frameCount, const std::string& outputPath) -> void {
+			auto currentTime = std::chrono::high_resolution_clock::now();
+			for (u32 i = 0; i < frameCount; i++) {
+				auto newTime = std::chrono::high_resolution_clock::now();
+				auto frameTime = std::chrono::duration_cast<std::chrono::microseconds>(newTime - currentTime);
+				currentTime = newTime;
+				doIteration(std::chrono::duration<float, std::chrono::microseconds::period>(frameTime).count());
+				this->iteration++;
 			}
+			vkDeviceWaitIdle(this->device.device());
+			this->reportProfiler();
+			this->saveComputeImage(outputPath);
+		}
+		auto renderFrame() -> FrameTimings { // single headless frame, used by the benchmark runner
+			auto timings = this->doIteration(0.0f);
+			this->iteration++;
+			return timings;
+		}
+		auto setDeterministicSeeding(bool enabled, u32 seed) -> void { // scene generation is seeded separately, see seedSceneRandom
+			this->deterministicSeeding = enabled;
+			this->userSeed = seed;
+		}
+		auto setMortonExtentBits(u32 bits) -> void { this->mortonExtentBits = bits; } // takes effect from the next bvh build
+		// of the last built bvh, the TLAS for TwoLevel. reads the node (and morton) buffers back, so not for timed frames
+		auto analyseBVH() -> CPU::BVHAnalysis;
+		auto readAverageImage() -> std::vector<f32> { // linear rgb, computeImage divided by rays per pixel
+			return Util::averageAccumulated(this->readComputeImage(), this->scene->getRaysPerPixel());
 		}
+		auto getScene() -> RaytraceScene& { return *this->scene; }
+		auto getImageExtent() const -> VkExtent2D { return this->imageExtent; }
+		auto getDeviceName() const -> std::string { return this->device.properties.deviceName; }
 		~Raytracer();
 	};
 
@@ -0,0 +1,77 @@
+#include "Regression.hpp"
+
+#include "Config.hpp"
+#include "Scenes.hpp"
+#include "RaytracerBVH.hpp"
+#include "utils/ImageCompare.hpp"
+#include "utils/ImageIO.hpp"
+
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+
+namespace Regression {
+	auto run() -> bool {
+		const std::string directory = Config::get().regressionDirectory;
+		const bool record = Config::get().regressionRecord;
+		if (record)
+			std::filesystem::create_directories(directory);
+
+		u32 failures = 0;
+		for (const auto& tolerance : Config::RegressionConfig::scenes) {
+			const std::string referencePath = directory + tolerance.scene + ".pfm";
+
+			seedSceneRandom(Config::RegressionConfig::seed);
+			RaytracerBVHRenderer::Raytracer raytracer{
+				Config::RegressionConfig::width, Config::RegressionConfig::height, findScene(tolerance.scene)
+			};
+			raytracer.setDeterministicSeeding(true, Config::RegressionConfig::seed);
+			raytracer.getScene().setRaysPerPixel(Config::RegressionConfig::raysPerPixel);
+			raytracer.getScene().setMaxRaytraceDepth(Config::RegressionConfig::maxRaytraceDepth);
+			for (u32 i = 0; i < Config::RegressionConfig::frames; i++)
+				raytracer.renderFrame();
+			const auto actual = raytracer.readAverageImage();
+
+			if (record) {
+				Util::writePFM(referencePath, Config::RegressionConfig::width, Config::RegressionConfig::height, actual);
+				std::cout << std::format("RECORDED {} -> {}\n", tolerance.scene, referencePath);
+				continue;
+			}
+			if (!std::filesystem::exists(referencePath)) {
+				std::cout << std::format("FAIL {}: no reference at {} (run with --regressionRecord)\n", tolerance.scene, referencePath);
+				failures++;
+				continue;
+			}
+
+			u32 referenceWidth, referenceHeight;
+			const auto reference = Util::readPFM(referencePath, referenceWidth, referenceHeight);
+			if (referenceWidth != Config::RegressionConfig::width || referenceHeight != Config::RegressionConfig::height) {
+				std::cout << std::format(
+					"FAIL {}: reference is {}x{}, rendered {}x{}\n", tolerance.scene,
+					referenceWidth, referenceHeight, Config::RegressionConfig::width, Config::RegressionConfig::height
+				);
+				failures++;
+				continue;
+			}
+
+			const auto difference = Util::compareImages(Config::RegressionConfig::width, Config::RegressionConfig::height, reference, actual);
+			const bool passed = difference.rmse <= tolerance.maxRMSE
+				&& difference.psnr >= tolerance.minPSNR
+				&& difference.ssim >= tolerance.minSSIM;
+			std::cout << std::format(
+				"{} {}: rmse {:.5f} (max {}), psnr {:.2f}dB (min {}), ssim {:.5f} (min {})\n",
+				passed ? "PASS" : "FAIL", tolerance.scene,
+				difference.rmse, tolerance.maxRMSE, difference.psnr, tolerance.minPSNR, difference.ssim, tolerance.minSSIM
+			);
+			if (!passed) {
+				const std::string actualPath = directory + tolerance.scene + ".actual.pfm";
+				Util::writePFM(actualPath, Config::RegressionConfig::width, Config::RegressionConfig::height, actual);
+				failures++;
+			}
+		}
+		if (failures > 0)
+			std::cout << std::format("{} of {} scenes failed\n", failures, Config::RegressionConfig::scenes.size());
+		return failures == 0;
+	}
+};
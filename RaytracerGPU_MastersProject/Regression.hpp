@@ -0,0 +1,13 @@
+#pragma once
+
+#include "utils/PrimitiveTypes.hpp"
+
+/*
+Image regression check for the BVH renderer. Every scene in Config::RegressionConfig is rendered headless
+with deterministic seeding, read back from computeImage and compared to <regressionDirectory>/<scene>.pfm
+with RMSE, PSNR and SSIM against that scene's tolerances.
+Run it before and after changing the traversal or bvh build shaders. --regressionRecord writes new references.
+*/
+namespace Regression {
+	auto run() -> bool; // true when every scene is within tolerance (or references were recorded)
+};
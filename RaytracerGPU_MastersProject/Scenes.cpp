@@ -5,6 +5,7 @@
 #include "VulkanWrapper/GameObject.hpp"
 
 #include <random>
+#include <stdexcept>
 
 std::random_device rd;
 std::uniform_real_distribution<double> dist(0, 1.0);
@@ -393,6 +394,30 @@ auto complexScene(std::unique_ptr<RaytraceScene>& scene) -> void {
 
 	scene->setRaysPerPixel(8);
 	scene->setMaxRaytraceDepth(8);
+	scene->setBVHBuilder(SceneTypes::BVHBuilder::PLOC); // the monkey's uneven triangles are where LBVH's splits hurt most
 	scene->getCamera().setVerticalFOV(40.0f);
 	scene->prepForRender();
 }
+
+auto seedSceneRandom(u32 seed) -> void {
+	gen.seed(seed);
+}
+
+auto getScenes() -> const std::vector<NamedScene>& {
+	static const std::vector<NamedScene> scenes = {
+		{ "randomSpheres", randomSpheres },
+		{ "cornellMixedScene", cornellMixedScene },
+		{ "cornellBoxScene", cornellBoxScene },
+		{ "simpleScene", simpleScene },
+		{ "complexScene", complexScene }
+	};
+	return scenes;
+}
+
+auto findScene(const std::string& name) -> SceneFunction {
+	for (const auto& scene : getScenes()) {
+		if (name == scene.name)
+			return scene.create;
+	}
+	throw std::runtime_error("no scene named " + name);
+}
@@ -5,6 +5,8 @@
 #include "VulkanWrapper/RaytraceScene.hpp"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 auto randomSpheres(std::unique_ptr<RaytraceScene>& scene) -> void;
 
@@ -15,3 +17,14 @@ auto cornellBoxScene(std::unique_ptr<RaytraceScene>& scene) -> void;
 auto simpleScene(std::unique_ptr<RaytraceScene>& scene) -> void;
 
 auto complexScene(std::unique_ptr<RaytraceScene>& scene) -> void;
+
+using SceneFunction = auto (*)(std::unique_ptr<RaytraceScene>&) -> void;
+struct NamedScene {
+	const char* name;
+	SceneFunction create;
+};
+
+auto seedSceneRandom(u32 seed) -> void; // scenes placing objects randomly (randomSpheres, ...) draw from this generator
+
+auto getScenes() -> const std::vector<NamedScene>&; // every scene above, by function name
+auto findScene(const std::string& name) -> SceneFunction; // throws if there is no scene with that name
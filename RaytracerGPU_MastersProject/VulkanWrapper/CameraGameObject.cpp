@@ -44,3 +44,9 @@ auto CameraGameObject::updateCameraForFrame(Window& window, float dt, f32 aspect
 
     this->camera.setPerspectiveProjection(glm::radians(this->fovy), aspectRatio, this->nearDist, this->farDist);
 }
+
+auto CameraGameObject::updateCameraForFrame(f32 aspectRatio) -> void {
+    this->camera.setViewYXZ(this->transform.translation, this->transform.rotation);
+
+    this->camera.setPerspectiveProjection(glm::radians(this->fovy), aspectRatio, this->nearDist, this->farDist);
+}
@@ -34,4 +34,5 @@ public:
 	auto setVerticalFOV(f32 fovy) -> void;
 
 	auto updateCameraForFrame(Window& window, f32 dt, f32 aspectRatio) -> void;
+	auto updateCameraForFrame(f32 aspectRatio) -> void; // no input handling, for headless rendering
 };
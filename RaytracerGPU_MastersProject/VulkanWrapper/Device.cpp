@@ -4,6 +4,7 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <set>
@@ -49,7 +50,8 @@ void DestroyDebugUtilsMessengerEXT(
 }
 
 // class member functions
-Device::Device(Window& window) : window{ window } {
+Device::Device(Window& window) : window{ &window } {
+    this->deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
     this->createInstance();               // create vulkan instance (API connection)
     this->setupDebugMessenger();          // setup error checking, cause vulkan won't do much. disable for release build
     this->createSurface();                // connect vulkan and glfw
@@ -58,6 +60,14 @@ Device::Device(Window& window) : window{ window } {
     this->createCommandPools();
 }
 
+Device::Device() : window{ nullptr } {
+    this->createInstance();               // no glfw instance extensions needed
+    this->setupDebugMessenger();
+    this->pickPhysicalDevice();           // only needs a compute queue, no surface or swapchain support
+    this->createLogicalDevice();
+    this->createCommandPools();
+}
+
 Device::~Device() {
     vkDestroyCommandPool(this->device_, this->graphicsCommandPool, nullptr);
     if (!this->graphicsAndComputeSameQueueFamily)
@@ -69,7 +79,8 @@ Device::~Device() {
         DestroyDebugUtilsMessengerEXT(this->instance, this->debugMessenger, nullptr);
     }
 
-    vkDestroySurfaceKHR(this->instance, this->surface_, nullptr);
+    if (!this->isHeadless())
+        vkDestroySurfaceKHR(this->instance, this->surface_, nullptr);
     vkDestroyInstance(this->instance, nullptr);
 }
 
@@ -84,7 +95,7 @@ void Device::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = VK_API_VERSION_1_1; // subgroup operations in compute (GetEnclosingAABB, RadixSortSimple, raytraceBVH stats)
 
     VkInstanceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -141,31 +152,59 @@ void Device::createLogicalDevice() {
     this->queueFamilyCache = this->findQueueFamilies(this->physicalDevice);
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = { this->queueFamilyCache.graphicsFamily, this->queueFamilyCache.computeFamily, this->queueFamilyCache.presentFamily };
+    std::set<uint32_t> uniqueQueueFamilies = { this->queueFamilyCache.computeFamily };
+    if (!this->isHeadless()) {
+        uniqueQueueFamilies.insert(this->queueFamilyCache.graphicsFamily);
+        uniqueQueueFamilies.insert(this->queueFamilyCache.presentFamily);
+    }
     // graphics family and compute family can be the same depending on device support. In this case, a duplicate will be removed here and not cause any issues
 
-    float queuePriority = 1.0f;
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(this->physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(this->physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    // the compute family gets a second queue where it has one, so a bvh build can run alongside the trace (asyncBVHBuild)
+    const uint32_t computeQueueCount = std::min(queueFamilies[this->queueFamilyCache.computeFamily].queueCount, 2u);
+    float queuePriorities[] = { 1.0f, 1.0f };
     for (uint32_t queueFamily : uniqueQueueFamilies) {
         VkDeviceQueueCreateInfo queueCreateInfo = {};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = queueFamily;
-        queueCreateInfo.queueCount = 1;
-        queueCreateInfo.pQueuePriorities = &queuePriority;
+        queueCreateInfo.queueCount = queueFamily == this->queueFamilyCache.computeFamily ? computeQueueCount : 1;
+        queueCreateInfo.pQueuePriorities = queuePriorities;
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
     VkPhysicalDeviceFeatures deviceFeatures = {};
-    deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.samplerAnisotropy = this->isHeadless() ? VK_FALSE : VK_TRUE; // only the fragment shader samples
+
+    // optional. enabled whenever available so the heatmap shader can time itself with clock2x32ARB
+    std::vector<const char*> enabledExtensions = this->deviceExtensions;
+    VkPhysicalDeviceShaderClockFeaturesKHR shaderClockFeatures = {};
+    shaderClockFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_CLOCK_FEATURES_KHR;
+    if (this->hasDeviceExtension(this->physicalDevice, VK_KHR_SHADER_CLOCK_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 supportedFeatures = {};
+        supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedFeatures.pNext = &shaderClockFeatures;
+        vkGetPhysicalDeviceFeatures2(this->physicalDevice, &supportedFeatures);
+        this->shaderClockSupported_ = shaderClockFeatures.shaderSubgroupClock == VK_TRUE;
+        if (this->shaderClockSupported_) {
+            enabledExtensions.push_back(VK_KHR_SHADER_CLOCK_EXTENSION_NAME);
+            shaderClockFeatures.shaderDeviceClock = VK_FALSE; // only the subgroup clock is used
+        }
+    }
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = this->shaderClockSupported_ ? &shaderClockFeatures : nullptr;
 
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(this->deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = this->deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     // might not really be necessary anymore because device specific validation layers
     // have been deprecated
@@ -182,6 +221,18 @@ void Device::createLogicalDevice() {
     }
 
     vkGetDeviceQueue(this->device_, this->queueFamilyCache.computeFamily, 0, &this->computeQueue_);
+    this->asyncComputeQueue_ = this->computeQueue_;
+    if (computeQueueCount > 1)
+        vkGetDeviceQueue(this->device_, this->queueFamilyCache.computeFamily, 1, &this->asyncComputeQueue_);
+
+    this->computeTimestampValidBits_ = queueFamilies[this->queueFamilyCache.computeFamily].timestampValidBits;
+
+    if (this->isHeadless()) {
+        // transfers that would go to the graphics queue (scene uploads, debug reads) go to the compute queue instead
+        this->graphicsQueue_ = this->computeQueue_;
+        this->presentQueue_ = VK_NULL_HANDLE;
+        return;
+    }
     vkGetDeviceQueue(this->device_, this->queueFamilyCache.graphicsFamily, 0, &this->graphicsQueue_);
     vkGetDeviceQueue(this->device_, this->queueFamilyCache.presentFamily, 0, &this->presentQueue_);
 }
@@ -210,11 +261,15 @@ void Device::createCommandPools() {
     }
 }
 
-void Device::createSurface() { this->window.createWindowSurface(this->instance, &this->surface_); }
+void Device::createSurface() { this->window->createWindowSurface(this->instance, &this->surface_); }
 
 bool Device::isDeviceSuitable(VkPhysicalDevice device) {
     QueueFamilyIndices indices = this->findQueueFamilies(device);
 
+    if (this->isHeadless()) {
+        return indices.isCompleteHeadless(); // no surface to present to, so no swapchain requirements
+    }
+
     bool extensionsSupported = this->checkDeviceExtensionSupport(device);
 
     bool swapChainAdequate = false;
@@ -278,11 +333,14 @@ bool Device::checkValidationLayerSupport() {
 }
 
 std::vector<const char*> Device::getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char*> extensions;
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    if (!this->isHeadless()) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (this->enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -314,6 +372,24 @@ void Device::hasGflwRequiredInstanceExtensions() {
     }
 }
 
+bool Device::hasDeviceExtension(VkPhysicalDevice device, const char* extensionName) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(
+        device,
+        nullptr,
+        &extensionCount,
+        availableExtensions.data());
+
+    for (const auto& extension : availableExtensions) {
+        if (std::string(extension.extensionName) == extensionName)
+            return true;
+    }
+    return false;
+}
+
 bool Device::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     uint32_t extensionCount;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -349,6 +425,17 @@ QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device) {
             indices.computeFamily = i;
             indices.computeFamilyHasValue = true;
         }
+        if (this->isHeadless()) {
+            if (indices.isCompleteHeadless()) {
+                // graphics command pool is created on this family too, so getGraphicsCommandPool() is still valid
+                indices.graphicsFamily = indices.computeFamily;
+                indices.graphicsFamilyHasValue = true;
+                this->graphicsAndComputeSameQueueFamily = true;
+                break;
+            }
+            i++;
+            continue;
+        }
         if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
             indices.graphicsFamily = i;
             indices.graphicsFamilyHasValue = true;
@@ -531,6 +618,34 @@ void Device::copyBufferToImage(
     this->endSingleTimeCommands(queue, pool, commandBuffer);
 }
 
+void Device::copyImageToBuffer(
+    VkQueue queue, VkCommandPool pool,
+    VkImage image, VkBuffer buffer, uint32_t width, uint32_t height, uint32_t layerCount) {
+    VkCommandBuffer commandBuffer = this->beginSingleTimeCommands(pool);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = layerCount;
+
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { width, height, 1 };
+
+    vkCmdCopyImageToBuffer(
+        commandBuffer,
+        image,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        buffer,
+        1,
+        &region);
+    this->endSingleTimeCommands(queue, pool, commandBuffer);
+}
+
 void Device::createImageWithInfo(
     const VkImageCreateInfo& imageInfo,
     VkMemoryPropertyFlags properties,
@@ -22,26 +22,30 @@ struct QueueFamilyIndices {
     bool graphicsFamilyHasValue = false;
     bool presentFamilyHasValue = false;
     bool isComplete() { return computeFamilyHasValue && graphicsFamilyHasValue && presentFamilyHasValue; }
+    bool isCompleteHeadless() { return computeFamilyHasValue; }
 };
 
 class Device {
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-    Window& window;
+    Window* window; // nullptr when running headless (no surface, no present queue, no swapchain)
     VkCommandPool graphicsCommandPool;
     VkCommandPool computeCommandPool;
-    bool graphicsAndComputeSameQueueFamily;
+    bool graphicsAndComputeSameQueueFamily = false;
 
     VkDevice device_;
-    VkSurfaceKHR surface_;
+    VkSurfaceKHR surface_ = VK_NULL_HANDLE;
     QueueFamilyIndices queueFamilyCache;
     VkQueue computeQueue_;
+    VkQueue asyncComputeQueue_; // second queue of the compute family, or computeQueue_ if the family only has one
     VkQueue graphicsQueue_;
     VkQueue presentQueue_;
+    uint32_t computeTimestampValidBits_ = 0;
+    bool shaderClockSupported_ = false;
 
     const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
-    const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+    std::vector<const char*> deviceExtensions;
 
     void createInstance();
     void setupDebugMessenger();
@@ -58,6 +62,7 @@ class Device {
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
     void hasGflwRequiredInstanceExtensions();
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool hasDeviceExtension(VkPhysicalDevice device, const char* extensionName);
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
 public:
@@ -68,6 +73,7 @@ public:
 #endif
 
     Device(Window& window);
+    Device(); // headless. only a compute queue is created and graphicsQueue()/getGraphicsCommandPool() alias it
     ~Device();
 
     // Not copyable or movable
@@ -81,8 +87,13 @@ public:
     VkDevice device() { return this->device_; }
     VkSurfaceKHR surface() { return this->surface_; }
     VkQueue computeQueue() { return this->computeQueue_; }
+    VkQueue asyncComputeQueue() { return this->asyncComputeQueue_; } // same family as computeQueue(), so shares its command pool
+    bool hasAsyncComputeQueue() { return this->asyncComputeQueue_ != this->computeQueue_; }
     VkQueue graphicsQueue() { return this->graphicsQueue_; }
     VkQueue presentQueue() { return this->presentQueue_; }
+    bool isHeadless() { return this->window == nullptr; }
+    uint32_t computeTimestampValidBits() { return this->computeTimestampValidBits_; } // 0 if the compute queue can't write timestamps
+    bool shaderClockSupported() { return this->shaderClockSupported_; } // VK_KHR_shader_clock with shaderSubgroupClock, enabled when true
 
     SwapChainSupportDetails getSwapChainSupport() { return this->querySwapChainSupport(physicalDevice); }
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -102,6 +113,8 @@ public:
     void copyBuffer(VkQueue queue, VkCommandPool pool, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
     void copyBufferToImage(
         VkQueue queue, VkCommandPool pool, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
+    void copyImageToBuffer(
+        VkQueue queue, VkCommandPool pool, VkImage image, VkBuffer buffer, uint32_t width, uint32_t height, uint32_t layerCount);
 
     void createImageWithInfo(
         const VkImageCreateInfo& imageInfo,
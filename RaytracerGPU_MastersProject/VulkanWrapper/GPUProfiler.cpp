@@ -0,0 +1,145 @@
+#include "GPUProfiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <stdexcept>
+
+GPUProfiler::GPUProfiler(Device& device, std::vector<std::string> passNames, u32 frameSlots, u32 historyLength) :
+	device{ device },
+	passNames{ std::move(passNames) },
+	frameSlots{ frameSlots },
+	currentSlot{ 0 },
+	slotPending(frameSlots, false),
+	slotPassWritten(frameSlots, std::vector<bool>(this->passNames.size(), false)),
+	historyLength{ historyLength },
+	history(this->passNames.size(), std::vector<f64>(historyLength, 0.0)),
+	historyNext(this->passNames.size(), 0),
+	historyCount(this->passNames.size(), 0),
+	lastSample(this->passNames.size(), 0.0)
+{
+	const u32 validBits = device.computeTimestampValidBits();
+	this->supported = validBits > 0 && device.properties.limits.timestampPeriod > 0.0f;
+	this->nanosecondsPerTick = device.properties.limits.timestampPeriod;
+	this->timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+	if (!this->supported)
+		return;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = this->frameSlots * static_cast<u32>(this->passNames.size()) * 2;
+	if (vkCreateQueryPool(this->device.device(), &poolInfo, nullptr, &this->queryPool) != VK_SUCCESS)
+		throw std::runtime_error("failed to create timestamp query pool!");
+}
+
+GPUProfiler::~GPUProfiler() {
+	if (this->queryPool != VK_NULL_HANDLE)
+		vkDestroyQueryPool(this->device.device(), this->queryPool, nullptr);
+}
+
+auto GPUProfiler::collect() -> void {
+	if (!this->supported)
+		return;
+	for (u32 slot = 0; slot < this->frameSlots; slot++) {
+		if (this->slotPending[slot] && this->collectSlot(slot))
+			this->slotPending[slot] = false;
+	}
+}
+
+auto GPUProfiler::collectSlot(u32 slot) -> bool {
+	const u32 passCount = this->getPassCount();
+	std::vector<u64> results(passCount * 2 * 2); // (timestamp, availability) per query
+	vkGetQueryPoolResults(
+		this->device.device(),
+		this->queryPool,
+		this->firstQuery(slot, 0),
+		passCount * 2,
+		sizeof(u64) * results.size(),
+		results.data(),
+		sizeof(u64) * 2,
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT // no wait bit, VK_NOT_READY is fine
+	);
+	for (u32 pass = 0; pass < passCount; pass++) {
+		if (!this->slotPassWritten[slot][pass])
+			continue;
+		if (results[pass * 4 + 1] == 0 || results[pass * 4 + 3] == 0)
+			return false; // not done on the gpu yet, try again next frame
+	}
+	for (u32 pass = 0; pass < passCount; pass++) {
+		if (!this->slotPassWritten[slot][pass])
+			continue;
+		const u64 ticks = (results[pass * 4 + 2] - results[pass * 4]) & this->timestampMask;
+		this->addSample(pass, static_cast<f64>(ticks) * this->nanosecondsPerTick / 1000000.0);
+	}
+	return true;
+}
+
+auto GPUProfiler::addSample(u32 pass, f64 ms) -> void {
+	this->history[pass][this->historyNext[pass]] = ms;
+	this->historyNext[pass] = (this->historyNext[pass] + 1) % this->historyLength;
+	this->historyCount[pass] = std::min(this->historyCount[pass] + 1, this->historyLength);
+	this->lastSample[pass] = ms;
+}
+
+auto GPUProfiler::beginFrame(VkCommandBuffer commandBuffer) -> void {
+	if (!this->supported)
+		return;
+	// if this slot still hasn't been collected the gpu is more than frameSlots behind. drop it rather than wait
+	this->slotPending[this->currentSlot] = false;
+	std::fill(this->slotPassWritten[this->currentSlot].begin(), this->slotPassWritten[this->currentSlot].end(), false);
+	vkCmdResetQueryPool(commandBuffer, this->queryPool, this->firstQuery(this->currentSlot, 0), this->getPassCount() * 2);
+}
+
+auto GPUProfiler::beginPass(VkCommandBuffer commandBuffer, u32 pass) -> void {
+	if (!this->supported)
+		return;
+	// written once every previous command finished its compute work, so barrier waits count towards the pass
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, this->queryPool, this->firstQuery(this->currentSlot, pass));
+}
+
+auto GPUProfiler::endPass(VkCommandBuffer commandBuffer, u32 pass) -> void {
+	if (!this->supported)
+		return;
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, this->queryPool, this->firstQuery(this->currentSlot, pass) + 1);
+	this->slotPassWritten[this->currentSlot][pass] = true;
+}
+
+auto GPUProfiler::endFrame() -> void {
+	if (!this->supported)
+		return;
+	this->slotPending[this->currentSlot] = true;
+	this->currentSlot = (this->currentSlot + 1) % this->frameSlots;
+}
+
+auto GPUProfiler::getStatistics(u32 pass) const -> PassStatistics {
+	PassStatistics stats{ this->lastSample[pass], 0.0, 0.0, 0.0, this->historyCount[pass] };
+	if (stats.sampleCount == 0)
+		return stats;
+	std::vector<f64> sorted(this->history[pass].begin(), this->history[pass].begin() + stats.sampleCount);
+	std::sort(sorted.begin(), sorted.end());
+	f64 sum = 0.0;
+	for (const auto ms : sorted)
+		sum += ms;
+	stats.minMs = sorted.front();
+	stats.avgMs = sum / stats.sampleCount;
+	const u32 p99Index = static_cast<u32>(std::ceil(0.99 * stats.sampleCount)) - 1;
+	stats.p99Ms = sorted[p99Index];
+	return stats;
+}
+
+auto GPUProfiler::report() const -> std::string {
+	if (!this->supported)
+		return "GPU PASS TIMINGS: timestamps not supported on the compute queue\n";
+	std::string out = std::format("GPU PASS TIMINGS (ms, last {} frames):\n", this->historyLength);
+	for (u32 pass = 0; pass < this->getPassCount(); pass++) {
+		const auto stats = this->getStatistics(pass);
+		if (stats.sampleCount == 0)
+			continue;
+		out += std::format(
+			"\t{:<32} last: {:9.4f} min: {:9.4f} avg: {:9.4f} p99: {:9.4f}\n",
+			this->passNames[pass], stats.lastMs, stats.minMs, stats.avgMs, stats.p99Ms
+		);
+	}
+	return out;
+}
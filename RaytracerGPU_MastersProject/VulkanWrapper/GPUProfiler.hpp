@@ -0,0 +1,72 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "../utils/PrimitiveTypes.hpp"
+
+#include "Device.hpp"
+
+#include <string>
+#include <vector>
+
+/*
+Timestamp query profiler for compute passes.
+Each frame gets its own slot of 2 queries per pass in one query pool. Results are collected
+with vkGetQueryPoolResults without the wait bit, so a slot whose results aren't available yet
+is simply left for a later collect() instead of stalling the cpu.
+Usage per frame:
+	collect() -> beginFrame(first command buffer) -> beginPass/endPass around dispatches
+	(may span several command buffers, as long as they're submitted after the first) -> endFrame()
+*/
+class GPUProfiler {
+public:
+	struct PassStatistics {
+		f64 lastMs;
+		f64 minMs;
+		f64 avgMs;
+		f64 p99Ms;
+		u32 sampleCount;
+	};
+private:
+	Device& device;
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+	bool supported;
+	f64 nanosecondsPerTick;
+	u64 timestampMask;
+
+	std::vector<std::string> passNames;
+	u32 frameSlots;
+	u32 currentSlot;
+	std::vector<bool> slotPending; // submitted, results not yet collected
+	std::vector<std::vector<bool>> slotPassWritten; // passes that were actually recorded into that slot
+
+	u32 historyLength;
+	std::vector<std::vector<f64>> history; // per pass ring buffer of durations in ms
+	std::vector<u32> historyNext;
+	std::vector<u32> historyCount;
+	std::vector<f64> lastSample;
+
+	auto firstQuery(u32 slot, u32 pass) const -> u32 { return (slot * static_cast<u32>(this->passNames.size()) + pass) * 2; }
+	auto collectSlot(u32 slot) -> bool;
+	auto addSample(u32 pass, f64 ms) -> void;
+public:
+	GPUProfiler(Device& device, std::vector<std::string> passNames, u32 frameSlots = 3, u32 historyLength = 256);
+	~GPUProfiler();
+
+	GPUProfiler(const GPUProfiler&) = delete;
+	GPUProfiler& operator=(const GPUProfiler&) = delete;
+
+	auto isSupported() const -> bool { return this->supported; }
+	auto getPassCount() const -> u32 { return static_cast<u32>(this->passNames.size()); }
+	auto getPassName(u32 pass) const -> const std::string& { return this->passNames[pass]; }
+
+	auto collect() -> void; // non-blocking, gathers every finished slot
+	auto beginFrame(VkCommandBuffer commandBuffer) -> void; // records the reset of the current slot
+	auto beginPass(VkCommandBuffer commandBuffer, u32 pass) -> void;
+	auto endPass(VkCommandBuffer commandBuffer, u32 pass) -> void;
+	auto endFrame() -> void; // call once the frame's command buffers are submitted
+
+	auto getStatistics(u32 pass) const -> PassStatistics;
+	auto report() const -> std::string;
+};
@@ -0,0 +1,132 @@
+#include "LeafCollapse.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	constexpr const u32 STORAGE_BINDINGS = 4;
+	constexpr const VkDeviceSize COLLAPSE_INFO_SIZE = sizeof(u32) * 4; // HLBVHLeafCollapseInfo
+}
+
+LeafCollapse::LeafCollapse(
+	Device& device, Buffer& uniformBuffer, Buffer& nodes, Buffer& constructionInfo,
+	Buffer& primitiveReferences, u32 maxPrimitiveCount
+) :
+	device{ device },
+	maxPrimitiveCount{ maxPrimitiveCount }
+{
+	auto layoutBuilder = DescriptorSetLayout::Builder(this->device);
+	layoutBuilder.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+	for (u32 binding = 1; binding <= STORAGE_BINDINGS; binding++)
+		layoutBuilder.addBinding(binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+	this->descriptorSetLayout = layoutBuilder.build();
+	this->descriptorPool = DescriptorPool::Builder(this->device)
+		.setMaxSets(1)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, STORAGE_BINDINGS)
+		.build();
+
+	const u32 elements = std::max(maxPrimitiveCount, 1u);
+	this->collapseInfoBuffer = std::make_unique<Buffer>(
+		this->device,
+		COLLAPSE_INFO_SIZE,
+		2 * elements - 1,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+
+	auto uniformInfo = uniformBuffer.descriptorInfo();
+	auto nodeInfo = nodes.descriptorInfo();
+	auto constructionInfoInfo = constructionInfo.descriptorInfo();
+	auto collapseInfoInfo = this->collapseInfoBuffer->descriptorInfo();
+	auto primitiveReferenceInfo = primitiveReferences.descriptorInfo();
+	DescriptorWriter(*this->descriptorSetLayout, *this->descriptorPool)
+		.writeBuffer(0, &uniformInfo)
+		.writeBuffer(1, &nodeInfo)
+		.writeBuffer(2, &constructionInfoInfo)
+		.writeBuffer(3, &collapseInfoInfo)
+		.writeBuffer(4, &primitiveReferenceInfo)
+		.build(this->descriptorSet);
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstants);
+
+	VkDescriptorSetLayout setLayout = this->descriptorSetLayout->getDescriptorSetLayout();
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(this->device.device(), &pipelineLayoutInfo, nullptr, &this->pipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create leaf collapse pipeline layout!");
+
+	auto createPipeline = [this](const char* path) {
+		ComputePipelineConfigInfo pipelineConfig{};
+		ComputePipeline::defaultPipelineConfigInfo(pipelineConfig);
+		pipelineConfig.pipelineLayout = this->pipelineLayout;
+		return std::make_unique<ComputePipeline>(this->device, path, pipelineConfig);
+	};
+	this->costsPipeline = createPipeline("shaders/compiled/LeafCollapseCosts.comp.spv");
+	this->rangesPipeline = createPipeline("shaders/compiled/LeafCollapseRanges.comp.spv");
+	this->applyPipeline = createPipeline("shaders/compiled/LeafCollapseApply.comp.spv");
+}
+
+LeafCollapse::~LeafCollapse() {
+	this->costsPipeline = nullptr;
+	this->rangesPipeline = nullptr;
+	this->applyPipeline = nullptr;
+	vkDestroyPipelineLayout(this->device.device(), this->pipelineLayout, nullptr);
+}
+
+auto LeafCollapse::computeBarrier(VkCommandBuffer commandBuffer) -> void {
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr
+	);
+}
+
+auto LeafCollapse::record(VkCommandBuffer commandBuffer, u32 primitiveCount, u32 maxLeafPrimitives, bool sahDecision) -> void {
+	if (primitiveCount > this->maxPrimitiveCount)
+		throw std::runtime_error("leaf collapse was created for fewer primitives than it was asked to collapse!");
+	if (maxLeafPrimitives < 2 || maxLeafPrimitives > MAX_LEAF_PRIMITIVES)
+		throw std::runtime_error("leaf collapse max leaf primitives must be 2 to 16!");
+	if (primitiveCount == 0)
+		return;
+
+	vkCmdBindDescriptorSets(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_COMPUTE,
+		this->pipelineLayout,
+		0,
+		1,
+		&this->descriptorSet,
+		0,
+		nullptr
+	);
+	PushConstants pushConstants{ maxLeafPrimitives, sahDecision ? 1u : 0u };
+	vkCmdPushConstants(commandBuffer, this->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &pushConstants);
+
+	this->costsPipeline->bind(commandBuffer);
+	vkCmdDispatch(commandBuffer, workgroupCount(primitiveCount), 1, 1);
+	this->computeBarrier(commandBuffer);
+
+	this->rangesPipeline->bind(commandBuffer);
+	vkCmdDispatch(commandBuffer, workgroupCount(primitiveCount), 1, 1);
+	this->computeBarrier(commandBuffer);
+
+	this->applyPipeline->bind(commandBuffer);
+	vkCmdDispatch(commandBuffer, workgroupCount(primitiveCount), 1, 1);
+}
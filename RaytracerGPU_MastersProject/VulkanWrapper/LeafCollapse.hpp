@@ -0,0 +1,64 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "../utils/PrimitiveTypes.hpp"
+
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "ComputePipeline.hpp"
+#include "Descriptors.hpp"
+
+#include <memory>
+
+/*
+Collapses small subtrees of a built HLBVH into multi-primitive leaves, after the build (and OptimizeTreelets).
+LeafCollapseCosts climbs bottom up like OptimizeTreelets, deciding for every subtree of at most maxLeafPrimitives
+primitives whether it becomes one leaf, by sah cost or always. LeafCollapseRanges writes every primitive into the
+primitive reference buffer in depth first order, so each collapsed subtree's primitives are one contiguous range,
+and LeafCollapseApply rewrites the topmost collapsed nodes as leaves over their range (LEAF_RANGE_BIT in
+primitiveType, primitiveIndex the range start). The nodes below are left in place but unreachable.
+Needs the construction info parents and even visitation counts every builder leaves behind.
+The constants mirror shaders/include/leafCollapse.glsl.
+*/
+class LeafCollapse {
+public:
+	static constexpr const u32 WORKGROUP_SIZE = 256;
+	static constexpr const u32 MAX_LEAF_PRIMITIVES = 16;
+
+	struct PushConstants { // LeafCollapsePushConstants in leafCollapse.glsl
+		u32 maxLeafPrimitives;
+		u32 sahDecision;
+	};
+private:
+	Device& device;
+	u32 maxPrimitiveCount;
+
+	std::unique_ptr<DescriptorSetLayout> descriptorSetLayout;
+	std::unique_ptr<DescriptorPool> descriptorPool;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	std::unique_ptr<ComputePipeline> costsPipeline;
+	std::unique_ptr<ComputePipeline> rangesPipeline;
+	std::unique_ptr<ComputePipeline> applyPipeline;
+	std::unique_ptr<Buffer> collapseInfoBuffer; // HLBVHLeafCollapseInfo per node
+
+	auto computeBarrier(VkCommandBuffer commandBuffer) -> void;
+public:
+	// nodes and constructionInfo hold 2 * maxPrimitiveCount - 1 entries, primitiveReferences maxPrimitiveCount
+	LeafCollapse(
+		Device& device, Buffer& uniformBuffer, Buffer& nodes, Buffer& constructionInfo,
+		Buffer& primitiveReferences, u32 maxPrimitiveCount
+	);
+	~LeafCollapse();
+
+	LeafCollapse(const LeafCollapse&) = delete;
+	LeafCollapse& operator=(const LeafCollapse&) = delete;
+
+	// the built tree must be written before (barrier included by the caller). primitiveCount <= maxPrimitiveCount
+	// and must match the uniform buffer's numTriangles + numSpheres. maxLeafPrimitives 2 to MAX_LEAF_PRIMITIVES
+	auto record(VkCommandBuffer commandBuffer, u32 primitiveCount, u32 maxLeafPrimitives, bool sahDecision) -> void;
+
+	static auto workgroupCount(u32 elementCount) -> u32 { return (elementCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE; }
+};
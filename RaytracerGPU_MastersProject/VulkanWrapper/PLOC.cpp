@@ -0,0 +1,192 @@
+#include "PLOC.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	constexpr const u32 STORAGE_BINDINGS = 9;
+	constexpr const VkDeviceSize DISPATCH_ARGS_STRIDE = sizeof(u32) * 4; // uvec4 dispatchArgs[2]
+	constexpr const VkDeviceSize STATE_SIZE = DISPATCH_ARGS_STRIDE * 2 + sizeof(u32) * 3;
+}
+
+PLOC::PLOC(
+	Device& device, Buffer& uniformBuffer, Buffer& triangles, Buffer& spheres,
+	Buffer& mortonPrimitives, Buffer& nodes, Buffer& constructionInfo, u32 maxPrimitiveCount
+) :
+	device{ device },
+	maxPrimitiveCount{ maxPrimitiveCount }
+{
+	auto layoutBuilder = DescriptorSetLayout::Builder(this->device);
+	layoutBuilder.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+	for (u32 binding = 1; binding <= STORAGE_BINDINGS; binding++)
+		layoutBuilder.addBinding(binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+	this->descriptorSetLayout = layoutBuilder.build();
+	this->descriptorPool = DescriptorPool::Builder(this->device)
+		.setMaxSets(1)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, STORAGE_BINDINGS)
+		.build();
+
+	const u32 elements = std::max(maxPrimitiveCount, 1u);
+	this->clusterBuffer = std::make_unique<Buffer>(
+		this->device,
+		sizeof(u32),
+		2 * elements,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+	this->nearestNeighbourBuffer = std::make_unique<Buffer>(
+		this->device,
+		sizeof(u32),
+		elements,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+	this->workgroupCountBuffer = std::make_unique<Buffer>(
+		this->device,
+		sizeof(u32),
+		workgroupCount(elements),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+	this->stateBuffer = std::make_unique<Buffer>(
+		this->device,
+		STATE_SIZE,
+		1,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+
+	auto uniformInfo = uniformBuffer.descriptorInfo();
+	auto triangleInfo = triangles.descriptorInfo();
+	auto sphereInfo = spheres.descriptorInfo();
+	auto mortonInfo = mortonPrimitives.descriptorInfo();
+	auto nodeInfo = nodes.descriptorInfo();
+	auto constructionInfoInfo = constructionInfo.descriptorInfo();
+	auto clusterInfo = this->clusterBuffer->descriptorInfo();
+	auto nearestNeighbourInfo = this->nearestNeighbourBuffer->descriptorInfo();
+	auto workgroupCountInfo = this->workgroupCountBuffer->descriptorInfo();
+	auto stateInfo = this->stateBuffer->descriptorInfo();
+	DescriptorWriter(*this->descriptorSetLayout, *this->descriptorPool)
+		.writeBuffer(0, &uniformInfo)
+		.writeBuffer(1, &triangleInfo)
+		.writeBuffer(2, &sphereInfo)
+		.writeBuffer(3, &mortonInfo)
+		.writeBuffer(4, &nodeInfo)
+		.writeBuffer(5, &constructionInfoInfo)
+		.writeBuffer(6, &clusterInfo)
+		.writeBuffer(7, &nearestNeighbourInfo)
+		.writeBuffer(8, &workgroupCountInfo)
+		.writeBuffer(9, &stateInfo)
+		.build(this->descriptorSet);
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstants);
+
+	VkDescriptorSetLayout setLayout = this->descriptorSetLayout->getDescriptorSetLayout();
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(this->device.device(), &pipelineLayoutInfo, nullptr, &this->pipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create ploc pipeline layout!");
+
+	auto createPipeline = [this](const char* path) {
+		ComputePipelineConfigInfo pipelineConfig{};
+		ComputePipeline::defaultPipelineConfigInfo(pipelineConfig);
+		pipelineConfig.pipelineLayout = this->pipelineLayout;
+		return std::make_unique<ComputePipeline>(this->device, path, pipelineConfig);
+	};
+	this->initPipeline = createPipeline("shaders/compiled/PLOCInit.comp.spv");
+	this->nearestNeighboursPipeline = createPipeline("shaders/compiled/PLOCFindNearestNeighbours.comp.spv");
+	this->countPipeline = createPipeline("shaders/compiled/PLOCCountClusters.comp.spv");
+	this->scanPipeline = createPipeline("shaders/compiled/PLOCScanClusters.comp.spv");
+	this->mergePipeline = createPipeline("shaders/compiled/PLOCMerge.comp.spv");
+	this->finishPipeline = createPipeline("shaders/compiled/PLOCFinish.comp.spv");
+}
+
+PLOC::~PLOC() {
+	this->initPipeline = nullptr;
+	this->nearestNeighboursPipeline = nullptr;
+	this->countPipeline = nullptr;
+	this->scanPipeline = nullptr;
+	this->mergePipeline = nullptr;
+	this->finishPipeline = nullptr;
+	vkDestroyPipelineLayout(this->device.device(), this->pipelineLayout, nullptr);
+}
+
+auto PLOC::computeBarrier(VkCommandBuffer commandBuffer) -> void {
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, // dispatch arguments come from the state buffer
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr
+	);
+}
+
+auto PLOC::pushConstants(VkCommandBuffer commandBuffer, u32 iteration, u32 searchRadius) -> void {
+	PushConstants pushConstants{ iteration, searchRadius };
+	vkCmdPushConstants(commandBuffer, this->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &pushConstants);
+}
+
+auto PLOC::record(VkCommandBuffer commandBuffer, u32 primitiveCount, u32 searchRadius, u32 maxIterations) -> void {
+	if (primitiveCount > this->maxPrimitiveCount)
+		throw std::runtime_error("ploc was created for fewer primitives than it was asked to build over!");
+	if (searchRadius == 0 || searchRadius > MAX_SEARCH_RADIUS)
+		throw std::runtime_error("ploc search radius must be 1 to 32!");
+	if (primitiveCount == 0)
+		return;
+
+	vkCmdBindDescriptorSets(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_COMPUTE,
+		this->pipelineLayout,
+		0,
+		1,
+		&this->descriptorSet,
+		0,
+		nullptr
+	);
+
+	this->pushConstants(commandBuffer, 0, searchRadius);
+	this->initPipeline->bind(commandBuffer);
+	vkCmdDispatch(commandBuffer, workgroupCount(primitiveCount), 1, 1);
+	this->computeBarrier(commandBuffer);
+
+	for (u32 iteration = 0; iteration < maxIterations; iteration++) {
+		const VkDeviceSize dispatchArgs = (iteration % 2) * DISPATCH_ARGS_STRIDE; // written by the previous scan (or init)
+		this->pushConstants(commandBuffer, iteration, searchRadius);
+
+		this->nearestNeighboursPipeline->bind(commandBuffer);
+		vkCmdDispatchIndirect(commandBuffer, this->stateBuffer->getBuffer(), dispatchArgs);
+		this->computeBarrier(commandBuffer);
+
+		this->countPipeline->bind(commandBuffer);
+		vkCmdDispatchIndirect(commandBuffer, this->stateBuffer->getBuffer(), dispatchArgs);
+		this->computeBarrier(commandBuffer);
+
+		this->scanPipeline->bind(commandBuffer); // always one workgroup, carries the count over once done
+		vkCmdDispatch(commandBuffer, 1, 1, 1);
+		this->computeBarrier(commandBuffer);
+
+		this->mergePipeline->bind(commandBuffer); // the scan only wrote the other iteration's arguments
+		vkCmdDispatchIndirect(commandBuffer, this->stateBuffer->getBuffer(), dispatchArgs);
+		this->computeBarrier(commandBuffer);
+	}
+
+	this->pushConstants(commandBuffer, maxIterations, searchRadius);
+	this->finishPipeline->bind(commandBuffer);
+	vkCmdDispatch(commandBuffer, 1, 1, 1);
+}
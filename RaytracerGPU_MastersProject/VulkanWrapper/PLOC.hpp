@@ -0,0 +1,72 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "../utils/PrimitiveTypes.hpp"
+
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "ComputePipeline.hpp"
+#include "Descriptors.hpp"
+
+#include <memory>
+
+/*
+Parallel locally-ordered clustering (Meister and Bittner 2018) over the morton sorted primitives, the alternative
+to ConstructHLBVH + ConstructAABBsOfInternalNodes. Every cluster looks searchRadius places either side for the
+cluster whose merged box has the smallest surface area, mutual pairs merge, and the survivors are compacted in
+order, until only the root is left. Each iteration is PLOCFindNearestNeighbours, PLOCCountClusters,
+PLOCScanClusters and PLOCMerge, sized on the gpu through indirect dispatches, so once the tree is done the
+remaining recorded iterations dispatch nothing. PLOCFinish pairs up whatever is left if maxIterations ran out.
+Writes the same HLBVHNode layout (root at 0, leaves from primitive count - 1 in morton order) and construction
+info parents as the LBVH path, so traversal and OptimizeTreelets work on either.
+The constants mirror shaders/include/ploc.glsl.
+*/
+class PLOC {
+public:
+	static constexpr const u32 WORKGROUP_SIZE = 256;
+	static constexpr const u32 MAX_SEARCH_RADIUS = 32;
+
+	struct PushConstants { // PLOCPushConstants in ploc.glsl
+		u32 iteration;
+		u32 searchRadius;
+	};
+private:
+	Device& device;
+	u32 maxPrimitiveCount;
+
+	std::unique_ptr<DescriptorSetLayout> descriptorSetLayout;
+	std::unique_ptr<DescriptorPool> descriptorPool;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	std::unique_ptr<ComputePipeline> initPipeline;
+	std::unique_ptr<ComputePipeline> nearestNeighboursPipeline;
+	std::unique_ptr<ComputePipeline> countPipeline;
+	std::unique_ptr<ComputePipeline> scanPipeline;
+	std::unique_ptr<ComputePipeline> mergePipeline;
+	std::unique_ptr<ComputePipeline> finishPipeline;
+	std::unique_ptr<Buffer> clusterBuffer; // two halves of node indices, ping-ponged between iterations
+	std::unique_ptr<Buffer> nearestNeighbourBuffer;
+	std::unique_ptr<Buffer> workgroupCountBuffer;
+	std::unique_ptr<Buffer> stateBuffer; // indirect dispatch arguments, cluster counts and the internal node counter
+
+	auto computeBarrier(VkCommandBuffer commandBuffer) -> void;
+	auto pushConstants(VkCommandBuffer commandBuffer, u32 iteration, u32 searchRadius) -> void;
+public:
+	// the buffers are the ones ConstructHLBVH binds. nodes and constructionInfo hold 2 * maxPrimitiveCount - 1 entries
+	PLOC(
+		Device& device, Buffer& uniformBuffer, Buffer& triangles, Buffer& spheres,
+		Buffer& mortonPrimitives, Buffer& nodes, Buffer& constructionInfo, u32 maxPrimitiveCount
+	);
+	~PLOC();
+
+	PLOC(const PLOC&) = delete;
+	PLOC& operator=(const PLOC&) = delete;
+
+	// records the whole build. the sorted morton primitives must be written before (barrier included by the
+	// caller). primitiveCount <= maxPrimitiveCount and must match the uniform buffer's numTriangles + numSpheres
+	auto record(VkCommandBuffer commandBuffer, u32 primitiveCount, u32 searchRadius, u32 maxIterations) -> void;
+
+	static auto workgroupCount(u32 elementCount) -> u32 { return (elementCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE; }
+};
@@ -0,0 +1,130 @@
+#include "RadixSort.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+RadixSort::RadixSort(Device& device, Buffer& keys, Buffer& scratch, u32 maxElementCount) :
+	device{ device },
+	maxElementCount{ maxElementCount }
+{
+	this->descriptorSetLayout = DescriptorSetLayout::Builder(this->device)
+		.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1)
+		.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1)
+		.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1)
+		.build();
+	this->descriptorPool = DescriptorPool::Builder(this->device)
+		.setMaxSets(1)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3)
+		.build();
+
+	const u32 maxWorkgroups = std::max(workgroupCount(maxElementCount), 1u);
+	this->histogramBuffer = std::make_unique<Buffer>(
+		this->device,
+		sizeof(u32),
+		BINS * maxWorkgroups + BINS,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+
+	auto keysInfo = keys.descriptorInfo();
+	auto scratchInfo = scratch.descriptorInfo();
+	auto histogramInfo = this->histogramBuffer->descriptorInfo();
+	DescriptorWriter(*this->descriptorSetLayout, *this->descriptorPool)
+		.writeBuffer(0, &keysInfo)
+		.writeBuffer(1, &scratchInfo)
+		.writeBuffer(2, &histogramInfo)
+		.build(this->descriptorSet);
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstants);
+
+	VkDescriptorSetLayout setLayout = this->descriptorSetLayout->getDescriptorSetLayout();
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(this->device.device(), &pipelineLayoutInfo, nullptr, &this->pipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create radix sort pipeline layout!");
+
+	auto createPipeline = [this](const char* path) {
+		ComputePipelineConfigInfo pipelineConfig{};
+		ComputePipeline::defaultPipelineConfigInfo(pipelineConfig);
+		pipelineConfig.pipelineLayout = this->pipelineLayout;
+		return std::make_unique<ComputePipeline>(this->device, path, pipelineConfig);
+	};
+	this->histogramPipeline = createPipeline("shaders/compiled/RadixSortHistogram.comp.spv");
+	this->scanPipeline = createPipeline("shaders/compiled/RadixSortScan.comp.spv");
+	this->scatterPipeline = createPipeline("shaders/compiled/RadixSortScatter.comp.spv");
+}
+
+RadixSort::~RadixSort() {
+	this->histogramPipeline = nullptr;
+	this->scanPipeline = nullptr;
+	this->scatterPipeline = nullptr;
+	vkDestroyPipelineLayout(this->device.device(), this->pipelineLayout, nullptr);
+}
+
+auto RadixSort::computeBarrier(VkCommandBuffer commandBuffer) -> void {
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr
+	);
+}
+
+auto RadixSort::record(VkCommandBuffer commandBuffer, u32 elementCount, u32 keyBits) -> void {
+	if (elementCount > this->maxElementCount)
+		throw std::runtime_error("radix sort was created for fewer elements than it was asked to sort!");
+	if (keyBits == 0 || keyBits > 64)
+		throw std::runtime_error("radix sort keys are 1 to 64 bits!");
+	if (elementCount == 0)
+		return;
+
+	vkCmdBindDescriptorSets(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_COMPUTE,
+		this->pipelineLayout,
+		0,
+		1,
+		&this->descriptorSet,
+		0,
+		nullptr
+	);
+
+	PushConstants pushConstants{};
+	pushConstants.elementCount = elementCount;
+	pushConstants.workgroupCount = workgroupCount(elementCount);
+	const u32 passes = passCount(keyBits);
+	for (u32 pass = 0; pass < passes; pass++) {
+		pushConstants.shift = pass * BITS_PER_PASS;
+		pushConstants.pass = pass;
+		vkCmdPushConstants(commandBuffer, this->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &pushConstants);
+
+		// the previous pass's scatter (or the caller's barrier) already covers the keys, and its scan the histograms
+		this->histogramPipeline->bind(commandBuffer);
+		vkCmdDispatch(commandBuffer, pushConstants.workgroupCount, 1, 1);
+		this->computeBarrier(commandBuffer);
+
+		this->scanPipeline->bind(commandBuffer);
+		vkCmdDispatch(commandBuffer, BINS, 1, 1);
+		this->computeBarrier(commandBuffer);
+
+		this->scatterPipeline->bind(commandBuffer);
+		vkCmdDispatch(commandBuffer, pushConstants.workgroupCount, 1, 1);
+		if (pass + 1 < passes)
+			this->computeBarrier(commandBuffer);
+	}
+}
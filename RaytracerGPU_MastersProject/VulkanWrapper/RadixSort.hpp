@@ -0,0 +1,66 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "../utils/PrimitiveTypes.hpp"
+
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "ComputePipeline.hpp"
+#include "Descriptors.hpp"
+
+#include <memory>
+
+/*
+Device wide LSD radix sort of MortonPrimitives by (codeHigh, code), spread over every compute unit.
+Each 8 bit pass is three dispatches: RadixSortHistogram counts digits per workgroup tile, RadixSortScan turns
+the counts into per workgroup offsets (one workgroup per bin) and RadixSortScatter moves every key to its place
+in the other buffer, stably. Keys ping-pong between keys and scratch and the pass count is always even, so the
+result ends up back in keys. Work scales linearly with the element count and the key width.
+The constants mirror shaders/include/radixSort.glsl.
+*/
+class RadixSort {
+public:
+	static constexpr const u32 WORKGROUP_SIZE = 256;
+	static constexpr const u32 BINS = 256;
+	static constexpr const u32 BITS_PER_PASS = 8;
+	static constexpr const u32 ELEMENTS_PER_WORKGROUP = WORKGROUP_SIZE * 16;
+
+	struct PushConstants { // RadixSortPushConstants in radixSort.glsl
+		u32 elementCount;
+		u32 shift;
+		u32 workgroupCount;
+		u32 pass;
+	};
+private:
+	Device& device;
+	u32 maxElementCount;
+
+	std::unique_ptr<DescriptorSetLayout> descriptorSetLayout;
+	std::unique_ptr<DescriptorPool> descriptorPool;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	std::unique_ptr<ComputePipeline> histogramPipeline;
+	std::unique_ptr<ComputePipeline> scanPipeline;
+	std::unique_ptr<ComputePipeline> scatterPipeline;
+	std::unique_ptr<Buffer> histogramBuffer; // BINS counts per workgroup, then BINS totals
+
+	auto computeBarrier(VkCommandBuffer commandBuffer) -> void;
+public:
+	// keys and scratch must each hold maxElementCount MortonPrimitives and be storage buffers
+	RadixSort(Device& device, Buffer& keys, Buffer& scratch, u32 maxElementCount);
+	~RadixSort();
+
+	RadixSort(const RadixSort&) = delete;
+	RadixSort& operator=(const RadixSort&) = delete;
+
+	// records the whole sort on the low keyBits bits of (codeHigh, code), 30 or 63 for morton codes. keys must be
+	// written before (barrier included by the caller) and hold the sorted result after, scratch is overwritten.
+	// elementCount <= maxElementCount
+	auto record(VkCommandBuffer commandBuffer, u32 elementCount, u32 keyBits) -> void;
+
+	static auto passCount(u32 keyBits) -> u32 { return ((keyBits + 2 * BITS_PER_PASS - 1) / (2 * BITS_PER_PASS)) * 2; } // rounded up to even
+
+	static auto workgroupCount(u32 elementCount) -> u32 { return (elementCount + ELEMENTS_PER_WORKGROUP - 1) / ELEMENTS_PER_WORKGROUP; }
+};
@@ -4,6 +4,7 @@
 #include "utils.hpp"
 #include "../utils/Functions.hpp"
 #include "../utils/Functors.hpp"
+#include "../CPU/Presplit.hpp"
 
 #include <variant>
 #include <memory>
@@ -39,6 +40,18 @@ auto RaytraceScene::getRaysPerPixel() -> u32 {
 	return this->raysPerPixel;
 }
 
+auto RaytraceScene::setBVHBuilder(SceneTypes::BVHBuilder builder) -> void {
+	this->bvhBuilder = builder;
+}
+
+auto RaytraceScene::getBVHBuilder() -> SceneTypes::BVHBuilder {
+	return this->bvhBuilder;
+}
+
+auto RaytraceScene::setPresplitBudget(u32 percent) -> void {
+	this->presplitBudget = percent;
+}
+
 auto RaytraceScene::getCamera() -> CameraGameObject& {
 	return this->camera;
 }
@@ -144,7 +157,29 @@ auto RaytraceScene::getMaterialCount() -> u32 {
 	return this->materialCount;
 }
 
+auto RaytraceScene::getHostModels() const -> const std::vector<SceneTypes::GPU::Model>& {
+	return this->models;
+}
+
+auto RaytraceScene::getHostTriangles() const -> const std::vector<SceneTypes::GPU::Triangle>& {
+	return this->triangles;
+}
+
+auto RaytraceScene::getHostSpheres() const -> const std::vector<SceneTypes::GPU::Sphere>& {
+	return this->spheres;
+}
+
+auto RaytraceScene::getHostMaterials() const -> const std::vector<SceneTypes::GPU::Material>& {
+	return this->materials;
+}
+
+auto RaytraceScene::getHostInstances() const -> const std::vector<SceneTypes::CPU::Instance>& {
+	return this->instances;
+}
+
 auto RaytraceScene::createBuffers() -> void {
+	if (this->presplitBudget > 0 && this->presplitTriangles.empty())
+		this->splitTriangles();
 	this->moveGameObjectsToHostVectors();
 	this->createModelBuffer();
 	this->createTriangleBuffer();
@@ -154,11 +189,22 @@ auto RaytraceScene::createBuffers() -> void {
 	this->buffersCreated = true;
 }
 
+auto RaytraceScene::splitTriangles() -> void {
+	std::vector<CPU::PresplitObject> objects;
+	objects.reserve(this->gameObjects.size());
+	for (auto& gameObject : this->gameObjects) {
+		auto triangles = getVariantFromSharedPtr<RTModel_Triangles>(gameObject.getModel());
+		objects.push_back({ triangles != nullptr ? &triangles->getTriangles() : nullptr, gameObject.transform.mat4() });
+	}
+	this->presplitTriangles = CPU::presplitTriangles(objects, this->presplitBudget);
+}
+
 auto RaytraceScene::moveGameObjectsToHostVectors() -> void {
 	this->models.clear();
 	this->triangles.clear();
 	this->spheres.clear();
 	this->materials.clear();
+	this->instances.clear();
 	//this->lights.clear();
 	for (auto i = 0; i < this->gameObjects.size(); i++) {
 		const auto modelIndex = this->models.size();
@@ -169,7 +215,15 @@ auto RaytraceScene::moveGameObjectsToHostVectors() -> void {
 		) {
 			const auto materialIndex = this->materials.size();
 			this->materials.push_back(triangles->getMaterialType());
-			const auto& triangleList = triangles->getTriangles();
+			const auto& triangleList = i < this->presplitTriangles.size() ? this->presplitTriangles[i] : triangles->getTriangles();
+			this->instances.push_back({
+				this->gameObjects[i].getModel().get(),
+				static_cast<u32>(modelIndex),
+				static_cast<u32>(materialIndex),
+				static_cast<u32>(this->triangles.size()),
+				static_cast<u32>(triangleList.size()),
+				true
+			});
 			for (const auto& triangle : triangleList) {
 				this->triangles.push_back(
 					SceneTypes::GPU::Triangle::convertFromCPUTriangle(triangle, materialIndex, modelIndex)
@@ -182,6 +236,14 @@ auto RaytraceScene::moveGameObjectsToHostVectors() -> void {
 		) {
 			const auto materialIndex = this->materials.size();
 			this->materials.push_back(sphere->getMaterialType());
+			this->instances.push_back({
+				this->gameObjects[i].getModel().get(),
+				static_cast<u32>(modelIndex),
+				static_cast<u32>(materialIndex),
+				static_cast<u32>(this->spheres.size()),
+				1,
+				false
+			});
 			this->spheres.push_back(
 				SceneTypes::GPU::Sphere{
 					sphere->getCenter(),
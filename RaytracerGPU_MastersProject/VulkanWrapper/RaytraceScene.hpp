@@ -39,6 +39,9 @@ class RaytraceScene {
 	std::vector<SceneTypes::GPU::Sphere> spheres;
 	std::vector<SceneTypes::GPU::Material> materials;
 	std::vector<SceneTypes::GPU::Light> lights;
+	std::vector<SceneTypes::CPU::Instance> instances;
+	u32 presplitBudget = 0; // percent, see Config presplitBudget
+	std::vector<std::vector<SceneTypes::CPU::Triangle>> presplitTriangles; // per GameObject, replaces its model's triangles. filled once by prepForRender
 
 	// buffer objects on gpu and associated element counts
 	std::unique_ptr<Buffer> modelBuffer;
@@ -58,6 +61,7 @@ class RaytraceScene {
 
 	u32 maxRaytraceDepth;
 	u32 raysPerPixel;
+	SceneTypes::BVHBuilder bvhBuilder = SceneTypes::BVHBuilder::LBVH;
 	// some methods throw runtime errors if called before buffers are set
 	bool buffersCreated;
 
@@ -75,6 +79,9 @@ public:
 	auto setRaysPerPixel(u32) -> void;
 	auto getMaxRaytraceDepth() -> u32;
 	auto getRaysPerPixel() -> u32;
+	auto setBVHBuilder(SceneTypes::BVHBuilder) -> void;
+	auto getBVHBuilder() -> SceneTypes::BVHBuilder;
+	auto setPresplitBudget(u32 percent) -> void; // before prepForRender, which splits with the GameObjects' transforms then
 
 	auto getCamera() -> CameraGameObject&;
 
@@ -101,8 +108,16 @@ public:
 	auto getMaterialCount() -> u32;
 	//auto getLightCount() -> u32;
 
+	// host copies from the last moveGameObjectsToHostVectors (model space, same layout as the gpu buffers)
+	auto getHostModels() const -> const std::vector<SceneTypes::GPU::Model>&;
+	auto getHostTriangles() const -> const std::vector<SceneTypes::GPU::Triangle>&;
+	auto getHostSpheres() const -> const std::vector<SceneTypes::GPU::Sphere>&;
+	auto getHostMaterials() const -> const std::vector<SceneTypes::GPU::Material>&;
+	auto getHostInstances() const -> const std::vector<SceneTypes::CPU::Instance>&;
+
 private:
 	auto createBuffers() -> void;
+	auto splitTriangles() -> void;
 	auto moveGameObjectsToHostVectors() -> void;
 	auto createModelBuffer() -> void;
 	auto createTriangleBuffer() -> void;
@@ -17,6 +17,12 @@ namespace SceneTypes {
 		METALLIC = 2,
 		DIELECTRIC = 3
 	};
+	enum class BVHBuilder : u32 { // how S1 turns the sorted morton primitives into the HLBVHNode tree
+		LBVH = 0, // ConstructHLBVH + ConstructAABBsOfInternalNodes. fastest build
+		PLOC = 1, // parallel locally-ordered clustering (VulkanWrapper/PLOC.hpp). a few times the build cost, near sah quality
+		BinnedSAH = 2, // CPU::buildBinnedSAH once at load, for static scenes. S1 then only moves primitives to world space
+		TwoLevel = 3 // model space BLAS per model once at load, a TLAS over the GameObjects on the cpu every frame (CPU::TwoLevelBVH)
+	};
 	namespace CPU {
 		struct Triangle {
 			glm::vec3 v0;
@@ -27,6 +33,14 @@ namespace SceneTypes {
 			glm::vec3 center;
 			f32 radius;
 		};
+		struct Instance { // one per GameObject, where its primitives went in the flattened scene buffers
+			const void* model; // the RTModel, shared by every GameObject made from the same one
+			u32 modelIndex;
+			u32 materialIndex;
+			u32 firstPrimitive; // into the triangles, or the sphere's index
+			u32 primitiveCount;
+			bool triangles;
+		};
 	}
 	namespace GPU { // meant to be stored in SSBOs and have strict sizes and alignments for use on gpu
 		struct Model {
@@ -110,9 +124,10 @@ namespace SceneTypes {
 			f32 minZ; f32 maxZ;
 		};
 		struct MortonPrimitive {
-			u32 code;
+			u32 code; // low 32 bits
 			u32 primitiveIndex;
 			u32 primitiveType;
+			u32 codeHigh; // bits 32 - 62 of 63 bit codes, 0 for 30 bit codes
 		};
 		struct BVHNode {
 			AABB aabb;
@@ -121,6 +136,30 @@ namespace SceneTypes {
 			u32 primitiveIndex;
 			u32 primitiveType;
 		};
+		struct BVHConstructionInfo { // HLBVHAABBConstructionInfo
+			u32 parent;
+			u32 visitationCount;
+		};
+		struct Instance { // TwoLevelBVH TLAS leaf target, rays are moved into model space to trace the BLAS
+			glm::mat4 worldToModel;
+			u32 blasRoot; // into HLBVHNodesBuffer
+			u32 materialIndex; // the GameObject's, the BLAS primitives carry the first instance's
+			u32 modelIndex;
+			u32 padding;
+		};
+		struct BVH4Node { // CollapseBVH4, child boxes as struct of arrays
+			glm::vec4 minX; glm::vec4 maxX;
+			glm::vec4 minY; glm::vec4 maxY;
+			glm::vec4 minZ; glm::vec4 maxZ;
+			glm::uvec4 children;
+		};
+		struct CompressedBVH4Node { // CollapseBVH4 with compressedBVH, see definitions.glsl for the encoding
+			glm::vec3 origin;
+			u32 exponents;
+			u32 quantized[6];
+			u32 padding[2];
+			glm::uvec4 children;
+		};
 	};
 
 	using Material = SceneTypes::GPU::Material;
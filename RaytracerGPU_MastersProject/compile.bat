@@ -3,13 +3,32 @@ C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/logistic.comp -o shaders/co
 C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/ModelSpaceToWorldSpace.comp -o shaders/compiled/ModelSpaceToWorldSpace.comp.spv
 
 C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/GetEnclosingAABB.comp -o shaders/compiled/GetEnclosingAABB.comp.spv --target-env=vulkan1.1
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/GetEnclosingAABBFinalize.comp -o shaders/compiled/GetEnclosingAABBFinalize.comp.spv
 C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/GenerateMortonCodesOfPrimitives.comp -o shaders/compiled/GenerateMortonCodesOfPrimitives.comp.spv
 C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/RadixSortSimple.comp -o shaders/compiled/RadixSortSimple.comp.spv --target-env=vulkan1.1
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/RadixSortHistogram.comp -o shaders/compiled/RadixSortHistogram.comp.spv --target-env=vulkan1.1
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/RadixSortScan.comp -o shaders/compiled/RadixSortScan.comp.spv --target-env=vulkan1.1
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/RadixSortScatter.comp -o shaders/compiled/RadixSortScatter.comp.spv --target-env=vulkan1.1
 C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/ConstructHLBVH.comp -o shaders/compiled/ConstructHLBVH.comp.spv
 C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/ConstructAABBsOfInternalNodes.comp -o shaders/compiled/ConstructAABBsOfInternalNodes.comp.spv
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/OptimizeTreelets.comp -o shaders/compiled/OptimizeTreelets.comp.spv
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/LeafCollapseCosts.comp -o shaders/compiled/LeafCollapseCosts.comp.spv
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/LeafCollapseRanges.comp -o shaders/compiled/LeafCollapseRanges.comp.spv
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/LeafCollapseApply.comp -o shaders/compiled/LeafCollapseApply.comp.spv
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/RefitBVH.comp -o shaders/compiled/RefitBVH.comp.spv
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/CollapseBVH4.comp -o shaders/compiled/CollapseBVH4.comp.spv
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/PLOCInit.comp -o shaders/compiled/PLOCInit.comp.spv
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/PLOCFindNearestNeighbours.comp -o shaders/compiled/PLOCFindNearestNeighbours.comp.spv
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/PLOCCountClusters.comp -o shaders/compiled/PLOCCountClusters.comp.spv --target-env=vulkan1.1
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/PLOCScanClusters.comp -o shaders/compiled/PLOCScanClusters.comp.spv --target-env=vulkan1.1
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/PLOCMerge.comp -o shaders/compiled/PLOCMerge.comp.spv --target-env=vulkan1.1
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/PLOCFinish.comp -o shaders/compiled/PLOCFinish.comp.spv
 
 C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/raytrace.comp -o shaders/compiled/raytrace.comp.spv
 C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/raytraceBVH.comp -o shaders/compiled/raytraceBVH.comp.spv
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/raytraceBVH.comp -DTRAVERSAL_STATS -o shaders/compiled/raytraceBVHStats.comp.spv --target-env=vulkan1.1
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/raytraceBVH.comp -DHEATMAP -o shaders/compiled/raytraceBVHHeatmap.comp.spv
+C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/compute/raytraceBVH.comp -DHEATMAP -DUSE_SHADER_CLOCK -o shaders/compiled/raytraceBVHHeatmapClock.comp.spv --target-env=vulkan1.1
 
 C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/fragment/SingleTriangleFullScreen.frag -o shaders/compiled/SingleTriangleFullScreen.frag.spv
 C:\VulkanSDK\1.3.250.1\Bin\glslc.exe shaders/vertex/SingleTriangleFullScreen.vert -o shaders/compiled/SingleTriangleFullScreen.vert.spv
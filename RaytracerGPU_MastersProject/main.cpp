@@ -1,21 +1,68 @@
-
 #include "Config.hpp"
 
 #include "LogisticMap.hpp"
 #include "Raytracer.hpp"
 #include "RaytracerBVH.hpp"
+#include "Benchmark.hpp"
+#include "CPU/ReferenceRaytracer.hpp"
+#include "Regression.hpp"
+#include "Scenes.hpp"
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
 
-int main() {
-	if constexpr (Config::CurrentProgram == Config::Programs::LogisticMap) {
-		LogisticMapRenderer::LogisticMap comp{};
-		comp.mainLoop();
+int main(int argc, char** argv) {
+	std::unique_ptr<Util::Telemetry::Session> telemetry; // writer thread for the whole run, records from every program go through it
+	try {
+		Config::load(argc, argv);
+		telemetry = std::make_unique<Util::Telemetry::Session>(
+			Config::get().telemetryPath, Config::get().telemetryLevel, Config::get().logLevel
+		);
 	}
-	else if constexpr (Config::CurrentProgram == Config::Programs::Raytracer) {
-		RaytracerRenderer::Raytracer comp{};
-		comp.mainLoop();
+	catch (const std::runtime_error& e) {
+		std::cerr << e.what() << "\n";
+		return 1;
 	}
-	else if constexpr (Config::CurrentProgram == Config::Programs::RaytracerBVH) {
-		RaytracerBVHRenderer::Raytracer comp{};
-		comp.mainLoop();
+	const auto& settings = Config::get();
+	if (settings.deterministicSeeding)
+		seedSceneRandom(settings.seed);
+
+	switch (settings.program) {
+		case Config::Programs::LogisticMap: {
+			LogisticMapRenderer::LogisticMap comp{};
+			comp.mainLoop();
+			break;
+		}
+		case Config::Programs::Raytracer: {
+			RaytracerRenderer::Raytracer comp{};
+			comp.mainLoop();
+			break;
+		}
+		case Config::Programs::RaytracerBVH: {
+			if (settings.headless) {
+				RaytracerBVHRenderer::Raytracer comp{ settings.width, settings.height, findScene(settings.scene) };
+				comp.renderHeadless(settings.frames, settings.outputPath);
+			}
+			else {
+				RaytracerBVHRenderer::Raytracer comp{ findScene(settings.scene), settings.width, settings.height };
+				comp.mainLoop();
+			}
+			break;
+		}
+		case Config::Programs::RaytracerBVHBenchmark:
+			Benchmark::run();
+			break;
+		case Config::Programs::CPUReference:
+			CPU::renderReference(
+				settings.scene, settings.width, settings.height,
+				settings.frames, settings.threadCount, settings.outputPath
+			);
+			break;
+		case Config::Programs::ImageRegression:
+			return Regression::run() ? 0 : 1;
+		case Config::Programs::RadixSortBenchmark:
+			Benchmark::runRadixSort();
+			break;
 	}
 }
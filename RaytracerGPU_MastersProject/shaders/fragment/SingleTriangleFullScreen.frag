@@ -4,14 +4,23 @@ layout (location = 0) in vec2 inUV;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
 	uint raysPerPixel;
+	uint visualizationMode; // 0 radiance, 1 traversal cost heatmap (cost accumulated in r)
+	float heatmapMaxCost; // average cost per sample that maps to the top of the colormap
 } ubo;
 
 layout (binding = 1) uniform sampler2D image;
 
 layout (location = 0) out vec4 fragColor;
 
+#include "../include/colormap.glsl"
+
 void main() {
 	vec3 uncorrected = texture(image, inUV).xyz;
+	if (ubo.visualizationMode == 1) {
+		float averageCost = uncorrected.r / float(ubo.raysPerPixel);
+		fragColor = vec4(heatmapColor(averageCost / ubo.heatmapMaxCost), 1.0);
+		return;
+	}
 	vec3 corrected = clamp(
 		sqrt(uncorrected / float(ubo.raysPerPixel))
 		, 0.0, 1.0
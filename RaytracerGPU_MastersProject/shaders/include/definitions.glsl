@@ -56,9 +56,10 @@ struct AABB {
 };
 
 struct MortonPrimitive {
-	uint code;
+	uint code; // low 32 bits
 	uint primitiveIndex;
 	uint primitiveType;
+	uint codeHigh; // bits 32 - 62 of 63 bit codes, 0 for 30 bit codes
 };
 
 #define INVALID_HLBVHNODE_INDEX 0
@@ -76,6 +77,65 @@ struct HLBVHAABBConstructionInfo {
 	int visitationCount;
 };
 
+struct HLBVHTreeletInfo { // OptimizeTreelets
+	float cost; // sah cost of the subtree, not yet divided by the root's surface area
+	uint primitiveCount;
+};
+
+struct HLBVHLeafCollapseInfo { // LeafCollapse
+	float cost; // sah cost of the subtree once collapsed below, not yet divided by the root's surface area
+	uint primitiveCount;
+	uint collapse; // subtree becomes one leaf, unless an ancestor's does
+	uint rangeStart; // first primitiveReferences entry, only set on the topmost collapsing nodes
+};
+
+// primitiveType of leaves LeafCollapse made out of whole subtrees. the low bits are the primitive count and
+// primitiveIndex the first of their primitiveReferences, which hold the primitives in depth first order
+#define LEAF_RANGE_BIT 0x80000000u
+#define PRIMITIVE_REFERENCE_TRIANGLE_BIT 0x80000000u // primitiveReferences entries are the primitive index with this on triangles
+
+// CollapseBVH4. the binary tree's nodes at even depth, each holding its (up to) four grandchildren side by side so
+// one fetch tests every child box. indexed like the binary node it came from, so odd depth slots are never used
+struct BVH4Node {
+	vec4 minX; vec4 maxX;
+	vec4 minY; vec4 maxY;
+	vec4 minZ; vec4 maxZ;
+	uvec4 children; // BVH4Node index, or BVH4_LEAF_BIT | primitive (or range leaf node). empty slots have inverted boxes that never hit
+};
+
+#define BVH4_LEAF_BIT 0x80000000u
+#define BVH4_TRIANGLE_BIT 0x40000000u // set on triangle leaves, clear on spheres
+#define BVH4_RANGE_BIT 0x20000000u // the rest is the HLBVHNode index of a LEAF_RANGE_BIT leaf instead of a primitive
+#define BVH4_PRIMITIVE_MASK 0x1FFFFFFFu
+#define BVH4_EMPTY_CHILD 0xFFFFFFFFu
+
+// CollapseBVH4 with compressedBVH. a BVH4Node in 64 bytes instead of 112: child boxes quantized to 8 bits per side
+// within the box of all four, whose min is origin. each axis' step is a power of two, its biased float exponent a byte
+// of exponents (x lowest), so dequantizing is origin + q * step. quantized holds minX, maxX, minY, maxY, minZ, maxZ,
+// a byte per child (child 0 lowest), rounded outwards. leaves never get a node of their own: single primitives are
+// the child word as in BVH4Node, and range leaves carry their primitiveReferences range in it too instead of an
+// HLBVHNode index, so traversal never touches the binary nodes
+struct CompressedBVH4Node {
+	vec3 origin;
+	uint exponents;
+	uint quantized[6];
+	uvec2 padding; // children on a 16 byte boundary, the node on 64
+	uvec4 children;
+};
+
+#define COMPRESSED_RANGE_COUNT_SHIFT 25 // BVH4_RANGE_BIT children, primitive count - 1 above the first reference
+#define COMPRESSED_RANGE_FIRST_MASK 0x1FFFFFFu
+
+// TwoLevelBVH. TLAS leaves are INSTANCE_PRIMITIVE, primitiveIndex the instance. its BLAS (in the HLBVHNode array, model
+// space) is traced with the ray moved into model space
+struct Instance {
+	mat4 worldToModel;
+	uint blasRoot;
+	uint materialIndex; // the GameObject's, BLAS primitives carry the first instance's
+	uint modelIndex;
+	uint padding;
+};
+
 #define LIGHT_MATERIAL 0
 #define DIFFUSE_MATERIAL 1
 #define METALLIC_MATERIAL 2
@@ -83,3 +143,4 @@ struct HLBVHAABBConstructionInfo {
 
 #define SPHERE_PRIMITIVE 0
 #define TRIANGLE_PRIMITIVE 1
+#define INSTANCE_PRIMITIVE 2
@@ -0,0 +1,57 @@
+/*
+	shared by LeafCollapseCosts, LeafCollapseRanges and LeafCollapseApply (see VulkanWrapper/LeafCollapse.hpp).
+	turns every subtree of at most maxLeafPrimitives primitives, where the sah says so (or always with sahDecision 0),
+	into one leaf over a contiguous range of primitiveReferences. the nodes below stay in the buffer unreachable.
+	the constants must match LeafCollapse's in c++
+*/
+
+#define WORKGROUP_SIZE 256
+#define INVALID_RANGE 0xFFFFFFFFu
+
+layout(local_size_x = WORKGROUP_SIZE) in;
+
+layout(binding = 0) uniform ParameterUBO {
+	vec4 camPos; // ignore w
+	vec4 camLookAt; // ignore w
+	vec4 camUpDir; // ignore w
+	float verticalFOV;
+	uint numTriangles;
+	uint numSpheres;
+	uint numMaterials;
+	uint numLights;
+	uint maxRayTraceDepth;
+	uint randomState;
+} ubo;
+
+layout(std430, binding = 1) coherent buffer HLBVH {
+	HLBVHNode nodes[ ]; // Leaf + internal = num elems + num elements - 1
+};
+layout(std430, binding = 2) coherent buffer HLBVHAABBConstructionInfoBufferObject {
+	HLBVHAABBConstructionInfo constructionInfo[ ];
+};
+layout(std430, binding = 3) coherent buffer HLBVHLeafCollapseInfoBufferObject {
+	HLBVHLeafCollapseInfo collapseInfo[ ]; // one per node
+};
+layout(std430, binding = 4) buffer PrimitiveReferenceBufferObject {
+	uint primitiveReferences[ ]; // one per primitive, depth first order
+};
+
+layout(push_constant) uniform LeafCollapsePushConstants {
+	uint maxLeafPrimitives;
+	uint sahDecision;
+} pc;
+
+// keep in sync with CPU::SAH_TRAVERSAL_COST and CPU::SAH_INTERSECTION_COST
+const float SAH_TRAVERSAL_COST = 1.2;
+const float SAH_INTERSECTION_COST = 1.0;
+
+uint primitiveCount() {
+	return ubo.numTriangles + ubo.numSpheres;
+}
+
+float surfaceArea(in AABB box) {
+	float x = box.maxX - box.minX;
+	float y = box.maxY - box.minY;
+	float z = box.maxZ - box.minZ;
+	return 2.0 * (x * y + y * z + z * x);
+}
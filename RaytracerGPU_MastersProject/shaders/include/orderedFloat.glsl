@@ -0,0 +1,12 @@
+/*
+	floats as uints that sort the same way, so atomicMin and atomicMax on them act as float min and max.
+	positives get the sign bit set, negatives have every bit flipped. 0xFFFFFFFF and 0 are identities for min and max
+*/
+
+uint floatToOrdered(float f) {
+	uint bits = floatBitsToUint(f);
+	return (bits & 0x80000000u) != 0 ? ~bits : bits | 0x80000000u;
+}
+float orderedToFloat(uint ordered) {
+	return uintBitsToFloat((ordered & 0x80000000u) != 0 ? ordered & 0x7FFFFFFFu : ~ordered);
+}
@@ -0,0 +1,113 @@
+/*
+	shared by the PLOC* shaders (see the PLOC builder in RaytracerBVH). clusters start as the morton sorted leaves and
+	every iteration merges each pair of clusters that are each other's nearest neighbour (smallest combined surface
+	area within searchRadius places of each other), keeping morton order, until one cluster, the root, is left.
+	clusters ping-pong between the two halves of the cluster buffer, iteration i reads half i % 2.
+	the constants must match the PLOC ones in c++
+*/
+
+#define WORKGROUP_SIZE 256
+#define MAX_SEARCH_RADIUS 32
+
+layout(local_size_x = WORKGROUP_SIZE) in;
+
+layout(binding = 0) uniform ParameterUBO {
+	vec4 camPos; // ignore w
+	vec4 camLookAt; // ignore w
+	vec4 camUpDir; // ignore w
+	float verticalFOV;
+	uint numTriangles;
+	uint numSpheres;
+	uint numMaterials;
+	uint numLights;
+	uint maxRayTraceDepth;
+	uint randomState;
+} ubo;
+
+layout(std430, binding = 1) buffer TriangleBufferObject {
+	Triangle triangles[ ];
+};
+layout(std430, binding = 2) buffer SpheresBufferObject {
+	Sphere spheres[ ];
+};
+layout(std430, binding = 3) buffer MortonPrimitivesBufferObject {
+	MortonPrimitive mortonPrimitives[ ];
+};
+layout(std430, binding = 4) buffer HLBVH {
+	HLBVHNode nodes[ ]; // Leaf + internal = num elems + num elements - 1
+};
+layout(std430, binding = 5) buffer HLBVHAABBConstructionInfoBufferObject {
+	HLBVHAABBConstructionInfo constructionInfo[ ];
+};
+layout(std430, binding = 6) buffer ClusterBufferObject {
+	uint clusters[ ]; // node index of each cluster, 2 * primitive count
+};
+layout(std430, binding = 7) buffer NearestNeighbourBufferObject {
+	uint nearestNeighbours[ ]; // cluster position of each cluster's nearest neighbour
+};
+layout(std430, binding = 8) buffer WorkgroupCountBufferObject {
+	uint workgroupCounts[ ]; // surviving clusters per workgroup, scanned in place into each workgroup's output offset
+};
+layout(std430, binding = 9) buffer PLOCStateBufferObject {
+	uvec4 dispatchArgs[2]; // VkDispatchIndirectCommand (xyz) for iterations reading half 0 and half 1
+	uint clusterCount[2];
+	uint internalNodeCount; // merges so far, internal nodes are handed out from primitive count - 2 down to the root at 0
+} state;
+
+layout(push_constant) uniform PLOCPushConstants {
+	uint iteration;
+	uint searchRadius; // at most MAX_SEARCH_RADIUS
+} pc;
+
+uint primitiveCount() {
+	return ubo.numTriangles + ubo.numSpheres;
+}
+uint inputOffset() {
+	return (pc.iteration % 2) * primitiveCount();
+}
+uint outputOffset() {
+	return ((pc.iteration + 1) % 2) * primitiveCount();
+}
+
+AABB combineAABB(in AABB a, in AABB b) {
+	AABB combined;
+	combined.minX = min(a.minX, b.minX);
+	combined.maxX = max(a.maxX, b.maxX);
+	combined.minY = min(a.minY, b.minY);
+	combined.maxY = max(a.maxY, b.maxY);
+	combined.minZ = min(a.minZ, b.minZ);
+	combined.maxZ = max(a.maxZ, b.maxZ);
+	return combined;
+}
+
+float surfaceArea(in AABB box) {
+	float x = box.maxX - box.minX;
+	float y = box.maxY - box.minY;
+	float z = box.maxZ - box.minZ;
+	return 2.0 * (x * y + y * z + z * x);
+}
+
+// a cluster survives an iteration unless it is the right half of a mutual nearest neighbour pair
+bool mergesWithNeighbour(uint position) {
+	uint neighbour = nearestNeighbours[position];
+	return nearestNeighbours[neighbour] == position;
+}
+bool survives(uint position) {
+	return !mergesWithNeighbour(position) || position < nearestNeighbours[position];
+}
+
+// writes the internal node over two clusters. the last merge overall gets index 0, the root
+uint mergeClusters(uint leftNode, uint rightNode) {
+	uint nodeIndex = primitiveCount() - 2 - atomicAdd(state.internalNodeCount, 1);
+	nodes[nodeIndex] = HLBVHNode(
+		combineAABB(nodes[leftNode].aabb, nodes[rightNode].aabb),
+		leftNode,
+		rightNode,
+		INVALID_HLBVHNODE_INDEX,
+		0
+	);
+	// same parents ConstructHLBVH writes, so OptimizeTreelets can climb PLOC trees too. counts start even
+	constructionInfo[leftNode] = HLBVHAABBConstructionInfo(nodeIndex, 0);
+	constructionInfo[rightNode] = HLBVHAABBConstructionInfo(nodeIndex, 0);
+	return nodeIndex;
+}
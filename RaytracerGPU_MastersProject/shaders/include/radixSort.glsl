@@ -0,0 +1,49 @@
+/*
+	shared by RadixSortHistogram, RadixSortScan and RadixSortScatter (see VulkanWrapper/RadixSort.hpp).
+	one 8 bit digit per pass, keys ping-pong between keys1 and keys2 (even passes read keys1), so after an even
+	number of passes the sorted result is back in keys1.
+	the constants must match RadixSort's in c++
+*/
+
+#define WORKGROUP_SIZE 256
+#define BINS 256 // one invocation per bin in every pass, so must equal WORKGROUP_SIZE
+#define BLOCKS_PER_WORKGROUP 16
+#define ELEMENTS_PER_WORKGROUP (WORKGROUP_SIZE * BLOCKS_PER_WORKGROUP)
+
+layout(local_size_x = WORKGROUP_SIZE) in;
+
+layout(push_constant) uniform RadixSortPushConstants {
+	uint elementCount;
+	uint shift; // bit of the 64 bit (codeHigh, code) the current digit starts at
+	uint workgroupCount; // histogram and scatter workgroups, ceil(elementCount / ELEMENTS_PER_WORKGROUP)
+	uint pass;
+} pc;
+
+layout(std430, binding = 0) buffer KeysBufferObject1 {
+	MortonPrimitive keys1[ ];
+};
+layout(std430, binding = 1) buffer KeysBufferObject2 {
+	MortonPrimitive keys2[ ];
+};
+// bin major: histograms[bin * workgroupCount + workgroup] is that workgroup's count of the bin, turned into its
+// offset within the bin by RadixSortScan. the BINS entries after them are the bin totals
+layout(std430, binding = 2) buffer HistogramBufferObject {
+	uint histograms[ ];
+};
+
+#define BIN_TOTAL(bin) histograms[BINS * pc.workgroupCount + (bin)]
+
+MortonPrimitive readKey(uint index) {
+	return pc.pass % 2 == 0 ? keys1[index] : keys2[index];
+}
+void writeKey(uint index, MortonPrimitive key) {
+	if (pc.pass % 2 == 0)
+		keys2[index] = key;
+	else
+		keys1[index] = key;
+}
+uint digitOf(MortonPrimitive key) { // digits never straddle the two words
+	return (pc.shift < 32 ? key.code >> pc.shift : key.codeHigh >> (pc.shift - 32)) & (BINS - 1);
+}
+
+#include "workgroupScan.glsl"
@@ -22,6 +22,21 @@ float stepAndOutputRNGFloat(inout uint rngState) {
 	return float(word) / 4294967295.0f;
 }
 
+// pcg hash, for turning (pixel, sample, frame, seed) into independent starting states
+// https://www.reedbeta.com/blog/hash-functions-for-gpu-rendering/
+uint pcgHash(uint v) {
+	uint state = v * 747796405 + 2891336453;
+	uint word = ((state >> ((state >> 28) + 4)) ^ state) * 277803737;
+	return (word >> 22) ^ word;
+}
+
+uint deterministicSeed(uvec2 pixel, uint imageWidth, uint sampleIndex, uint frameIndex, uint userSeed) {
+	uint seed = pcgHash(userSeed);
+	seed = pcgHash(seed ^ frameIndex);
+	seed = pcgHash(seed ^ sampleIndex);
+	return pcgHash(seed ^ (pixel.y * imageWidth + pixel.x));
+}
+
 float random() {
 	return stepAndOutputRNGFloat(rngState);
 }
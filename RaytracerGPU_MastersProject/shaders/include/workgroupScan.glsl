@@ -0,0 +1,26 @@
+// workgroup wide exclusive scan from subgroup scans. define WORKGROUP_SIZE and enable
+// GL_KHR_shader_subgroup_basic + GL_KHR_shader_subgroup_arithmetic before including
+
+shared uint scanSums[WORKGROUP_SIZE + 1]; // one per subgroup, then the total
+
+// exclusive sum of value over the workgroup. every invocation must call it (it has barriers)
+uint workgroupExclusiveAdd(uint value, out uint total) {
+	uint inclusive = subgroupInclusiveAdd(value);
+	if (gl_SubgroupInvocationID == gl_SubgroupSize - 1)
+		scanSums[gl_SubgroupID] = inclusive;
+	barrier();
+	if (gl_LocalInvocationID.x == 0) { // only gl_NumSubgroups entries (8 with 32 wide subgroups), not worth a parallel scan
+		uint running = 0;
+		for (uint i = 0; i < gl_NumSubgroups; i++) {
+			uint subgroupTotal = scanSums[i];
+			scanSums[i] = running;
+			running += subgroupTotal;
+		}
+		scanSums[gl_NumSubgroups] = running;
+	}
+	barrier();
+	uint result = scanSums[gl_SubgroupID] + inclusive - value;
+	total = scanSums[gl_NumSubgroups];
+	barrier(); // scanSums can be reused once this returns
+	return result;
+}
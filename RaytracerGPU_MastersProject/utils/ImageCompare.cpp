@@ -0,0 +1,81 @@
+#include "ImageCompare.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace Util {
+	namespace {
+		constexpr const u32 SSIM_WINDOW = 8;
+		constexpr const u32 SSIM_STRIDE = 4;
+		constexpr const f64 SSIM_C1 = (0.01 * 1.0) * (0.01 * 1.0); // (k1 * dynamic range)^2
+		constexpr const f64 SSIM_C2 = (0.03 * 1.0) * (0.03 * 1.0);
+
+		auto toDisplay(f32 linear) -> f64 {
+			return std::clamp(std::sqrt(std::max(static_cast<f64>(linear), 0.0)), 0.0, 1.0);
+		}
+
+		auto luminance(const std::vector<f64>& display, size_t pixel) -> f64 { // rec. 709 weights
+			return 0.2126 * display[pixel * 3] + 0.7152 * display[pixel * 3 + 1] + 0.0722 * display[pixel * 3 + 2];
+		}
+
+		// Wang et al. 2004, with a box window instead of the gaussian
+		auto meanSSIM(u32 width, u32 height, const std::vector<f64>& a, const std::vector<f64>& b) -> f64 {
+			if (width < SSIM_WINDOW || height < SSIM_WINDOW)
+				return a == b ? 1.0 : 0.0;
+			f64 total = 0.0;
+			u32 windows = 0;
+			constexpr const f64 n = SSIM_WINDOW * SSIM_WINDOW;
+			for (u32 y0 = 0; y0 + SSIM_WINDOW <= height; y0 += SSIM_STRIDE) {
+				for (u32 x0 = 0; x0 + SSIM_WINDOW <= width; x0 += SSIM_STRIDE) {
+					f64 sumA = 0, sumB = 0, sumAA = 0, sumBB = 0, sumAB = 0;
+					for (u32 y = y0; y < y0 + SSIM_WINDOW; y++) {
+						for (u32 x = x0; x < x0 + SSIM_WINDOW; x++) {
+							const size_t pixel = static_cast<size_t>(y) * width + x;
+							const f64 la = luminance(a, pixel);
+							const f64 lb = luminance(b, pixel);
+							sumA += la;
+							sumB += lb;
+							sumAA += la * la;
+							sumBB += lb * lb;
+							sumAB += la * lb;
+						}
+					}
+					const f64 meanA = sumA / n;
+					const f64 meanB = sumB / n;
+					const f64 varianceA = sumAA / n - meanA * meanA;
+					const f64 varianceB = sumBB / n - meanB * meanB;
+					const f64 covariance = sumAB / n - meanA * meanB;
+					total += ((2 * meanA * meanB + SSIM_C1) * (2 * covariance + SSIM_C2))
+						/ ((meanA * meanA + meanB * meanB + SSIM_C1) * (varianceA + varianceB + SSIM_C2));
+					windows++;
+				}
+			}
+			return total / windows;
+		}
+	}
+
+	auto compareImages(u32 width, u32 height, const std::vector<f32>& referenceRGB, const std::vector<f32>& actualRGB) -> ImageDifference {
+		const size_t valueCount = static_cast<size_t>(width) * height * 3;
+		if (referenceRGB.size() < valueCount || actualRGB.size() < valueCount)
+			throw std::runtime_error("compared images are smaller than their given size");
+
+		std::vector<f64> reference(valueCount);
+		std::vector<f64> actual(valueCount);
+		f64 squaredError = 0.0;
+		for (size_t i = 0; i < valueCount; i++) {
+			reference[i] = toDisplay(referenceRGB[i]);
+			actual[i] = toDisplay(actualRGB[i]);
+			squaredError += (reference[i] - actual[i]) * (reference[i] - actual[i]);
+		}
+
+		ImageDifference difference{};
+		difference.rmse = std::sqrt(squaredError / static_cast<f64>(valueCount));
+		difference.psnr = difference.rmse > 0.0
+			? 20.0 * std::log10(1.0 / difference.rmse)
+			: std::numeric_limits<f64>::infinity();
+		difference.ssim = meanSSIM(width, height, reference, actual);
+		return difference;
+	}
+};
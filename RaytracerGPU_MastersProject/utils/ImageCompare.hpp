@@ -0,0 +1,20 @@
+#pragma once
+
+#include "PrimitiveTypes.hpp"
+
+#include <vector>
+
+/*
+Full-reference image metrics for checking renderer output against stored references.
+Inputs are linear rgb (row major, tightly packed). Both images are first mapped the same way the
+fragment shader displays them (gamma=1/2, clamped to [0, 1]), so a difference only counts as much as it would on screen.
+*/
+namespace Util {
+	struct ImageDifference {
+		f64 rmse; // over every channel of every pixel, in display units
+		f64 psnr; // dB, peak of 1.0. infinity for identical images
+		f64 ssim; // mean structural similarity of luminance over 8x8 windows, 1.0 = identical
+	};
+
+	auto compareImages(u32 width, u32 height, const std::vector<f32>& referenceRGB, const std::vector<f32>& actualRGB) -> ImageDifference;
+};
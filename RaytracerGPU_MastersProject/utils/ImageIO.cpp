@@ -0,0 +1,120 @@
+#include "ImageIO.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace Util {
+	auto writePPM(const std::string& path, u32 width, u32 height, const std::vector<f32>& rgb) -> void {
+		if (rgb.size() < static_cast<size_t>(width) * height * 3)
+			throw std::runtime_error("not enough pixel data to write " + path);
+		std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out)
+			throw std::runtime_error("failed to open " + path + " for writing");
+
+		out << "P6\n" << width << " " << height << "\n255\n";
+		std::vector<u8> row(static_cast<size_t>(width) * 3);
+		for (u32 y = 0; y < height; y++) {
+			for (u32 x = 0; x < width * 3; x++) {
+				const f32 v = std::clamp(rgb[static_cast<size_t>(y) * width * 3 + x], 0.0f, 1.0f);
+				row[x] = static_cast<u8>(v * 255.0f + 0.5f);
+			}
+			out.write(reinterpret_cast<const char*>(row.data()), row.size());
+		}
+	}
+	auto writePFM(const std::string& path, u32 width, u32 height, const std::vector<f32>& rgb) -> void {
+		if (rgb.size() < static_cast<size_t>(width) * height * 3)
+			throw std::runtime_error("not enough pixel data to write " + path);
+		std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out)
+			throw std::runtime_error("failed to open " + path + " for writing");
+
+		out << "PF\n" << width << " " << height << "\n-1.0\n"; // negative scale = little endian
+		for (u32 y = height; y-- > 0;) { // pfm stores rows bottom to top
+			out.write(
+				reinterpret_cast<const char*>(rgb.data() + static_cast<size_t>(y) * width * 3),
+				sizeof(f32) * width * 3
+			);
+		}
+	}
+	auto readPFM(const std::string& path, u32& width, u32& height) -> std::vector<f32> {
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		if (!in)
+			throw std::runtime_error("failed to open " + path + " for reading");
+
+		std::string magic;
+		f32 scale;
+		in >> magic >> width >> height >> scale;
+		in.get(); // single whitespace before the raster
+		if (!in || magic != "PF")
+			throw std::runtime_error(path + " is not an rgb pfm file");
+
+		std::vector<f32> rgb(static_cast<size_t>(width) * height * 3);
+		for (u32 y = height; y-- > 0;) { // stored bottom to top
+			in.read(
+				reinterpret_cast<char*>(rgb.data() + static_cast<size_t>(y) * width * 3),
+				sizeof(f32) * width * 3
+			);
+		}
+		if (!in)
+			throw std::runtime_error(path + " is truncated");
+		if (scale > 0.0f) { // big endian file
+			for (auto& value : rgb) {
+				auto bytes = reinterpret_cast<u8*>(&value);
+				std::reverse(bytes, bytes + sizeof(f32));
+			}
+		}
+		return rgb;
+	}
+	auto averageAccumulated(const std::vector<f32>& rgba, u32 raysPerPixel) -> std::vector<f32> {
+		const size_t texelCount = rgba.size() / 4;
+		std::vector<f32> rgb(texelCount * 3);
+		for (size_t i = 0; i < texelCount; i++) {
+			for (u32 c = 0; c < 3; c++)
+				rgb[i * 3 + c] = rgba[i * 4 + c] / static_cast<f32>(raysPerPixel);
+		}
+		return rgb;
+	}
+	auto writeAccumulatedImage(const std::string& path, u32 width, u32 height, const std::vector<f32>& rgba, u32 raysPerPixel) -> void {
+		if (rgba.size() < static_cast<size_t>(width) * height * 4)
+			throw std::runtime_error("not enough pixel data to write " + path);
+
+		auto rgb = averageAccumulated(rgba, raysPerPixel);
+		if (path.ends_with(".pfm")) {
+			writePFM(path, width, height, rgb);
+			return;
+		}
+		for (auto& value : rgb)
+			value = std::sqrt(value); // gamma=1/2
+		writePPM(path, width, height, rgb);
+	}
+	auto heatmapColor(f32 t) -> std::array<f32, 3> {
+		t = std::clamp(t, 0.0f, 1.0f);
+		const f32 t2 = t * t;
+		const f32 t3 = t2 * t;
+		const f32 t4 = t2 * t2;
+		const f32 t5 = t4 * t;
+		return {
+			std::clamp(0.13572138f + 4.61539260f * t - 42.66032258f * t2 + 132.13108234f * t3 - 152.94239396f * t4 + 59.28637943f * t5, 0.0f, 1.0f),
+			std::clamp(0.09140261f + 2.19418839f * t + 4.84296658f * t2 - 14.18503333f * t3 + 4.27729857f * t4 + 2.82956604f * t5, 0.0f, 1.0f),
+			std::clamp(0.10667330f + 12.64194608f * t - 60.58204836f * t2 + 110.36276771f * t3 - 89.90310912f * t4 + 27.34824973f * t5, 0.0f, 1.0f)
+		};
+	}
+	auto writeHeatmapImage(const std::string& path, u32 width, u32 height, const std::vector<f32>& rgba, u32 raysPerPixel, f32 maxCost) -> void {
+		if (rgba.size() < static_cast<size_t>(width) * height * 4)
+			throw std::runtime_error("not enough pixel data to write " + path);
+
+		auto costs = averageAccumulated(rgba, raysPerPixel);
+		if (path.ends_with(".pfm")) {
+			writePFM(path, width, height, costs);
+			return;
+		}
+		std::vector<f32> rgb(costs.size());
+		for (size_t i = 0; i < costs.size(); i += 3) {
+			const auto color = heatmapColor(costs[i] / maxCost);
+			std::copy(color.begin(), color.end(), rgb.begin() + i);
+		}
+		writePPM(path, width, height, rgb);
+	}
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "PrimitiveTypes.hpp"
+
+#include <array>
+#include <string>
+#include <vector>
+
+/*
+Portable image output for headless rendering (Bitmap is windows only).
+Pixels are tightly packed rgb triples, row 0 being the top of the image.
+*/
+namespace Util {
+	// binary PPM (P6). expects display-ready values in [0, 1], quantized to 8 bits
+	auto writePPM(const std::string& path, u32 width, u32 height, const std::vector<f32>& rgb) -> void;
+	// little-endian PFM (PF). stores the linear float values untouched
+	auto writePFM(const std::string& path, u32 width, u32 height, const std::vector<f32>& rgb) -> void;
+	// reads a PF file written by writePFM (either endianness). returns rgb with row 0 at the top
+	auto readPFM(const std::string& path, u32& width, u32& height) -> std::vector<f32>;
+	// rgba texels summed over raysPerPixel rays (computeImage layout) -> linear rgb average per pixel
+	auto averageAccumulated(const std::vector<f32>& rgba, u32 raysPerPixel) -> std::vector<f32>;
+	// rgba texels summed over raysPerPixel rays (computeImage layout). averages, then writes a .pfm as linear
+	// radiance or anything else as a gamma=1/2 ppm, matching what the fragment shader displays
+	auto writeAccumulatedImage(const std::string& path, u32 width, u32 height, const std::vector<f32>& rgba, u32 raysPerPixel) -> void;
+	// turbo colormap, t clamped to [0, 1]. same fit as shaders/include/colormap.glsl
+	auto heatmapColor(f32 t) -> std::array<f32, 3>;
+	// computeImage texels from the heatmap raytrace build (cost, aabb tests, primitive tests summed over raysPerPixel).
+	// a .pfm keeps the averaged raw costs, anything else is a colormapped ppm matching the fragment shader
+	auto writeHeatmapImage(const std::string& path, u32 width, u32 height, const std::vector<f32>& rgba, u32 raysPerPixel, f32 maxCost) -> void;
+};
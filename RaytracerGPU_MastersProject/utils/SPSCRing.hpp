@@ -0,0 +1,46 @@
+#pragma once
+
+#include "PrimitiveTypes.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+/*
+Bounded lock-free queue for exactly one producer thread and one consumer thread.
+head is only written by the consumer and tail only by the producer, each on its own cache line,
+so a push is a copy plus one release store and never blocks or allocates.
+Capacity must be a power of two; one slot is kept empty to tell full from empty.
+*/
+namespace Util {
+	template <typename T, u32 Capacity>
+	class SPSCRing {
+		static_assert((Capacity & (Capacity - 1)) == 0, "SPSCRing capacity must be a power of two");
+		static_assert(std::is_trivially_copyable_v<T>, "SPSCRing elements are copied by value");
+
+		static constexpr const size_t CACHE_LINE = 64;
+
+		alignas(CACHE_LINE) std::atomic<u32> head{ 0 }; // next slot to read
+		alignas(CACHE_LINE) std::atomic<u32> tail{ 0 }; // next slot to write
+		alignas(CACHE_LINE) std::array<T, Capacity> slots;
+	public:
+		auto tryPush(const T& value) -> bool { // producer thread only. false when full
+			const u32 tail = this->tail.load(std::memory_order_relaxed);
+			const u32 next = (tail + 1) & (Capacity - 1);
+			if (next == this->head.load(std::memory_order_acquire))
+				return false;
+			this->slots[tail] = value;
+			this->tail.store(next, std::memory_order_release);
+			return true;
+		}
+		auto tryPop(T& value) -> bool { // consumer thread only. false when empty
+			const u32 head = this->head.load(std::memory_order_relaxed);
+			if (head == this->tail.load(std::memory_order_acquire))
+				return false;
+			value = this->slots[head];
+			this->head.store((head + 1) & (Capacity - 1), std::memory_order_release);
+			return true;
+		}
+	};
+};
@@ -0,0 +1,226 @@
+#include "Telemetry.hpp"
+
+#include "SPSCRing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace Util::Telemetry {
+	namespace {
+		enum struct Kind : u8 {
+			Span,
+			Counter,
+			Message // name is the text
+		};
+		struct Record { // 48 bytes, copied into the ring as is
+			const char* category;
+			const char* name;
+			i64 startNs; // since the session started. counters use the time they were recorded
+			i64 durationNs;
+			f64 value;
+			u32 frame;
+			Level level;
+			Kind kind;
+		};
+		constexpr const u32 RING_CAPACITY = 1 << 14; // ~750KB, a few hundred frames of records
+
+		std::atomic<SessionState*> active{ nullptr };
+		std::atomic<Level> enabledLevel{ Level::Off };
+	}
+
+	struct SessionState {
+		SPSCRing<Record, RING_CAPACITY> ring;
+		Clock::time_point origin;
+		Level fileLevel;
+		Level consoleLevel;
+		std::ofstream file;
+		bool csv = false;
+		bool firstEvent = true;
+		std::atomic<bool> stopping{ false };
+		std::atomic<u64> dropped{ 0 };
+		std::thread writer;
+
+		auto writerLoop() -> void {
+			Record record;
+			while (true) {
+				const bool stop = this->stopping.load(std::memory_order_acquire); // read before draining so nothing pushed before stop is lost
+				bool wroteAny = false;
+				while (this->ring.tryPop(record)) {
+					this->write(record);
+					wroteAny = true;
+				}
+				if (stop)
+					return;
+				if (!wroteAny)
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+
+		static auto kindName(Kind kind) -> const char* {
+			switch (kind) {
+				case Kind::Span: return "span";
+				case Kind::Counter: return "counter";
+				case Kind::Message: return "message";
+			}
+			return "unknown";
+		}
+
+		auto write(const Record& record) -> void {
+			const f64 startUs = static_cast<f64>(record.startNs) / 1000.0;
+			const f64 durationUs = static_cast<f64>(record.durationNs) / 1000.0;
+			if (this->file.is_open() && record.level <= this->fileLevel) {
+				if (this->csv) {
+					this->file << std::format(
+						"{:.3f},{},{},{},{},{},{:.3f},{}\n",
+						startUs, kindName(record.kind), levelName(record.level),
+						record.category, record.name, record.frame, durationUs, record.value
+					);
+				}
+				else {
+					if (!this->firstEvent)
+						this->file << ",\n";
+					this->firstEvent = false;
+					if (record.kind == Kind::Span) {
+						this->file << std::format(
+							"{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":1,\"tid\":1,\"args\":{{\"frame\":{}}}}}",
+							record.name, record.category, startUs, durationUs, record.frame
+						);
+					}
+					else if (record.kind == Kind::Counter) {
+						this->file << std::format(
+							"{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"C\",\"ts\":{:.3f},\"pid\":1,\"args\":{{\"value\":{}}}}}",
+							record.name, record.category, startUs, record.value
+						);
+					}
+					else {
+						this->file << std::format(
+							"{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"i\",\"s\":\"g\",\"ts\":{:.3f},\"pid\":1,\"tid\":1}}",
+							record.name, record.category, startUs
+						);
+					}
+				}
+			}
+			if (record.level <= this->consoleLevel) {
+				if (record.kind == Kind::Span) {
+					std::cout << std::format(
+						"[{}] frame {} {}/{}: {:.3f}ms\n",
+						levelName(record.level), record.frame, record.category, record.name, durationUs / 1000.0
+					);
+				}
+				else if (record.kind == Kind::Counter) {
+					std::cout << std::format(
+						"[{}] frame {} {}/{}: {}\n",
+						levelName(record.level), record.frame, record.category, record.name, record.value
+					);
+				}
+				else {
+					std::cout << std::format("[{}] {}: {}\n", levelName(record.level), record.category, record.name);
+				}
+			}
+		}
+	};
+
+	auto parseLevel(const std::string& name) -> Level {
+		for (const auto level : { Level::Off, Level::Error, Level::Info, Level::Frame, Level::Debug }) {
+			if (name == levelName(level))
+				return level;
+		}
+		throw std::runtime_error("unknown log level \"" + name + "\" (off, error, info, frame or debug)");
+	}
+	auto levelName(Level level) -> const char* {
+		switch (level) {
+			case Level::Off: return "off";
+			case Level::Error: return "error";
+			case Level::Info: return "info";
+			case Level::Frame: return "frame";
+			case Level::Debug: return "debug";
+		}
+		return "unknown";
+	}
+
+	Session::Session(const std::string& path, Level fileLevel, Level consoleLevel) :
+		state{ std::make_unique<SessionState>() } {
+		if (active.load() != nullptr)
+			throw std::runtime_error("a telemetry session is already active!");
+		this->state->origin = Clock::now();
+		this->state->fileLevel = path.empty() ? Level::Off : fileLevel;
+		this->state->consoleLevel = consoleLevel;
+		if (this->state->fileLevel != Level::Off) {
+			this->state->file.open(path, std::ios::out | std::ios::trunc);
+			if (!this->state->file.is_open())
+				throw std::runtime_error("failed to open " + path + " for writing!");
+			this->state->csv = path.ends_with(".csv");
+			this->state->file << (this->state->csv
+				? "timestampUs,kind,level,category,name,frame,durationUs,value\n"
+				: "{\"traceEvents\":[\n"
+			);
+		}
+		this->state->writer = std::thread(&SessionState::writerLoop, this->state.get());
+		active.store(this->state.get());
+		enabledLevel.store(std::max(this->state->fileLevel, this->state->consoleLevel));
+	}
+	Session::~Session() {
+		enabledLevel.store(Level::Off);
+		active.store(nullptr);
+		this->state->stopping.store(true, std::memory_order_release);
+		this->state->writer.join();
+		if (this->state->file.is_open() && !this->state->csv)
+			this->state->file << "\n]}\n";
+		const u64 dropped = this->state->dropped.load();
+		if (dropped > 0)
+			std::cerr << std::format("telemetry: dropped {} records, the writer fell behind\n", dropped);
+	}
+
+	auto isEnabled(Level level) -> bool {
+		return level != Level::Off && level <= enabledLevel.load(std::memory_order_relaxed);
+	}
+
+	auto span(Level level, const char* category, const char* name, u32 frame, Clock::time_point start, Clock::time_point end) -> void {
+		if (!isEnabled(level))
+			return;
+		auto* state = active.load(std::memory_order_acquire);
+		if (state == nullptr)
+			return;
+		const Record record{
+			category, name,
+			std::chrono::duration_cast<std::chrono::nanoseconds>(start - state->origin).count(),
+			std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+			0.0, frame, level, Kind::Span
+		};
+		if (!state->ring.tryPush(record))
+			state->dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+	auto counter(Level level, const char* category, const char* name, u32 frame, f64 value) -> void {
+		if (!isEnabled(level))
+			return;
+		auto* state = active.load(std::memory_order_acquire);
+		if (state == nullptr)
+			return;
+		const Record record{
+			category, name,
+			std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - state->origin).count(),
+			0, value, frame, level, Kind::Counter
+		};
+		if (!state->ring.tryPush(record))
+			state->dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+	auto message(Level level, const char* category, const char* text) -> void {
+		if (!isEnabled(level))
+			return;
+		auto* state = active.load(std::memory_order_acquire);
+		if (state == nullptr)
+			return;
+		const Record record{
+			category, text,
+			std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - state->origin).count(),
+			0, 0.0, 0, level, Kind::Message
+		};
+		if (!state->ring.tryPush(record))
+			state->dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "PrimitiveTypes.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+/*
+Frame telemetry without console i/o on the render thread.
+span, counter and message copy a fixed size record into a lock-free ring (Util::SPSCRing) and return. A writer
+thread owned by the active Session drains the ring, writes the records to a Chrome trace (chrome://tracing,
+ui.perfetto.dev) or, for a .csv path, a csv file, and echoes records at or below the console level to stdout.
+Records only hold pointers to names, so names must be string literals (or otherwise outlive the session).
+Only one thread may record (the render thread). When the ring is full records are dropped, not waited on,
+and the drop count is reported when the session ends.
+*/
+namespace Util::Telemetry {
+	enum struct Level : u8 {
+		Off,
+		Error,
+		Info, // once per run (startup, results)
+		Frame, // once per frame (frame time, cpu phases, gpu passes)
+		Debug
+	};
+	auto parseLevel(const std::string& name) -> Level; // off, error, info, frame or debug. throws on anything else
+	auto levelName(Level level) -> const char*;
+
+	using Clock = std::chrono::high_resolution_clock;
+
+	struct SessionState;
+
+	class Session { // at most one at a time. span, counter and message do nothing while no session is active
+		std::unique_ptr<SessionState> state;
+	public:
+		// fileLevel applies to path (ignored when path is empty), consoleLevel to stdout
+		Session(const std::string& path, Level fileLevel, Level consoleLevel);
+		~Session(); // drains every pending record, then closes the file
+
+		Session(const Session&) = delete;
+		Session& operator=(const Session&) = delete;
+	};
+
+	auto isEnabled(Level level) -> bool; // true when some sink of the active session wants records of this level
+	auto span(Level level, const char* category, const char* name, u32 frame, Clock::time_point start, Clock::time_point end) -> void;
+	auto counter(Level level, const char* category, const char* name, u32 frame, f64 value) -> void;
+	auto message(Level level, const char* category, const char* text) -> void; // one-off status line, an instant event in traces
+};
@@ -0,0 +1,115 @@
+#include "WorkStealingScheduler.hpp"
+
+#include <algorithm>
+
+namespace Util {
+	WorkStealingScheduler::WorkStealingScheduler(u32 threadCount) {
+		if (threadCount == 0)
+			threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+		for (u32 i = 0; i < threadCount; i++)
+			this->queues.push_back(std::make_unique<WorkerQueue>());
+		for (u32 i = 1; i < threadCount; i++) // worker 0 is whoever calls parallelFor
+			this->threads.emplace_back(&WorkStealingScheduler::workerLoop, this, i);
+	}
+	WorkStealingScheduler::~WorkStealingScheduler() {
+		{
+			std::lock_guard<std::mutex> lock(this->jobMutex);
+			this->stopping = true;
+		}
+		this->jobReady.notify_all();
+		for (auto& thread : this->threads)
+			thread.join();
+	}
+
+	auto WorkStealingScheduler::parallelFor(u32 taskCount, const Task& task) -> void {
+		if (taskCount == 0)
+			return;
+		const u32 workerCount = this->getThreadCount();
+		for (u32 worker = 0; worker < workerCount; worker++) { // contiguous chunk per worker
+			const u32 first = static_cast<u32>(static_cast<u64>(taskCount) * worker / workerCount);
+			const u32 last = static_cast<u32>(static_cast<u64>(taskCount) * (worker + 1) / workerCount);
+			std::lock_guard<std::mutex> lock(this->queues[worker]->mutex);
+			for (u32 i = first; i < last; i++)
+				this->queues[worker]->tasks.push_back(i);
+		}
+		{
+			std::lock_guard<std::mutex> lock(this->jobMutex);
+			this->job = &task;
+			this->firstException = nullptr;
+			this->activeWorkers = workerCount - 1;
+			this->jobGeneration++;
+		}
+		this->jobReady.notify_all();
+
+		this->runTasks(0);
+
+		std::unique_lock<std::mutex> lock(this->jobMutex);
+		this->jobDone.wait(lock, [this]() { return this->activeWorkers == 0; }); // task must outlive every worker still using it
+		this->job = nullptr;
+		if (this->firstException) {
+			auto exception = this->firstException;
+			this->firstException = nullptr;
+			std::rethrow_exception(exception);
+		}
+	}
+
+	auto WorkStealingScheduler::workerLoop(u32 workerIndex) -> void {
+		u64 seenGeneration = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(this->jobMutex);
+				this->jobReady.wait(lock, [this, seenGeneration]() {
+					return this->stopping || this->jobGeneration != seenGeneration;
+				});
+				if (this->stopping)
+					return;
+				seenGeneration = this->jobGeneration;
+			}
+			this->runTasks(workerIndex);
+			{
+				std::lock_guard<std::mutex> lock(this->jobMutex);
+				this->activeWorkers--;
+			}
+			this->jobDone.notify_one();
+		}
+	}
+
+	auto WorkStealingScheduler::runTasks(u32 workerIndex) -> void {
+		u32 task;
+		// tasks never spawn more tasks, so once every deque is empty the job is fully handed out
+		while (this->popOwn(workerIndex, task) || this->steal(workerIndex, task)) {
+			try {
+				(*this->job)(task, workerIndex);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(this->jobMutex);
+				if (!this->firstException)
+					this->firstException = std::current_exception();
+			}
+		}
+	}
+
+	auto WorkStealingScheduler::popOwn(u32 workerIndex, u32& task) -> bool {
+		auto& queue = *this->queues[workerIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+			return false;
+		task = queue.tasks.front();
+		queue.tasks.pop_front();
+		return true;
+	}
+
+	auto WorkStealingScheduler::steal(u32 workerIndex, u32& task) -> bool {
+		const u32 workerCount = this->getThreadCount();
+		for (u32 offset = 1; offset < workerCount; offset++) { // start with the next worker so thieves spread out
+			auto& victim = *this->queues[(workerIndex + offset) % workerCount];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (victim.tasks.empty())
+				continue;
+			task = victim.tasks.back();
+			victim.tasks.pop_back();
+			return true;
+		}
+		return false;
+	}
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "PrimitiveTypes.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Fixed pool of worker threads, each owning a deque of task indices.
+parallelFor splits the task range into contiguous chunks, one per worker. A worker pops its own chunk
+from the front (keeping neighbouring tiles together), and once it runs dry steals from the back of
+another worker's deque, so uneven tiles (sky vs dense geometry) still balance across cores.
+The calling thread works as worker 0, so a scheduler with 1 thread runs everything inline.
+*/
+namespace Util {
+	class WorkStealingScheduler {
+	public:
+		using Task = std::function<void(u32 taskIndex, u32 workerIndex)>;
+	private:
+		struct WorkerQueue {
+			std::mutex mutex;
+			std::deque<u32> tasks;
+		};
+
+		std::vector<std::thread> threads;
+		std::vector<std::unique_ptr<WorkerQueue>> queues; // one per worker, including the calling thread
+
+		std::mutex jobMutex;
+		std::condition_variable jobReady;
+		std::condition_variable jobDone;
+		const Task* job = nullptr;
+		u64 jobGeneration = 0;
+		u32 activeWorkers = 0;
+		bool stopping = false;
+		std::exception_ptr firstException;
+
+		auto workerLoop(u32 workerIndex) -> void;
+		auto runTasks(u32 workerIndex) -> void;
+		auto popOwn(u32 workerIndex, u32& task) -> bool;
+		auto steal(u32 workerIndex, u32& task) -> bool;
+	public:
+		WorkStealingScheduler(u32 threadCount = 0); // 0 = std::thread::hardware_concurrency
+		~WorkStealingScheduler();
+
+		WorkStealingScheduler(const WorkStealingScheduler&) = delete;
+		WorkStealingScheduler& operator=(const WorkStealingScheduler&) = delete;
+
+		// blocks until task(i, worker) has run for every i in [0, taskCount). rethrows the first exception a task threw
+		auto parallelFor(u32 taskCount, const Task& task) -> void;
+		auto getThreadCount() const -> u32 { return static_cast<u32>(this->queues.size()); }
+	};
+};